@@ -0,0 +1,561 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "BoundingVolumeHierarchy.h"
+#include "BoundingVolumes.h"
+#include "Simd.h"
+
+namespace {
+    constexpr float INFINITE_DISTANCE = std::numeric_limits<float>::infinity();
+    /*Cost of visiting a node relative to testing a primitive; a leaf's boxes are contiguous, so a few per leaf pay off*/
+    constexpr float TRAVERSAL_COST = 2.0f;
+    /*Depth-first traversal holds at most one pending sibling per level, plus the node popped next*/
+    constexpr uint32_t STACK_SIZE = BoundingVolumeHierarchy::MAX_DEPTH + 2;
+
+    struct box_t {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+        void grow(const glm::vec3& point_min, const glm::vec3& point_max) {
+            min = glm::min(min, point_min);
+            max = glm::max(max, point_max);
+        }
+        /*Half the surface area, all the heuristic needs are ratios*/
+        float area() const {
+            glm::vec3 extent = glm::max(max - min, glm::vec3(0.0f));
+            return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+        }
+    };
+
+    float half_area(const glm::vec3& min, const glm::vec3& max) {
+        glm::vec3 extent = glm::max(max - min, glm::vec3(0.0f));
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    /*Squared distance from point to the box, 0 inside*/
+    float box_distance2(const glm::vec3& min, const glm::vec3& max, const glm::vec3& point) {
+        glm::vec3 outside = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(outside, outside);
+    }
+
+    /*Entry distance of the ray into the box, infinite on a miss or beyond limit*/
+    float box_entry(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverse_direction, float limit) {
+        glm::vec3 t0 = (min - origin) * inverse_direction;
+        glm::vec3 t1 = (max - origin) * inverse_direction;
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far = glm::max(t0, t1);
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        float exit = std::min(std::min(far.x, far.y), std::min(far.z, limit));
+        return enter <= exit ? enter : INFINITE_DISTANCE;
+    }
+
+    /*Primitives are partitioned by value so every pass of the build reads them in order*/
+    struct build_primitive_t {
+        glm::vec3 bounds_min;
+        uint32_t index;
+        glm::vec3 bounds_max;
+        /*Each corner plus the next field loads as one SIMD register*/
+        float padding;
+        glm::vec3 centroid() const { return (bounds_min + bounds_max) * 0.5f; }
+    };
+
+    struct builder_t {
+        std::vector<build_primitive_t>& primitives;
+        std::vector<bvh_node_t>& nodes;
+        uint32_t depth = 0;
+
+        /*Lane 3 is unused; plain vectors so only the bins a node uses get initialized*/
+        struct bin_t {
+            simd4f min;
+            simd4f max;
+            uint32_t count;
+        };
+
+        /*Half the surface area of the box a bin accumulated*/
+        static float bin_area(simd4f min, simd4f max) {
+            float extent[4];
+            simd_store(extent, simd_max(simd_sub(max, min), simd_splat(0.0f)));
+            return extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0];
+        }
+
+        /*Lowest SAH cost split of primitives[begin, end) over the bins of all three axes; false when none beats a leaf*/
+        bool find_split(uint32_t begin, uint32_t end, const box_t& bounds, const box_t& centroid_bounds, int& axis, float& position) const {
+            constexpr uint32_t MAX_BINS = BoundingVolumeHierarchy::SAH_BINS;
+            uint32_t count = end - begin;
+            /*Small nodes get fewer bins, setting them up would cost more than binning*/
+            uint32_t bin_count = std::min(count, MAX_BINS);
+            glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+            float scale[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (int a = 0; a < 3; ++a) {
+                scale[a] = extent[a] > 0.0f ? static_cast<float>(bin_count) / extent[a] : 0.0f;
+            }
+            bin_t bins[3][MAX_BINS];
+            for (int a = 0; a < 3; ++a) {
+                for (uint32_t b = 0; b < bin_count; ++b) {
+                    bins[a][b] = {simd_splat(std::numeric_limits<float>::max()), simd_splat(-std::numeric_limits<float>::max()), 0};
+                }
+            }
+            /*One pass fills the bins of every axis, a primitive's two corners are one register each*/
+            float origin[4] = {centroid_bounds.min.x, centroid_bounds.min.y, centroid_bounds.min.z, 0.0f};
+            simd4f bin_origin = simd_load(origin);
+            simd4f bin_scale = simd_load(scale);
+            simd4f half = simd_splat(0.5f);
+            simd4f last = simd_splat(static_cast<float>(bin_count - 1));
+            /*Lane 3 of the minimum corner is the index, a denormal as a float and slow to compute with*/
+            const uint32_t xyz_bits[4] = {~0u, ~0u, ~0u, 0u};
+            float xyz_mask[4];
+            memcpy(xyz_mask, xyz_bits, sizeof(xyz_mask));
+            simd4f xyz = simd_load(xyz_mask);
+            for (uint32_t i = begin; i < end; ++i) {
+                const build_primitive_t& primitive = primitives[i];
+                simd4f low = simd_and(simd_load(&primitive.bounds_min.x), xyz);
+                simd4f high = simd_load(&primitive.bounds_max.x);
+                simd4f offset = simd_mul(simd_sub(simd_mul(simd_add(low, high), half), bin_origin), bin_scale);
+                int32_t index[4];
+                /*Rounds, so half a bin lower truncates to the bin*/
+                simd_store_int(index, simd_clamp(simd_sub(offset, half), simd_splat(0.0f), last));
+                for (int a = 0; a < 3; ++a) {
+                    bin_t& bin = bins[a][index[a]];
+                    bin.min = simd_min(bin.min, low);
+                    bin.max = simd_max(bin.max, high);
+                    ++bin.count;
+                }
+            }
+            float best_cost = INFINITE_DISTANCE;
+            for (int a = 0; a < 3; ++a) {
+                if (extent[a] <= 0.0f) continue;
+                /*Right side sweeps first so one pass from the left finds the split*/
+                float right_cost[MAX_BINS];
+                simd4f right_min = simd_splat(std::numeric_limits<float>::max());
+                simd4f right_max = simd_splat(-std::numeric_limits<float>::max());
+                uint32_t right_count = 0;
+                for (uint32_t b = bin_count - 1; b > 0; --b) {
+                    right_min = simd_min(right_min, bins[a][b].min);
+                    right_max = simd_max(right_max, bins[a][b].max);
+                    right_count += bins[a][b].count;
+                    right_cost[b] = bin_area(right_min, right_max) * static_cast<float>(right_count);
+                }
+                simd4f left_min = simd_splat(std::numeric_limits<float>::max());
+                simd4f left_max = simd_splat(-std::numeric_limits<float>::max());
+                uint32_t left_count = 0;
+                for (uint32_t b = 0; b + 1 < bin_count; ++b) {
+                    left_min = simd_min(left_min, bins[a][b].min);
+                    left_max = simd_max(left_max, bins[a][b].max);
+                    left_count += bins[a][b].count;
+                    if (left_count == 0 || left_count == count) continue;
+                    float cost = bin_area(left_min, left_max) * static_cast<float>(left_count) + right_cost[b + 1];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        axis = a;
+                        position = centroid_bounds.min[a] + static_cast<float>(b + 1) / scale[a];
+                    }
+                }
+            }
+            if (best_cost == INFINITE_DISTANCE) return false;
+            float area = bounds.area();
+            float split_cost = TRAVERSAL_COST + (area > 0.0f ? best_cost / area : static_cast<float>(count));
+            return split_cost < static_cast<float>(count) || count > BoundingVolumeHierarchy::MAX_LEAF_SIZE;
+        }
+
+        void build(uint32_t node, uint32_t begin, uint32_t end, uint32_t level) {
+            box_t bounds;
+            box_t centroid_bounds;
+            for (uint32_t i = begin; i < end; ++i) {
+                glm::vec3 centroid = primitives[i].centroid();
+                bounds.grow(primitives[i].bounds_min, primitives[i].bounds_max);
+                centroid_bounds.grow(centroid, centroid);
+            }
+            nodes[node].bounds_min = bounds.min;
+            nodes[node].bounds_max = bounds.max;
+            depth = std::max(depth, level + 1);
+            uint32_t count = end - begin;
+            uint32_t middle = begin;
+            if (count > 1) {
+                int axis = 0;
+                float position = 0.0f;
+                if (level >= BoundingVolumeHierarchy::MAX_DEPTH / 2) {
+                    /*Halving from here on bounds the depth however lopsided the SAH splits were; small nodes stay leaves*/
+                    if (count > BoundingVolumeHierarchy::MAX_LEAF_SIZE) {
+                        glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+                        axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+                        middle = begin + count / 2;
+                        std::nth_element(primitives.begin() + begin, primitives.begin() + middle, primitives.begin() + end,
+                                         [axis](const build_primitive_t& a, const build_primitive_t& b) {
+                                             return a.centroid()[axis] < b.centroid()[axis];
+                                         });
+                    }
+                } else if (find_split(begin, end, bounds, centroid_bounds, axis, position)) {
+                    middle = static_cast<uint32_t>(std::partition(primitives.begin() + begin, primitives.begin() + end,
+                                                                  [axis, position](const build_primitive_t& primitive) {
+                                                                      return primitive.centroid()[axis] < position;
+                                                                  }) - primitives.begin());
+                    /*Bin edges in floats can land a whole side over; fall back to halves*/
+                    if (middle == begin || middle == end) {
+                        middle = begin + count / 2;
+                    }
+                } else if (count > BoundingVolumeHierarchy::MAX_LEAF_SIZE) {
+                    /*Every centroid in one spot, any halves are as good*/
+                    middle = begin + count / 2;
+                }
+            }
+            if (middle == begin) {
+                nodes[node].offset = begin;
+                nodes[node].count = count;
+                return;
+            }
+            uint32_t left = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+            build(left, begin, middle, level + 1);
+            uint32_t right = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+            build(right, middle, end, level + 1);
+            nodes[node].offset = right;
+            nodes[node].count = 0;
+        }
+    };
+}
+
+void BoundingVolumeHierarchy::build(const glm::vec3 *bounds_min, const glm::vec3 *bounds_max, uint32_t count) {
+    nodes.clear();
+    depth = 0;
+    order.resize(count);
+    leaf_min.resize(count);
+    leaf_max.resize(count);
+    if (count == 0) return;
+    std::vector<build_primitive_t> primitives(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        primitives[i] = {bounds_min[i], i, bounds_max[i], 0.0f};
+    }
+    /*A binary tree with at least one primitive per leaf*/
+    nodes.reserve(2 * static_cast<size_t>(count) - 1);
+    nodes.emplace_back();
+    builder_t builder{primitives, nodes};
+    builder.build(0, 0, count, 0);
+    depth = builder.depth;
+    for (uint32_t i = 0; i < count; ++i) {
+        order[i] = primitives[i].index;
+        leaf_min[i] = primitives[i].bounds_min;
+        leaf_max[i] = primitives[i].bounds_max;
+    }
+}
+
+void BoundingVolumeHierarchy::refit(const glm::vec3 *bounds_min, const glm::vec3 *bounds_max) {
+    for (size_t i = 0; i < order.size(); ++i) {
+        leaf_min[i] = bounds_min[order[i]];
+        leaf_max[i] = bounds_max[order[i]];
+    }
+    /*Children always come after their parent*/
+    for (size_t i = nodes.size(); i-- > 0;) {
+        bvh_node_t& node = nodes[i];
+        box_t bounds;
+        if (node.count > 0) {
+            for (uint32_t p = node.offset; p < node.offset + node.count; ++p) {
+                bounds.grow(leaf_min[p], leaf_max[p]);
+            }
+        } else {
+            bounds.grow(nodes[i + 1].bounds_min, nodes[i + 1].bounds_max);
+            bounds.grow(nodes[node.offset].bounds_min, nodes[node.offset].bounds_max);
+        }
+        node.bounds_min = bounds.min;
+        node.bounds_max = bounds.max;
+    }
+}
+
+uint32_t BoundingVolumeHierarchy::size() const {
+    return static_cast<uint32_t>(order.size());
+}
+
+uint32_t BoundingVolumeHierarchy::cull(const glm::vec4 *planes, uint32_t *visible) const {
+    if (nodes.empty()) return 0;
+    /*Bit N set while plane N still has to be tested*/
+    struct entry_t {
+        uint32_t node;
+        uint32_t planes;
+    };
+    entry_t stack[STACK_SIZE];
+    uint32_t top = 0;
+    stack[top++] = {0, 0x3F};
+    uint32_t written = 0;
+    while (top > 0) {
+        entry_t entry = stack[--top];
+        const bvh_node_t& node = nodes[entry.node];
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; ++p) {
+            if (!(entry.planes & 1u << p)) continue;
+            glm::vec3 normal(planes[p]);
+            glm::vec3 farthest = glm::mix(node.bounds_min, node.bounds_max, glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0.0f))));
+            glm::vec3 nearest = glm::mix(node.bounds_max, node.bounds_min, glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0.0f))));
+            outside = glm::dot(normal, farthest) + planes[p].w < 0.0f;
+            if (glm::dot(normal, nearest) + planes[p].w >= 0.0f) {
+                entry.planes &= ~(1u << p);
+            }
+        }
+        if (outside) continue;
+        if (node.count == 0) {
+            stack[top++] = {node.offset, entry.planes};
+            stack[top++] = {entry.node + 1, entry.planes};
+            continue;
+        }
+        for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p) {
+                if (!(entry.planes & 1u << p)) continue;
+                glm::vec3 normal(planes[p]);
+                glm::vec3 farthest = glm::mix(leaf_min[i], leaf_max[i], glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0.0f))));
+                inside = glm::dot(normal, farthest) + planes[p].w >= 0.0f;
+            }
+            if (inside) {
+                visible[written++] = order[i];
+            }
+        }
+    }
+    return written;
+}
+
+bool BoundingVolumeHierarchy::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, bvh_hit_t &hit,
+                                      const std::function<bool(uint32_t, float &)> &intersect) const {
+    if (nodes.empty()) return false;
+    struct entry_t {
+        uint32_t node;
+        float distance;
+    };
+    glm::vec3 inverse_direction = 1.0f / direction;
+    float closest = max_distance;
+    bool found = false;
+    entry_t stack[STACK_SIZE];
+    uint32_t top = 0;
+    float root = box_entry(nodes[0].bounds_min, nodes[0].bounds_max, origin, inverse_direction, closest);
+    if (root != INFINITE_DISTANCE) {
+        stack[top++] = {0, root};
+    }
+    while (top > 0) {
+        entry_t entry = stack[--top];
+        /*A closer hit was found since it was pushed*/
+        if (entry.distance > closest) continue;
+        const bvh_node_t& node = nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                float distance = box_entry(leaf_min[i], leaf_max[i], origin, inverse_direction, closest);
+                if (distance == INFINITE_DISTANCE) continue;
+                if (intersect && !intersect(order[i], distance)) continue;
+                if (distance <= closest) {
+                    closest = distance;
+                    hit = {order[i], distance};
+                    found = true;
+                }
+            }
+            continue;
+        }
+        /*Nearer child on top*/
+        entry_t children[2] = {
+                {entry.node + 1, box_entry(nodes[entry.node + 1].bounds_min, nodes[entry.node + 1].bounds_max, origin, inverse_direction, closest)},
+                {node.offset, box_entry(nodes[node.offset].bounds_min, nodes[node.offset].bounds_max, origin, inverse_direction, closest)}
+        };
+        if (children[0].distance < children[1].distance) {
+            std::swap(children[0], children[1]);
+        }
+        for (const entry_t& child: children) {
+            if (child.distance != INFINITE_DISTANCE) {
+                stack[top++] = child;
+            }
+        }
+    }
+    return found;
+}
+
+uint32_t BoundingVolumeHierarchy::overlap_sphere(const glm::vec3 &center, float radius, uint32_t *primitives) const {
+    if (nodes.empty()) return 0;
+    float radius2 = radius * radius;
+    uint32_t stack[STACK_SIZE];
+    uint32_t top = 0;
+    stack[top++] = 0;
+    uint32_t written = 0;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const bvh_node_t& node = nodes[index];
+        if (box_distance2(node.bounds_min, node.bounds_max, center) > radius2) continue;
+        if (node.count == 0) {
+            stack[top++] = node.offset;
+            stack[top++] = index + 1;
+            continue;
+        }
+        for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+            if (box_distance2(leaf_min[i], leaf_max[i], center) <= radius2) {
+                primitives[written++] = order[i];
+            }
+        }
+    }
+    return written;
+}
+
+bool BoundingVolumeHierarchy::nearest(const glm::vec3 &point, float max_distance, bvh_hit_t &hit) const {
+    if (nodes.empty()) return false;
+    struct entry_t {
+        uint32_t node;
+        float distance2;
+    };
+    float closest2 = max_distance * max_distance;
+    bool found = false;
+    entry_t stack[STACK_SIZE];
+    uint32_t top = 0;
+    stack[top++] = {0, box_distance2(nodes[0].bounds_min, nodes[0].bounds_max, point)};
+    while (top > 0) {
+        entry_t entry = stack[--top];
+        if (entry.distance2 > closest2) continue;
+        const bvh_node_t& node = nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                float distance2 = box_distance2(leaf_min[i], leaf_max[i], point);
+                if (distance2 <= closest2) {
+                    closest2 = distance2;
+                    hit = {order[i], 0.0f};
+                    found = true;
+                }
+            }
+            continue;
+        }
+        entry_t children[2] = {
+                {entry.node + 1, box_distance2(nodes[entry.node + 1].bounds_min, nodes[entry.node + 1].bounds_max, point)},
+                {node.offset, box_distance2(nodes[node.offset].bounds_min, nodes[node.offset].bounds_max, point)}
+        };
+        if (children[0].distance2 < children[1].distance2) {
+            std::swap(children[0], children[1]);
+        }
+        for (const entry_t& child: children) {
+            if (child.distance2 <= closest2) {
+                stack[top++] = child;
+            }
+        }
+    }
+    if (found) {
+        hit.distance = std::sqrt(closest2);
+    }
+    return found;
+}
+
+bvh_stats_t BoundingVolumeHierarchy::get_stats() const {
+    bvh_stats_t stats{static_cast<uint32_t>(nodes.size()), 0, depth, 0.0f};
+    if (nodes.empty()) return stats;
+    float cost = 0.0f;
+    for (const bvh_node_t& node: nodes) {
+        float area = half_area(node.bounds_min, node.bounds_max);
+        if (node.count > 0) {
+            ++stats.leaves;
+            cost += area * static_cast<float>(node.count);
+        } else {
+            cost += area * TRAVERSAL_COST;
+        }
+    }
+    float root_area = half_area(nodes[0].bounds_min, nodes[0].bounds_max);
+    stats.sah_cost = root_area > 0.0f ? cost / root_area : 0.0f;
+    return stats;
+}
+
+const std::vector<bvh_node_t> &BoundingVolumeHierarchy::get_nodes() const {
+    return nodes;
+}
+
+bvh_benchmark_t benchmark_bvh(uint32_t count, uint32_t queries) {
+    /*A 1000 unit world around a camera looking down -z, small enough a share of it in view that culling can skip most*/
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> half_extent(0.1f, 2.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> bounds_min(count);
+    std::vector<glm::vec3> bounds_max(count);
+    BoundingVolumes volumes;
+    volumes.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extent(half_extent(random), half_extent(random), half_extent(random));
+        bounds_min[i] = center - extent;
+        bounds_max[i] = center + extent;
+        volumes.add(bounds_min[i], bounds_max[i]);
+    }
+    bvh_benchmark_t result{};
+    result.primitives = count;
+    queries = std::max(queries, 1u);
+
+    BoundingVolumeHierarchy bvh;
+    auto begin = std::chrono::steady_clock::now();
+    bvh.build(bounds_min.data(), bounds_max.data(), count);
+    auto built = std::chrono::steady_clock::now();
+    result.build_ms = std::chrono::duration<double, std::milli>(built - begin).count();
+    result.stats = bvh.get_stats();
+
+    /*OpenGL depth range to Vulkan's*/
+    glm::mat4 clip(1.0f);
+    clip[2][2] = 0.5f;
+    clip[3][2] = 0.5f;
+    glm::mat4 view_proj = clip * glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f)
+                          * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    extract_frustum_planes(view_proj, planes);
+    std::vector<uint32_t> primitives(count);
+    std::vector<uint32_t> brute_primitives(count);
+    begin = std::chrono::steady_clock::now();
+    result.visible = bvh.cull(planes, primitives.data());
+    auto culled = std::chrono::steady_clock::now();
+    result.brute_visible = volumes.cull_boxes(planes, brute_primitives.data());
+    auto brute_culled = std::chrono::steady_clock::now();
+    result.cull_ms = std::chrono::duration<double, std::milli>(culled - begin).count();
+    result.brute_cull_ms = std::chrono::duration<double, std::milli>(brute_culled - culled).count();
+    /*Both test the same boxes, so the sets must be equal; cull_boxes() already writes in ascending order*/
+    std::sort(primitives.begin(), primitives.begin() + result.visible);
+    uint32_t tree_at = 0, brute_at = 0;
+    while (tree_at < result.visible && brute_at < result.brute_visible) {
+        if (primitives[tree_at] == brute_primitives[brute_at]) {
+            ++tree_at;
+            ++brute_at;
+        } else {
+            ++result.cull_mismatches;
+            ++(primitives[tree_at] < brute_primitives[brute_at] ? tree_at : brute_at);
+        }
+    }
+    result.cull_mismatches += (result.visible - tree_at) + (result.brute_visible - brute_at);
+
+    /*Picking rays from the camera, spheres and points spread through the world*/
+    std::vector<glm::vec3> directions(queries);
+    std::vector<glm::vec3> points(queries);
+    for (uint32_t i = 0; i < queries; ++i) {
+        directions[i] = glm::vec3(unit(random) * 0.5f, unit(random) * 0.3f, -1.0f);
+        points[i] = glm::vec3(position(random), position(random), position(random));
+    }
+    bvh_hit_t hit{};
+    begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < queries; ++i) {
+        result.ray_hits += bvh.raycast(glm::vec3(0.0f), directions[i], 1000.0f, hit) ? 1 : 0;
+    }
+    auto rays = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < queries; ++i) {
+        bvh.overlap_sphere(points[i], 10.0f, primitives.data());
+    }
+    auto overlaps = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < queries; ++i) {
+        bvh.nearest(points[i], INFINITE_DISTANCE, hit);
+    }
+    auto nearests = std::chrono::steady_clock::now();
+    result.ray_us = std::chrono::duration<double, std::micro>(rays - begin).count() / queries;
+    result.overlap_us = std::chrono::duration<double, std::micro>(overlaps - rays).count() / queries;
+    result.nearest_us = std::chrono::duration<double, std::micro>(nearests - overlaps).count() / queries;
+
+    /*Every object moves a little, as in one frame of animation*/
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 offset(unit(random), unit(random), unit(random));
+        bounds_min[i] += offset;
+        bounds_max[i] += offset;
+    }
+    begin = std::chrono::steady_clock::now();
+    bvh.refit(bounds_min.data(), bounds_max.data());
+    result.refit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    result.refit_sah_cost = bvh.get_stats().sah_cost;
+    return result;
+}
@@ -0,0 +1,111 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_BOUNDINGVOLUMEHIERARCHY_H
+#define HELLO_VULKAN_BOUNDINGVOLUMEHIERARCHY_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "glm/glm.hpp"
+
+/*Node of the flattened tree, 32 bytes so two share a cache line*/
+struct bvh_node_t {
+    glm::vec3 bounds_min;
+    /*Leaf: its first primitive in leaf order; interior: index of the second child, the first one follows the node*/
+    uint32_t offset;
+    glm::vec3 bounds_max;
+    /*Primitives of a leaf, 0 for interior nodes*/
+    uint32_t count;
+};
+
+static_assert(sizeof(bvh_node_t) == 32, "bvh_node_t must stay 32 bytes!");
+
+struct bvh_hit_t {
+    uint32_t primitive;
+    float distance;
+};
+
+struct bvh_stats_t {
+    uint32_t nodes;
+    uint32_t leaves;
+    uint32_t depth;
+    /*Expected cost of a query relative to testing one primitive, grows as refits loosen the tree*/
+    float sah_cost;
+};
+
+/*
+ * Axis aligned bounding box hierarchy over primitives given as boxes and identified by
+ * their index. The build splits at the lowest surface area heuristic cost over binned
+ * centroids; nodes are stored depth first, so the first child of a node is the next
+ * node and a leaf's primitives are one contiguous range of the leaf order, with their
+ * boxes copied next to each other for the queries.
+ *
+ * refit() keeps the topology and only recomputes boxes, which is linear and cheap for
+ * moving objects but loosens the tree as they drift apart; rebuild once get_stats()
+ * reports a cost well above the one after build().
+ */
+class BoundingVolumeHierarchy {
+private:
+    std::vector<bvh_node_t> nodes;
+    /*Primitive index of each leaf order entry*/
+    std::vector<uint32_t> order;
+    std::vector<glm::vec3> leaf_min;
+    std::vector<glm::vec3> leaf_max;
+    uint32_t depth = 0;
+public:
+    /*Leaves are split above this many primitives whatever their cost*/
+    static constexpr uint32_t MAX_LEAF_SIZE = 8;
+    static constexpr uint32_t SAH_BINS = 16;
+    /*Splits turn into median splits past half of it, so no tree gets deeper*/
+    static constexpr uint32_t MAX_DEPTH = 64;
+    void build(const glm::vec3* bounds_min, const glm::vec3* bounds_max, uint32_t count);
+    /*New boxes for the primitives of the last build, by primitive index*/
+    void refit(const glm::vec3* bounds_min, const glm::vec3* bounds_max);
+    uint32_t size() const;
+    /*
+     * Primitives whose box intersects the frustum, unordered; visible needs room for size()
+     * entries. Returns how many there are. Subtrees inside every plane are not tested further.
+     */
+    uint32_t cull(const glm::vec4 planes[6], uint32_t* visible) const;
+    /*
+     * Closest primitive along the ray within max_distance, direction need not be normalized
+     * and distances are in its units. Boxes are hit tests of their own; intersect refines
+     * them, it gets the box distance, may move it back and returns false on a miss.
+     */
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, bvh_hit_t& hit,
+                 const std::function<bool(uint32_t /*primitive*/, float& /*distance*/)>& intersect = nullptr) const;
+    /*Primitives whose box is within radius of center; primitives needs room for size() entries*/
+    uint32_t overlap_sphere(const glm::vec3& center, float radius, uint32_t* primitives) const;
+    /*Primitive whose box is closest to point, 0 from inside it; false if none is within max_distance*/
+    bool nearest(const glm::vec3& point, float max_distance, bvh_hit_t& hit) const;
+    bvh_stats_t get_stats() const;
+    const std::vector<bvh_node_t>& get_nodes() const;
+};
+
+struct bvh_benchmark_t {
+    uint32_t primitives;
+    bvh_stats_t stats;
+    double build_ms;
+    /*After moving every primitive a little*/
+    double refit_ms;
+    float refit_sah_cost;
+    /*One frustum, against BoundingVolumes::cull_boxes() over every primitive*/
+    double cull_ms;
+    double brute_cull_ms;
+    uint32_t visible;
+    uint32_t brute_visible;
+    /*Primitives in only one of the two visible sets, 0 unless the tree is broken*/
+    uint32_t cull_mismatches;
+    /*Per query*/
+    double ray_us;
+    uint32_t ray_hits;
+    double overlap_us;
+    double nearest_us;
+};
+
+/*Builds and queries a tree of count random boxes, query times averaged over queries of each kind*/
+bvh_benchmark_t benchmark_bvh(uint32_t count, uint32_t queries);
+
+
+#endif //HELLO_VULKAN_BOUNDINGVOLUMEHIERARCHY_H
@@ -0,0 +1,232 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include "glm/gtc/matrix_transform.hpp"
+#include "BoundingVolumes.h"
+#include "Simd.h"
+
+namespace {
+    /*Planes splatted across the lanes once per pass*/
+    struct simd_planes_t {
+        simd4f x[6];
+        simd4f y[6];
+        simd4f z[6];
+        simd4f w[6];
+    };
+
+    simd_planes_t splat_planes(const glm::vec4 planes[6]) {
+        simd_planes_t splatted;
+        for (int i = 0; i < 6; ++i) {
+            splatted.x[i] = simd_splat(planes[i].x);
+            splatted.y[i] = simd_splat(planes[i].y);
+            splatted.z[i] = simd_splat(planes[i].z);
+            splatted.w[i] = simd_splat(planes[i].w);
+        }
+        return splatted;
+    }
+
+    /*Appends first + N for every set bit N of mask*/
+    uint32_t emit_visible(uint32_t mask, uint32_t first, uint32_t* visible, uint32_t written) {
+        while (mask) {
+            visible[written++] = first + static_cast<uint32_t>(__builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+        return written;
+    }
+
+    /*Lanes of the block at first that hold real objects*/
+    uint32_t block_mask(uint32_t first, uint32_t count) {
+        uint32_t remaining = count - first;
+        return remaining >= BoundingVolumes::BLOCK ? (1u << BoundingVolumes::BLOCK) - 1 : (1u << remaining) - 1;
+    }
+
+    /*Bit N set when object N of the four at i is outside some plane*/
+    int spheres_outside(const simd_planes_t& planes, const float* x, const float* y, const float* z, const float* r, size_t i) {
+        simd4f cx = simd_load(x + i), cy = simd_load(y + i), cz = simd_load(z + i);
+        simd4f negative_radius = simd_sub(simd_splat(0.0f), simd_load(r + i));
+        simd4f outside = simd_splat(0.0f);
+        for (int p = 0; p < 6; ++p) {
+            simd4f distance = simd_madd(planes.x[p], cx, simd_madd(planes.y[p], cy, simd_madd(planes.z[p], cz, planes.w[p])));
+            outside = simd_or(outside, simd_less(distance, negative_radius));
+        }
+        return simd_mask(outside);
+    }
+
+    /*Same for boxes, corners holds each plane's farthest corner as one array per axis*/
+    int boxes_outside(const simd_planes_t& planes, const float* const corners[6][3], size_t i) {
+        simd4f zero = simd_splat(0.0f);
+        simd4f outside = zero;
+        for (int p = 0; p < 6; ++p) {
+            simd4f distance = simd_madd(planes.x[p], simd_load(corners[p][0] + i),
+                                        simd_madd(planes.y[p], simd_load(corners[p][1] + i),
+                                                  simd_madd(planes.z[p], simd_load(corners[p][2] + i), planes.w[p])));
+            outside = simd_or(outside, simd_less(distance, zero));
+        }
+        return simd_mask(outside);
+    }
+}
+
+void extract_frustum_planes(const glm::mat4 &view_proj, glm::vec4 *planes) {
+    /*Gribb-Hartmann on the rows; Vulkan clips z to [0, w], so near is row 2 alone*/
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+    }
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[2];
+    planes[5] = rows[3] - rows[2];
+    for (int i = 0; i < 6; ++i) {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 1e-20f) {
+            planes[i] /= length;
+        }
+    }
+}
+
+uint32_t cull_spheres_scalar(const glm::vec4 *spheres, uint32_t count, const glm::vec4 *planes, uint32_t *visible) {
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const glm::vec4& sphere = spheres[i];
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            inside = glm::dot(glm::vec3(planes[p]), glm::vec3(sphere)) + planes[p].w >= -sphere.w;
+        }
+        if (inside) {
+            visible[written++] = i;
+        }
+    }
+    return written;
+}
+
+void BoundingVolumes::resize_storage(size_t size) {
+    for (std::vector<float>* component: {&center_x, &center_y, &center_z, &radius, &min_x, &min_y, &min_z, &max_x, &max_y, &max_z}) {
+        component->resize(size, 0.0f);
+    }
+}
+
+void BoundingVolumes::clear() {
+    count = 0;
+    resize_storage(0);
+}
+
+void BoundingVolumes::reserve(uint32_t capacity) {
+    size_t padded = (static_cast<size_t>(capacity) + BLOCK - 1) / BLOCK * BLOCK;
+    for (std::vector<float>* component: {&center_x, &center_y, &center_z, &radius, &min_x, &min_y, &min_z, &max_x, &max_y, &max_z}) {
+        component->reserve(padded);
+    }
+}
+
+uint32_t BoundingVolumes::add(const glm::vec4 &sphere, const glm::vec3 &bounds_min, const glm::vec3 &bounds_max) {
+    if (count % BLOCK == 0) {
+        resize_storage(count + BLOCK);
+    }
+    set(count, sphere, bounds_min, bounds_max);
+    return count++;
+}
+
+uint32_t BoundingVolumes::add(const glm::vec3 &bounds_min, const glm::vec3 &bounds_max) {
+    return add(glm::vec4((bounds_min + bounds_max) * 0.5f, glm::length(bounds_max - bounds_min) * 0.5f), bounds_min, bounds_max);
+}
+
+void BoundingVolumes::set(uint32_t index, const glm::vec4 &sphere, const glm::vec3 &bounds_min, const glm::vec3 &bounds_max) {
+    center_x[index] = sphere.x;
+    center_y[index] = sphere.y;
+    center_z[index] = sphere.z;
+    radius[index] = sphere.w;
+    min_x[index] = bounds_min.x;
+    min_y[index] = bounds_min.y;
+    min_z[index] = bounds_min.z;
+    max_x[index] = bounds_max.x;
+    max_y[index] = bounds_max.y;
+    max_z[index] = bounds_max.z;
+}
+
+uint32_t BoundingVolumes::size() const {
+    return count;
+}
+
+glm::vec4 BoundingVolumes::get_sphere(uint32_t index) const {
+    return glm::vec4(center_x[index], center_y[index], center_z[index], radius[index]);
+}
+
+uint32_t BoundingVolumes::cull_spheres(const glm::vec4 *planes, uint32_t *visible) const {
+    simd_planes_t splatted = splat_planes(planes);
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < count; i += BLOCK) {
+        /*Two independent groups per iteration keep both halves of the pipeline busy*/
+        int outside = spheres_outside(splatted, center_x.data(), center_y.data(), center_z.data(), radius.data(), i)
+                      | spheres_outside(splatted, center_x.data(), center_y.data(), center_z.data(), radius.data(), i + 4) << 4;
+        written = emit_visible(~static_cast<uint32_t>(outside) & block_mask(i, count), i, visible, written);
+    }
+    return written;
+}
+
+uint32_t BoundingVolumes::cull_boxes(const glm::vec4 *planes, uint32_t *visible) const {
+    simd_planes_t splatted = splat_planes(planes);
+    /*The corner farthest along each plane's normal only depends on the normal's signs*/
+    const float* corners[6][3];
+    for (int p = 0; p < 6; ++p) {
+        corners[p][0] = planes[p].x >= 0.0f ? max_x.data() : min_x.data();
+        corners[p][1] = planes[p].y >= 0.0f ? max_y.data() : min_y.data();
+        corners[p][2] = planes[p].z >= 0.0f ? max_z.data() : min_z.data();
+    }
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < count; i += BLOCK) {
+        int outside = boxes_outside(splatted, corners, i) | boxes_outside(splatted, corners, i + 4) << 4;
+        written = emit_visible(~static_cast<uint32_t>(outside) & block_mask(i, count), i, visible, written);
+    }
+    return written;
+}
+
+bounds_benchmark_t benchmark_bounds_culling(uint32_t count, uint32_t repeats) {
+    /*Objects scattered through a 200 unit cube around a camera looking down -z, about a tenth of them in view*/
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> half_extent(0.1f, 2.0f);
+    std::vector<glm::vec4> spheres(count);
+    BoundingVolumes volumes;
+    volumes.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extent(half_extent(random), half_extent(random), half_extent(random));
+        volumes.add(center - extent, center + extent);
+        spheres[i] = volumes.get_sphere(i);
+    }
+    /*OpenGL depth range to Vulkan's*/
+    glm::mat4 clip(1.0f);
+    clip[2][2] = 0.5f;
+    clip[3][2] = 0.5f;
+    glm::mat4 view_proj = clip * glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+                          * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    extract_frustum_planes(view_proj, planes);
+
+    std::vector<uint32_t> visible(count);
+    bounds_benchmark_t result{};
+    result.objects = count;
+    repeats = std::max(repeats, 1u);
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < repeats; ++i) {
+        result.scalar_visible = cull_spheres_scalar(spheres.data(), count, planes, visible.data());
+    }
+    auto scalar_end = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < repeats; ++i) {
+        result.sphere_visible = volumes.cull_spheres(planes, visible.data());
+    }
+    auto sphere_end = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < repeats; ++i) {
+        result.box_visible = volumes.cull_boxes(planes, visible.data());
+    }
+    auto box_end = std::chrono::steady_clock::now();
+    result.scalar_ms = std::chrono::duration<double, std::milli>(scalar_end - begin).count() / repeats;
+    result.sphere_ms = std::chrono::duration<double, std::milli>(sphere_end - scalar_end).count() / repeats;
+    result.box_ms = std::chrono::duration<double, std::milli>(box_end - sphere_end).count() / repeats;
+    return result;
+}
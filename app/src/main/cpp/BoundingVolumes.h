@@ -0,0 +1,76 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_BOUNDINGVOLUMES_H
+#define HELLO_VULKAN_BOUNDINGVOLUMES_H
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+/*Left, right, bottom, top, near, far planes of a Vulkan clip space (0 <= z <= w) matrix, normalized*/
+void extract_frustum_planes(const glm::mat4& view_proj, glm::vec4 planes[6]);
+
+/*
+ * Reference loop over spheres (center, radius) one at a time: writes the indices of the
+ * ones intersecting the frustum in ascending order and returns how many there are.
+ */
+uint32_t cull_spheres_scalar(const glm::vec4* spheres, uint32_t count, const glm::vec4 planes[6], uint32_t* visible);
+
+/*
+ * Bounding spheres and axis aligned boxes of many objects as a struct of arrays, one
+ * array per component, so the culling kernels load four objects per register straight
+ * from memory (see Simd.h). Arrays are padded to BLOCK objects with empty volumes that
+ * are never reported.
+ */
+class BoundingVolumes {
+private:
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> min_z;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+    std::vector<float> max_z;
+    uint32_t count = 0;
+    void resize_storage(size_t size);
+public:
+    /*Objects tested per loop iteration, two groups of four lanes*/
+    static constexpr uint32_t BLOCK = 8;
+    void clear();
+    void reserve(uint32_t capacity);
+    /*Returns the new object's index*/
+    uint32_t add(const glm::vec4& sphere, const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+    /*With the sphere enclosing the box*/
+    uint32_t add(const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+    void set(uint32_t index, const glm::vec4& sphere, const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+    uint32_t size() const;
+    glm::vec4 get_sphere(uint32_t index) const;
+    /*
+     * Both write the indices of the objects intersecting the frustum in ascending order to
+     * visible, which needs room for size() entries, and return how many there are.
+     */
+    uint32_t cull_spheres(const glm::vec4 planes[6], uint32_t* visible) const;
+    /*Tests each plane's farthest box corner; boxes near a frustum corner may be kept though outside*/
+    uint32_t cull_boxes(const glm::vec4 planes[6], uint32_t* visible) const;
+};
+
+struct bounds_benchmark_t {
+    uint32_t objects;
+    /*Average time of one pass over every object*/
+    double scalar_ms;
+    double sphere_ms;
+    double box_ms;
+    uint32_t scalar_visible;
+    uint32_t sphere_visible;
+    uint32_t box_visible;
+};
+
+/*Times the scalar loop and both kernels on count random objects around a camera, averaged over repeats*/
+bounds_benchmark_t benchmark_bounds_culling(uint32_t count, uint32_t repeats);
+
+
+#endif //HELLO_VULKAN_BOUNDINGVOLUMES_H
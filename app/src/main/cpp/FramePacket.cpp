@@ -0,0 +1,85 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <thread>
+#include "FramePacket.h"
+
+/*Stands in for a stage's CPU work*/
+static void spin_for(std::chrono::microseconds duration) {
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+frame_packet_t& FramePacketBuffer::write_packet() {
+    return packets[back];
+}
+
+void FramePacketBuffer::publish() {
+    uint32_t cur = middle.load(std::memory_order_relaxed);
+    while (!middle.compare_exchange_weak(cur, back | FRESH_BIT | (cur & STOP_BIT), std::memory_order_acq_rel)) {}
+    back = cur & INDEX_MASK;
+    middle.notify_all();
+}
+
+bool FramePacketBuffer::wait_consumed() {
+    uint32_t cur = middle.load(std::memory_order_acquire);
+    while ((cur & FRESH_BIT) && !(cur & STOP_BIT)) {
+        middle.wait(cur);
+        cur = middle.load(std::memory_order_acquire);
+    }
+    return !(cur & STOP_BIT);
+}
+
+const frame_packet_t* FramePacketBuffer::acquire() {
+    uint32_t cur = middle.load(std::memory_order_acquire);
+    for (;;) {
+        if (cur & STOP_BIT) return nullptr;
+        if (!(cur & FRESH_BIT)) {
+            middle.wait(cur);
+            cur = middle.load(std::memory_order_acquire);
+            continue;
+        }
+        if (middle.compare_exchange_weak(cur, front, std::memory_order_acq_rel)) break;
+    }
+    front = cur & INDEX_MASK;
+    middle.notify_all();
+    return &packets[front];
+}
+
+void FramePacketBuffer::stop() {
+    middle.fetch_or(STOP_BIT);
+    middle.notify_all();
+}
+
+frame_pipeline_benchmark_t benchmark_frame_pipeline(std::chrono::microseconds update, std::chrono::microseconds draw, uint32_t frames) {
+    frame_pipeline_benchmark_t result{};
+    result.frames = std::max(frames, 1u);
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < result.frames; ++i) {
+        spin_for(update);
+        spin_for(draw);
+    }
+    auto serial_end = std::chrono::steady_clock::now();
+    /*Same hand-off as the renderer's update and render threads*/
+    FramePacketBuffer packets;
+    std::thread writer([&packets, update, count = result.frames]() {
+        for (uint32_t i = 0; i < count; ++i) {
+            frame_packet_t& packet = packets.write_packet();
+            spin_for(update);
+            packet.frame = i;
+            packets.publish();
+            if (!packets.wait_consumed()) break;
+        }
+    });
+    while (const frame_packet_t* packet = packets.acquire()) {
+        spin_for(draw);
+        if (packet->frame + 1 == result.frames) break;
+    }
+    writer.join();
+    auto pipelined_end = std::chrono::steady_clock::now();
+    result.serial_ms = std::chrono::duration<double, std::milli>(serial_end - begin).count() / result.frames;
+    result.pipelined_ms = std::chrono::duration<double, std::milli>(pipelined_end - serial_end).count() / result.frames;
+    return result;
+}
@@ -0,0 +1,86 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_FRAMEPACKET_H
+#define HELLO_VULKAN_FRAMEPACKET_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "RenderCommandQueue.h"
+
+/*Per-frame uniforms, bound once per frame*/
+struct UBO {
+    glm::mat4 view_proj;
+};
+
+/*Per-item data, combined with each primitive of the scene into one draw_data_t of the draw list*/
+struct draw_constants_t {
+    glm::mat4 model;
+    glm::vec4 tint;
+    uint32_t material;
+};
+
+struct draw_item_t {
+    draw_constants_t constants;
+    /*shader_permutation_t bits of the material*/
+    uint32_t permutation;
+    raster_state_t raster;
+};
+
+/*
+ * Everything the render thread needs to record one frame. Produced by the update
+ * thread and immutable once published.
+ */
+struct frame_packet_t {
+    uint64_t frame;
+    uint32_t dirty;
+    float time;
+    /*CPU time the update thread spent on this packet, summed by the render thread*/
+    std::chrono::steady_clock::duration update_time;
+    glm::mat4 view_proj;
+    UBO uniforms;
+    std::vector<draw_item_t> draws;
+    /*Commands that have to run on the render thread (surface, resources)*/
+    std::vector<render_command_t> commands;
+};
+
+/*
+ * Triple buffer between one writer (update thread) and one reader (render thread).
+ * The writer fills packet N+1 while the reader records packet N; the third slot is
+ * the hand-off so neither side ever touches a packet the other one owns.
+ */
+class FramePacketBuffer {
+private:
+    static constexpr uint32_t INDEX_MASK = 0x3;
+    static constexpr uint32_t FRESH_BIT = 0x4;
+    static constexpr uint32_t STOP_BIT = 0x8;
+    frame_packet_t packets[3];
+    uint32_t back = 0;
+    uint32_t front = 1;
+    std::atomic<uint32_t> middle{2};
+public:
+    frame_packet_t& write_packet();
+    void publish();
+    /*Blocks the writer until the last published packet was picked up. False once stopped*/
+    bool wait_consumed();
+    /*Blocks the reader until a new packet is published. Null once stopped*/
+    const frame_packet_t* acquire();
+    void stop();
+};
+
+struct frame_pipeline_benchmark_t {
+    uint32_t frames;
+    /*Per frame, update and draw one after the other on one thread*/
+    double serial_ms;
+    /*Per frame, update on a second thread handing packets over through a FramePacketBuffer*/
+    double pipelined_ms;
+};
+
+/*Frame throughput with and without the update/draw split, both stages spinning for the given CPU time*/
+frame_pipeline_benchmark_t benchmark_frame_pipeline(std::chrono::microseconds update, std::chrono::microseconds draw, uint32_t frames);
+
+
+#endif //HELLO_VULKAN_FRAMEPACKET_H
@@ -0,0 +1,671 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "GltfLoader.h"
+#include "Log.h"
+
+static const char* TAG = "GltfLoader";
+
+namespace {
+    constexpr uint32_t GLB_MAGIC = 0x46546C67;
+    constexpr uint32_t GLB_VERSION = 2;
+    constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+    constexpr uint32_t CHUNK_BIN = 0x004E4942;
+    constexpr uint32_t MAX_JSON_DEPTH = 64;
+
+    /*Accessor component types*/
+    constexpr uint32_t COMPONENT_BYTE = 5120;
+    constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+    constexpr uint32_t COMPONENT_SHORT = 5122;
+    constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+    constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+    constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+    constexpr uint32_t MODE_TRIANGLES = 4;
+    /*Primitives converted per job*/
+    constexpr uint32_t DECODE_BATCH = 4;
+
+    struct json_value_t {
+        enum class type_t : uint8_t {
+            NUL,
+            BOOLEAN,
+            NUMBER,
+            STRING,
+            ARRAY,
+            OBJECT
+        };
+        type_t type = type_t::NUL;
+        bool boolean = false;
+        double number = 0.0;
+        /*Raw contents between the quotes, escapes are kept as written*/
+        std::string_view string;
+        std::vector<json_value_t> elements;
+        std::vector<std::pair<std::string_view, json_value_t>> members;
+
+        const json_value_t* find(std::string_view key) const {
+            for (const auto& member: members) {
+                if (member.first == key) return &member.second;
+            }
+            return nullptr;
+        }
+    };
+
+    /*Recursive descent over a null terminated copy of the JSON chunk*/
+    class JsonParser {
+    private:
+        const char* cursor;
+        const char* end;
+        void skip_whitespace() {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) ++cursor;
+        }
+        void expect(char c) {
+            skip_whitespace();
+            if (cursor >= end || *cursor != c) {
+                throw std::runtime_error("Malformed glTF JSON!");
+            }
+            ++cursor;
+        }
+        bool consume(const char* literal) {
+            size_t length = strlen(literal);
+            if (static_cast<size_t>(end - cursor) < length || memcmp(cursor, literal, length) != 0) return false;
+            cursor += length;
+            return true;
+        }
+        bool consume_separator() {
+            skip_whitespace();
+            if (cursor < end && *cursor == ',') {
+                ++cursor;
+                return true;
+            }
+            return false;
+        }
+        std::string_view parse_string() {
+            expect('"');
+            const char* begin = cursor;
+            while (cursor < end && *cursor != '"') {
+                if (*cursor == '\\') ++cursor;
+                ++cursor;
+            }
+            if (cursor >= end) {
+                throw std::runtime_error("Unterminated glTF JSON string!");
+            }
+            std::string_view value(begin, cursor - begin);
+            ++cursor;
+            return value;
+        }
+        void parse_value(json_value_t& value, uint32_t depth) {
+            if (depth > MAX_JSON_DEPTH) {
+                throw std::runtime_error("glTF JSON is nested too deeply!");
+            }
+            skip_whitespace();
+            if (cursor >= end) {
+                throw std::runtime_error("Malformed glTF JSON!");
+            }
+            switch (*cursor) {
+                case '{':
+                    value.type = json_value_t::type_t::OBJECT;
+                    ++cursor;
+                    skip_whitespace();
+                    if (cursor < end && *cursor == '}') {
+                        ++cursor;
+                        return;
+                    }
+                    do {
+                        std::string_view key = parse_string();
+                        expect(':');
+                        value.members.emplace_back(key, json_value_t{});
+                        parse_value(value.members.back().second, depth + 1);
+                    } while (consume_separator());
+                    expect('}');
+                    return;
+                case '[':
+                    value.type = json_value_t::type_t::ARRAY;
+                    ++cursor;
+                    skip_whitespace();
+                    if (cursor < end && *cursor == ']') {
+                        ++cursor;
+                        return;
+                    }
+                    do {
+                        value.elements.emplace_back();
+                        parse_value(value.elements.back(), depth + 1);
+                    } while (consume_separator());
+                    expect(']');
+                    return;
+                case '"':
+                    value.type = json_value_t::type_t::STRING;
+                    value.string = parse_string();
+                    return;
+                default:
+                    break;
+            }
+            if (consume("true") || consume("false")) {
+                value.type = json_value_t::type_t::BOOLEAN;
+                /*Both literals end in 'e', only true has a 'u' before it*/
+                value.boolean = cursor[-2] == 'u';
+                return;
+            }
+            if (consume("null")) {
+                value.type = json_value_t::type_t::NUL;
+                return;
+            }
+            if (*cursor != '-' && (*cursor < '0' || *cursor > '9')) {
+                throw std::runtime_error("Malformed glTF JSON value!");
+            }
+            char* number_end = nullptr;
+            value.number = strtod(cursor, &number_end);
+            if (number_end == cursor || number_end > end) {
+                throw std::runtime_error("Malformed glTF JSON value!");
+            }
+            value.type = json_value_t::type_t::NUMBER;
+            cursor = number_end;
+        }
+    public:
+        /*text must be null terminated at text + size*/
+        JsonParser(const char* text, size_t size): cursor(text), end(text + size) {}
+        void parse(json_value_t& root) {
+            parse_value(root, 0);
+            skip_whitespace();
+            if (cursor != end) {
+                throw std::runtime_error("Trailing data after glTF JSON!");
+            }
+        }
+    };
+
+    const json_value_t* member(const json_value_t& object, std::string_view key, json_value_t::type_t type) {
+        const json_value_t* value = object.find(key);
+        return value && value->type == type ? value : nullptr;
+    }
+
+    const std::vector<json_value_t>& array_member(const json_value_t& object, std::string_view key) {
+        static const std::vector<json_value_t> empty;
+        const json_value_t* value = member(object, key, json_value_t::type_t::ARRAY);
+        return value ? value->elements : empty;
+    }
+
+    double number_member(const json_value_t& object, std::string_view key, double fallback) {
+        const json_value_t* value = member(object, key, json_value_t::type_t::NUMBER);
+        return value ? value->number : fallback;
+    }
+
+    /*Index into a top level array, -1 when absent; throws when out of range*/
+    int32_t index_member(const json_value_t& object, std::string_view key, size_t count) {
+        const json_value_t* value = member(object, key, json_value_t::type_t::NUMBER);
+        if (!value) return -1;
+        if (value->number < 0 || value->number >= static_cast<double>(count) || value->number != std::floor(value->number)) {
+            throw std::runtime_error("Invalid glTF index!");
+        }
+        return static_cast<int32_t>(value->number);
+    }
+
+    void float_array(const json_value_t& object, std::string_view key, float* out, uint32_t count) {
+        const std::vector<json_value_t>& values = array_member(object, key);
+        if (values.empty()) return;
+        if (values.size() != count) {
+            throw std::runtime_error("Invalid glTF vector!");
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            out[i] = static_cast<float>(values[i].number);
+        }
+    }
+
+    uint32_t component_size(uint32_t component_type) {
+        switch (component_type) {
+            case COMPONENT_BYTE:
+            case COMPONENT_UNSIGNED_BYTE:
+                return 1;
+            case COMPONENT_SHORT:
+            case COMPONENT_UNSIGNED_SHORT:
+                return 2;
+            case COMPONENT_UNSIGNED_INT:
+            case COMPONENT_FLOAT:
+                return 4;
+            default:
+                throw std::runtime_error("Unknown glTF component type!");
+        }
+    }
+
+    uint32_t component_count(std::string_view type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        throw std::runtime_error("Unsupported glTF accessor type!");
+    }
+
+    /*A validated accessor: every element lies inside the BIN chunk*/
+    struct accessor_t {
+        const uint8_t* data = nullptr;
+        uint32_t count = 0;
+        uint32_t stride = 0;
+        uint32_t component_type = 0;
+        uint32_t components = 0;
+        bool normalized = false;
+
+        float component(uint32_t element, uint32_t index) const {
+            const uint8_t* p = data + static_cast<size_t>(element) * stride;
+            switch (component_type) {
+                case COMPONENT_FLOAT: {
+                    float value;
+                    memcpy(&value, p + index * 4, 4);
+                    return value;
+                }
+                case COMPONENT_UNSIGNED_BYTE:
+                    return normalized ? p[index] / 255.0f : p[index];
+                case COMPONENT_BYTE: {
+                    float value = static_cast<int8_t>(p[index]);
+                    return normalized ? std::max(value / 127.0f, -1.0f) : value;
+                }
+                case COMPONENT_UNSIGNED_SHORT: {
+                    uint16_t value;
+                    memcpy(&value, p + index * 2, 2);
+                    return normalized ? value / 65535.0f : value;
+                }
+                case COMPONENT_SHORT: {
+                    int16_t value;
+                    memcpy(&value, p + index * 2, 2);
+                    return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+                }
+                default: {
+                    uint32_t value;
+                    memcpy(&value, p + index * 4, 4);
+                    return static_cast<float>(value);
+                }
+            }
+        }
+
+        uint32_t index(uint32_t element) const {
+            const uint8_t* p = data + static_cast<size_t>(element) * stride;
+            switch (component_type) {
+                case COMPONENT_UNSIGNED_BYTE:
+                    return *p;
+                case COMPONENT_UNSIGNED_SHORT: {
+                    uint16_t value;
+                    memcpy(&value, p, 2);
+                    return value;
+                }
+                default: {
+                    uint32_t value;
+                    memcpy(&value, p, 4);
+                    return value;
+                }
+            }
+        }
+    };
+
+    struct document_t {
+        json_value_t root;
+        const uint8_t* bin = nullptr;
+        size_t bin_size = 0;
+    };
+
+    accessor_t resolve_accessor(const document_t& document, int32_t index) {
+        const std::vector<json_value_t>& accessors = array_member(document.root, "accessors");
+        const json_value_t& json = accessors[index];
+        if (json.find("sparse")) {
+            throw std::runtime_error("Sparse glTF accessors are not supported!");
+        }
+        const json_value_t* type = member(json, "type", json_value_t::type_t::STRING);
+        if (!type) {
+            throw std::runtime_error("glTF accessor has no type!");
+        }
+        accessor_t accessor;
+        accessor.component_type = static_cast<uint32_t>(number_member(json, "componentType", 0));
+        accessor.components = component_count(type->string);
+        accessor.normalized = member(json, "normalized", json_value_t::type_t::BOOLEAN) && json.find("normalized")->boolean;
+        double count = number_member(json, "count", 0);
+        if (count < 1 || count > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("Invalid glTF accessor count!");
+        }
+        accessor.count = static_cast<uint32_t>(count);
+        uint32_t element_size = component_size(accessor.component_type) * accessor.components;
+
+        const std::vector<json_value_t>& views = array_member(document.root, "bufferViews");
+        int32_t view_index = index_member(json, "bufferView", views.size());
+        if (view_index < 0) {
+            throw std::runtime_error("glTF accessors without a buffer view are not supported!");
+        }
+        const json_value_t& view = views[view_index];
+        if (number_member(view, "buffer", -1) != 0 || !document.bin) {
+            throw std::runtime_error("glTF buffer views must point into the BIN chunk!");
+        }
+        double view_offset = number_member(view, "byteOffset", 0);
+        double view_length = number_member(view, "byteLength", 0);
+        double accessor_offset = number_member(json, "byteOffset", 0);
+        double stride = number_member(view, "byteStride", element_size);
+        if (view_offset < 0 || view_length < 0 || accessor_offset < 0 || stride < element_size || stride > 252
+            || view_offset + view_length > static_cast<double>(document.bin_size)
+            || accessor_offset + stride * (accessor.count - 1) + element_size > view_length) {
+            throw std::runtime_error("glTF accessor is out of bounds!");
+        }
+        accessor.stride = static_cast<uint32_t>(stride);
+        accessor.data = document.bin + static_cast<size_t>(view_offset) + static_cast<size_t>(accessor_offset);
+        return accessor;
+    }
+
+    /*Everything needed to convert one primitive, resolved and validated up front*/
+    struct primitive_job_t {
+        accessor_t position;
+        accessor_t normal;
+        accessor_t uv;
+        accessor_t indices;
+        bool has_normals;
+        bool has_uvs;
+        bool has_indices;
+    };
+
+    void decode_primitive(const primitive_job_t& job, mesh_primitive_t& primitive, mesh_vertex_t* vertices, uint32_t* indices,
+                          std::atomic<bool>& failed) {
+        glm::vec3 bounds_min(std::numeric_limits<float>::max());
+        glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+        for (uint32_t i = 0; i < primitive.vertex_count; ++i) {
+            mesh_vertex_t& vertex = vertices[i];
+            vertex.position = {job.position.component(i, 0), job.position.component(i, 1), job.position.component(i, 2)};
+            vertex.normal = job.has_normals
+                            ? glm::vec3(job.normal.component(i, 0), job.normal.component(i, 1), job.normal.component(i, 2))
+                            : glm::vec3(0.0f);
+            vertex.uv = job.has_uvs ? glm::vec2(job.uv.component(i, 0), job.uv.component(i, 1)) : glm::vec2(0.0f);
+            bounds_min = glm::min(bounds_min, vertex.position);
+            bounds_max = glm::max(bounds_max, vertex.position);
+        }
+        primitive.bounds_min = bounds_min;
+        primitive.bounds_max = bounds_max;
+        for (uint32_t i = 0; i < primitive.index_count; ++i) {
+            uint32_t index = job.has_indices ? job.indices.index(i) : i;
+            if (index >= primitive.vertex_count) {
+                /*Would read outside the primitive on the GPU*/
+                failed.store(true, std::memory_order_relaxed);
+                return;
+            }
+            indices[i] = index;
+        }
+        if (job.has_normals) return;
+        /*Area weighted smooth normals*/
+        for (uint32_t i = 0; i + 2 < primitive.index_count; i += 3) {
+            mesh_vertex_t& a = vertices[indices[i]];
+            mesh_vertex_t& b = vertices[indices[i + 1]];
+            mesh_vertex_t& c = vertices[indices[i + 2]];
+            glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+            a.normal += normal;
+            b.normal += normal;
+            c.normal += normal;
+        }
+        for (uint32_t i = 0; i < primitive.vertex_count; ++i) {
+            float length = glm::length(vertices[i].normal);
+            vertices[i].normal = length > 0.0f ? vertices[i].normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    glm::mat4 node_transform(const json_value_t& node) {
+        glm::mat4 transform(1.0f);
+        if (member(node, "matrix", json_value_t::type_t::ARRAY)) {
+            /*Column major like glm*/
+            float matrix[16];
+            float_array(node, "matrix", matrix, 16);
+            return glm::make_mat4(matrix);
+        }
+        float translation[3] = {0.0f, 0.0f, 0.0f};
+        float rotation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        float scale[3] = {1.0f, 1.0f, 1.0f};
+        float_array(node, "translation", translation, 3);
+        float_array(node, "rotation", rotation, 4);
+        float_array(node, "scale", scale, 3);
+        transform = glm::translate(transform, glm::make_vec3(translation));
+        transform *= glm::mat4_cast(glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]));
+        return glm::scale(transform, glm::make_vec3(scale));
+    }
+
+    void load_materials(const document_t& document, mesh_scene_t& scene) {
+        for (const json_value_t& json: array_member(document.root, "materials")) {
+            mesh_material_t material{};
+            material.base_color = glm::vec4(1.0f);
+            material.base_color_texture = -1;
+            material.alpha_cutoff = static_cast<float>(number_member(json, "alphaCutoff", 0.5));
+            material.alpha_mode = mesh_alpha_mode_t::OPAQUE;
+            if (const json_value_t* pbr = member(json, "pbrMetallicRoughness", json_value_t::type_t::OBJECT)) {
+                float_array(*pbr, "baseColorFactor", glm::value_ptr(material.base_color), 4);
+                if (const json_value_t* texture = member(*pbr, "baseColorTexture", json_value_t::type_t::OBJECT)) {
+                    material.base_color_texture = index_member(*texture, "index", array_member(document.root, "textures").size());
+                }
+            }
+            if (const json_value_t* mode = member(json, "alphaMode", json_value_t::type_t::STRING)) {
+                if (mode->string == "MASK") material.alpha_mode = mesh_alpha_mode_t::MASK;
+                if (mode->string == "BLEND") material.alpha_mode = mesh_alpha_mode_t::BLEND;
+            }
+            const json_value_t* double_sided = member(json, "doubleSided", json_value_t::type_t::BOOLEAN);
+            material.double_sided = double_sided && double_sided->boolean;
+            scene.materials.push_back(material);
+        }
+    }
+
+    /*Lays out every primitive in the packed arrays; returns what the decode pass needs*/
+    std::vector<primitive_job_t> layout_meshes(const document_t& document, mesh_scene_t& scene) {
+        std::vector<primitive_job_t> jobs;
+        size_t accessor_count = array_member(document.root, "accessors").size();
+        uint32_t default_material = UINT32_MAX;
+        uint64_t vertex_count = 0;
+        uint64_t index_count = 0;
+        for (const json_value_t& mesh: array_member(document.root, "meshes")) {
+            mesh_t packed{static_cast<uint32_t>(scene.primitives.size()), 0};
+            for (const json_value_t& json: array_member(mesh, "primitives")) {
+                if (number_member(json, "mode", MODE_TRIANGLES) != MODE_TRIANGLES) {
+                    LOGW(TAG, "Skipping a primitive that is not a triangle list");
+                    continue;
+                }
+                const json_value_t* attributes = member(json, "attributes", json_value_t::type_t::OBJECT);
+                int32_t position = attributes ? index_member(*attributes, "POSITION", accessor_count) : -1;
+                if (position < 0) {
+                    LOGW(TAG, "Skipping a primitive without positions");
+                    continue;
+                }
+                primitive_job_t job{};
+                job.position = resolve_accessor(document, position);
+                if (job.position.components != 3) {
+                    throw std::runtime_error("glTF positions must be VEC3!");
+                }
+                int32_t normal = index_member(*attributes, "NORMAL", accessor_count);
+                int32_t uv = index_member(*attributes, "TEXCOORD_0", accessor_count);
+                int32_t indices = index_member(json, "indices", accessor_count);
+                if (normal >= 0) {
+                    job.normal = resolve_accessor(document, normal);
+                    job.has_normals = job.normal.components == 3 && job.normal.count >= job.position.count;
+                }
+                if (uv >= 0) {
+                    job.uv = resolve_accessor(document, uv);
+                    job.has_uvs = job.uv.components == 2 && job.uv.count >= job.position.count;
+                }
+                mesh_primitive_t primitive{};
+                primitive.vertex_count = job.position.count;
+                primitive.index_count = job.position.count;
+                if (indices >= 0) {
+                    job.indices = resolve_accessor(document, indices);
+                    if (job.indices.components != 1 || (job.indices.component_type != COMPONENT_UNSIGNED_BYTE
+                        && job.indices.component_type != COMPONENT_UNSIGNED_SHORT && job.indices.component_type != COMPONENT_UNSIGNED_INT)) {
+                        throw std::runtime_error("Invalid glTF index accessor!");
+                    }
+                    job.has_indices = true;
+                    primitive.index_count = job.indices.count;
+                }
+                /*Incomplete triangles are dropped*/
+                primitive.index_count -= primitive.index_count % 3;
+                if (primitive.index_count == 0) continue;
+                if (vertex_count + primitive.vertex_count > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())
+                    || index_count + primitive.index_count > std::numeric_limits<uint32_t>::max()) {
+                    throw std::runtime_error("glTF scene is too large!");
+                }
+                primitive.vertex_offset = static_cast<int32_t>(vertex_count);
+                primitive.first_index = static_cast<uint32_t>(index_count);
+                vertex_count += primitive.vertex_count;
+                index_count += primitive.index_count;
+
+                int32_t material = index_member(json, "material", scene.materials.size());
+                if (material < 0) {
+                    if (default_material == UINT32_MAX) {
+                        default_material = static_cast<uint32_t>(scene.materials.size());
+                        scene.materials.push_back({glm::vec4(1.0f), -1, 0.5f, mesh_alpha_mode_t::OPAQUE, false});
+                    }
+                    material = static_cast<int32_t>(default_material);
+                }
+                primitive.material = static_cast<uint32_t>(material);
+                scene.primitives.push_back(primitive);
+                jobs.push_back(job);
+                ++packed.primitive_count;
+            }
+            scene.meshes.push_back(packed);
+        }
+        scene.vertices.resize(vertex_count);
+        scene.indices.resize(index_count);
+        return jobs;
+    }
+
+    void load_nodes(const document_t& document, mesh_scene_t& scene) {
+        const std::vector<json_value_t>& nodes = array_member(document.root, "nodes");
+        const std::vector<json_value_t>& scenes = array_member(document.root, "scenes");
+        /*Without scenes nothing is meant to be displayed*/
+        if (scenes.empty()) return;
+        int32_t scene_index = index_member(document.root, "scene", scenes.size());
+        const json_value_t& roots = scenes[scene_index < 0 ? 0 : scene_index];
+
+        /*Depth first so parents always precede their children; visited guards against cycles*/
+        std::vector<uint8_t> visited(nodes.size(), 0);
+        std::vector<std::pair<int32_t, int32_t>> stack;
+        const std::vector<json_value_t>& root_nodes = array_member(roots, "nodes");
+        for (auto it = root_nodes.rbegin(); it != root_nodes.rend(); ++it) {
+            if (it->type != json_value_t::type_t::NUMBER || it->number < 0 || it->number >= static_cast<double>(nodes.size())) {
+                throw std::runtime_error("Invalid glTF scene node!");
+            }
+            stack.emplace_back(static_cast<int32_t>(it->number), -1);
+        }
+        while (!stack.empty()) {
+            auto [index, parent] = stack.back();
+            stack.pop_back();
+            if (visited[index]) {
+                throw std::runtime_error("glTF node hierarchy is not a tree!");
+            }
+            visited[index] = 1;
+            const json_value_t& json = nodes[index];
+            mesh_node_t node{};
+            node.local = node_transform(json);
+            node.world = parent < 0 ? node.local : scene.nodes[parent].world * node.local;
+            node.parent = parent;
+            node.mesh = index_member(json, "mesh", scene.meshes.size());
+            scene.nodes.push_back(node);
+            int32_t packed = static_cast<int32_t>(scene.nodes.size() - 1);
+            const std::vector<json_value_t>& children = array_member(json, "children");
+            for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                if (it->type != json_value_t::type_t::NUMBER || it->number < 0 || it->number >= static_cast<double>(nodes.size())) {
+                    throw std::runtime_error("Invalid glTF child node!");
+                }
+                stack.emplace_back(static_cast<int32_t>(it->number), packed);
+            }
+        }
+    }
+}
+
+mesh_scene_t load_glb(const uint8_t *data, size_t size, JobSystem *jobs, gltf_load_stats_t *stats) {
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t header[3];
+    if (size < sizeof(header) + 8) {
+        throw std::runtime_error("File is too small for a glTF binary!");
+    }
+    memcpy(header, data, sizeof(header));
+    if (header[0] != GLB_MAGIC || header[1] != GLB_VERSION || header[2] > size) {
+        throw std::runtime_error("Not a glTF 2.0 binary!");
+    }
+    size = header[2];
+
+    document_t document;
+    std::string json;
+    size_t offset = sizeof(header);
+    while (offset + 8 <= size) {
+        uint32_t chunk[2];
+        memcpy(chunk, data + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if (chunk[0] > size - offset) {
+            throw std::runtime_error("glTF chunk is out of bounds!");
+        }
+        if (chunk[1] == CHUNK_JSON && json.empty()) {
+            json.assign(reinterpret_cast<const char*>(data + offset), chunk[0]);
+        } else if (chunk[1] == CHUNK_BIN && !document.bin) {
+            document.bin = data + offset;
+            document.bin_size = chunk[0];
+        }
+        /*Chunks are 4 byte aligned*/
+        offset += (static_cast<size_t>(chunk[0]) + 3) & ~static_cast<size_t>(3);
+    }
+    if (json.empty()) {
+        throw std::runtime_error("glTF binary has no JSON chunk!");
+    }
+    JsonParser(json.c_str(), json.size()).parse(document.root);
+    if (document.root.type != json_value_t::type_t::OBJECT) {
+        throw std::runtime_error("glTF JSON is not an object!");
+    }
+
+    mesh_scene_t scene;
+    load_materials(document, scene);
+    std::vector<primitive_job_t> primitive_jobs = layout_meshes(document, scene);
+    load_nodes(document, scene);
+    auto parsed = std::chrono::steady_clock::now();
+
+    std::atomic<bool> failed{false};
+    auto decode = [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; ++i) {
+            mesh_primitive_t& primitive = scene.primitives[i];
+            decode_primitive(primitive_jobs[i], primitive, &scene.vertices[primitive.vertex_offset],
+                             &scene.indices[primitive.first_index], failed);
+        }
+    };
+    uint32_t count = static_cast<uint32_t>(primitive_jobs.size());
+    if (jobs) {
+        jobs->wait(jobs->parallel_for(count, DECODE_BATCH, decode));
+    } else {
+        decode(0, count);
+    }
+    if (failed.load()) {
+        throw std::runtime_error("glTF index is out of range!");
+    }
+    auto decoded = std::chrono::steady_clock::now();
+
+    if (stats) {
+        stats->parse_ms = std::chrono::duration<double, std::milli>(parsed - begin).count();
+        stats->decode_ms = std::chrono::duration<double, std::milli>(decoded - parsed).count();
+        stats->file_bytes = size;
+        stats->triangles = scene.indices.size() / 3;
+    }
+    return scene;
+}
+
+mesh_scene_t load_glb_file(const char *path, JobSystem *jobs, gltf_load_stats_t *stats) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(fopen(path, "rb"), &fclose);
+    if (!file) {
+        throw std::runtime_error("Unable to open glTF file!");
+    }
+    if (fseek(file.get(), 0, SEEK_END) != 0) {
+        throw std::runtime_error("Unable to read glTF file!");
+    }
+    long size = ftell(file.get());
+    if (size <= 0 || fseek(file.get(), 0, SEEK_SET) != 0) {
+        throw std::runtime_error("Unable to read glTF file!");
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    if (fread(data.data(), 1, data.size(), file.get()) != data.size()) {
+        throw std::runtime_error("Unable to read glTF file!");
+    }
+    return load_glb(data.data(), data.size(), jobs, stats);
+}
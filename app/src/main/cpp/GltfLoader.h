@@ -0,0 +1,32 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_GLTFLOADER_H
+#define HELLO_VULKAN_GLTFLOADER_H
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.h"
+#include "JobSystem.h"
+
+struct gltf_load_stats_t {
+    /*Container and JSON parsing, accessor validation and layout*/
+    double parse_ms;
+    /*Attribute and index conversion into the packed arrays*/
+    double decode_ms;
+    uint64_t file_bytes;
+    uint64_t triangles;
+};
+
+/*
+ * Loads a binary glTF 2.0 (.glb) file: triangle primitives of every mesh, their
+ * materials and the node hierarchy of the default scene. Buffers must live in the
+ * BIN chunk, external URIs, sparse accessors and non-triangle modes are not supported.
+ * Primitives are converted in parallel on jobs when given. Throws std::runtime_error
+ * on malformed input, including indices outside their primitive.
+ */
+mesh_scene_t load_glb(const uint8_t* data, size_t size, JobSystem* jobs = nullptr, gltf_load_stats_t* stats = nullptr);
+mesh_scene_t load_glb_file(const char* path, JobSystem* jobs = nullptr, gltf_load_stats_t* stats = nullptr);
+
+
+#endif //HELLO_VULKAN_GLTFLOADER_H
@@ -0,0 +1,372 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <chrono>
+#include "JobSystem.h"
+#include "Log.h"
+
+static const char* TAG = "JobSystem";
+
+/*Jobs are recycled from a ring per worker and one for the other threads, neither may have more jobs than this in flight*/
+static constexpr uint32_t JOB_RING_SIZE = 4096;
+static constexpr uint32_t IDLE_SPINS = 64;
+
+static thread_local JobSystem* tls_owner = nullptr;
+static thread_local uint32_t tls_worker = 0;
+static thread_local uint32_t tls_random = 0x9E3779B9u;
+
+/*Children per round of the spawn and steal benchmarks, well within a worker's job ring*/
+static constexpr uint32_t BENCHMARK_BATCH = 1024;
+static constexpr uint32_t PARALLEL_FOR_ELEMENTS = 1 << 22;
+static std::atomic<uint32_t> benchmark_sink{0};
+
+static uint32_t next_random() {
+    tls_random ^= tls_random << 13;
+    tls_random ^= tls_random >> 17;
+    tls_random ^= tls_random << 5;
+    return tls_random;
+}
+
+bool JobDeque::push(job_t *job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) {
+        return false;
+    }
+    jobs[b & MASK].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+job_t* JobDeque::pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+        /*Empty*/
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    job_t* job = jobs[b & MASK].load(std::memory_order_relaxed);
+    if (t == b) {
+        /*Last element, race against thieves*/
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+job_t* JobDeque::steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    job_t* job = jobs[t & MASK].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem::JobSystem(uint32_t worker_count) {
+    if (worker_count == 0) {
+        /*hardware_concurrency() is 0 when unknown*/
+        worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    workers.reserve(worker_count);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back(std::make_unique<worker_t>());
+        workers[i]->ring = std::make_unique<job_t[]>(JOB_RING_SIZE);
+    }
+    external_ring = std::make_unique<job_t[]>(JOB_RING_SIZE);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        workers[i]->thread = std::thread(&JobSystem::worker_main, this, i);
+    }
+    LOGI(TAG, "Started %u workers", worker_count);
+}
+
+JobSystem::~JobSystem() {
+    running = false;
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        sleep_cond.notify_all();
+    }
+    for (auto& worker: workers) {
+        worker->thread.join();
+    }
+}
+
+void JobSystem::worker_main(uint32_t index) {
+    tls_owner = this;
+    tls_worker = index;
+    tls_random += index * 0x6C8E9CF5u;
+    uint32_t idle = 0;
+    while (running) {
+        job_t* job = get_job();
+        if (job != nullptr) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        sleepers++;
+        sleep_cond.wait(guard, [this]() { return !running || pending.load() > 0; });
+        sleepers--;
+        idle = 0;
+    }
+}
+
+job_t* JobSystem::allocate() {
+    job_t* job;
+    if (tls_owner == this) {
+        worker_t& worker = *workers[tls_worker];
+        job = &worker.ring[worker.ring_index++ & (JOB_RING_SIZE - 1)];
+    } else {
+        job = &external_ring[external_ring_index.fetch_add(1, std::memory_order_relaxed) & (JOB_RING_SIZE - 1)];
+    }
+    if (job->unfinished.load(std::memory_order_acquire) != 0) {
+        throw std::runtime_error("Too many jobs in flight!");
+    }
+    job->parent = nullptr;
+    job->unfinished.store(1, std::memory_order_relaxed);
+    job->continuation_count.store(0, std::memory_order_relaxed);
+    return job;
+}
+
+job_t* JobSystem::create_job(job_function_t function, const void *data, size_t size) {
+    if (size > sizeof(job_t::data)) {
+        throw std::invalid_argument("Job data is too large!");
+    }
+    job_t* job = allocate();
+    job->function = function;
+    if (size > 0) {
+        memcpy(job->data, data, size);
+    }
+    return job;
+}
+
+job_t* JobSystem::create_child(job_t *parent, job_function_t function, const void *data, size_t size) {
+    parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+    job_t* job = create_job(function, data, size);
+    job->parent = parent;
+    return job;
+}
+
+void JobSystem::add_continuation(job_t *job, job_t *continuation) {
+    uint32_t index = job->continuation_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_JOB_CONTINUATIONS) {
+        throw std::runtime_error("Too many job continuations!");
+    }
+    job->continuations[index] = continuation;
+}
+
+void JobSystem::run(job_t *job) {
+    pending.fetch_add(1);
+    if (tls_owner != this || !workers[tls_worker]->deque.push(job)) {
+        std::lock_guard<std::mutex> guard(injection_lock);
+        injection_queue.push_back(job);
+    }
+    wake();
+}
+
+void JobSystem::wake() {
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        sleep_cond.notify_one();
+    }
+}
+
+job_t* JobSystem::get_job() {
+    job_t* job = nullptr;
+    if (tls_owner == this) {
+        job = workers[tls_worker]->deque.pop();
+    }
+    if (job == nullptr) {
+        std::lock_guard<std::mutex> guard(injection_lock);
+        if (!injection_queue.empty()) {
+            job = injection_queue.front();
+            injection_queue.pop_front();
+        }
+    }
+    if (job == nullptr) {
+        job = steal_job(tls_owner == this ? tls_worker : UINT32_MAX);
+    }
+    if (job != nullptr) {
+        pending.fetch_sub(1);
+    }
+    return job;
+}
+
+job_t* JobSystem::steal_job(uint32_t self) {
+    uint32_t count = workers.size();
+    uint32_t start = next_random() % count;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t victim = (start + i) % count;
+        if (victim == self) continue;
+        job_t* job = workers[victim]->deque.steal();
+        if (job != nullptr) {
+            if (self != UINT32_MAX) {
+                workers[self]->stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(job_t *job) {
+    if (job->function != nullptr) {
+        job->function(job, job->data);
+    }
+    if (tls_owner == this) {
+        workers[tls_worker]->executed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        external_executed.fetch_add(1, std::memory_order_relaxed);
+    }
+    finish(job);
+}
+
+void JobSystem::finish(job_t *job) {
+    /*Read everything we need before the waiter is allowed to observe completion*/
+    job_t* parent = job->parent;
+    uint32_t count = std::min(job->continuation_count.load(std::memory_order_relaxed), MAX_JOB_CONTINUATIONS);
+    job_t* continuations[MAX_JOB_CONTINUATIONS];
+    for (uint32_t i = 0; i < count; ++i) {
+        continuations[i] = job->continuations[i];
+    }
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        run(continuations[i]);
+    }
+    if (parent != nullptr) {
+        finish(parent);
+    }
+}
+
+void JobSystem::wait(job_t *job) {
+    while (!is_finished(job)) {
+        job_t* next = get_job();
+        if (next != nullptr) {
+            execute(next);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::is_finished(const job_t *job) {
+    return job->unfinished.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t JobSystem::get_worker_count() {
+    return workers.size();
+}
+
+job_system_stats_t JobSystem::get_stats() {
+    job_system_stats_t stats{};
+    stats.executed = external_executed.load(std::memory_order_relaxed);
+    for (auto& worker: workers) {
+        stats.executed += worker->executed.load(std::memory_order_relaxed);
+        stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+
+struct benchmark_spawn_t {
+    JobSystem* system;
+    job_function_t child;
+    uint32_t count;
+};
+
+static void benchmark_empty(job_t* /*job*/, void* /*data*/) {
+}
+
+/*About a microsecond of dependent integer work*/
+static void benchmark_work(job_t* /*job*/, void* /*data*/) {
+    uint32_t value = 0x9E3779B9u;
+    for (int i = 0; i < 256; ++i) {
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+    }
+    benchmark_sink.fetch_add(value, std::memory_order_relaxed);
+}
+
+/*Runs on a worker, so every child lands on that worker's own deque*/
+static void benchmark_spawn(job_t* job, void* data) {
+    const benchmark_spawn_t* spawn = reinterpret_cast<const benchmark_spawn_t*>(data);
+    for (uint32_t i = 0; i < spawn->count; ++i) {
+        spawn->system->run(spawn->system->create_child(job, spawn->child));
+    }
+}
+
+/*Not JobSystem::wait(), which would run jobs on the calling thread as well*/
+static void benchmark_wait(JobSystem& system, job_t* job) {
+    while (!system.is_finished(job)) {
+        std::this_thread::yield();
+    }
+}
+
+/*Seconds for rounds of BENCHMARK_BATCH children of child*/
+static double benchmark_rounds(JobSystem& system, job_function_t child, uint32_t rounds) {
+    benchmark_spawn_t spawn{&system, child, BENCHMARK_BATCH};
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; ++i) {
+        job_t* root = system.create_job(benchmark_spawn, &spawn, sizeof(spawn));
+        system.run(root);
+        benchmark_wait(system, root);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+job_benchmark_t benchmark_jobs(uint32_t threads) {
+    constexpr uint32_t SPAWN_ROUNDS = 64;
+    constexpr uint32_t STEAL_ROUNDS = 16;
+    constexpr uint32_t PARALLEL_FOR_REPEATS = 8;
+    JobSystem system(std::max(threads, 1u));
+    job_benchmark_t result{};
+    result.threads = system.get_worker_count();
+    /*One untimed round starts every worker*/
+    benchmark_rounds(system, benchmark_empty, 1);
+    result.spawn_ns = benchmark_rounds(system, benchmark_empty, SPAWN_ROUNDS) * 1e9 / (SPAWN_ROUNDS * BENCHMARK_BATCH);
+
+    uint64_t stolen = system.get_stats().stolen;
+    result.steal_ms = benchmark_rounds(system, benchmark_work, STEAL_ROUNDS) * 1e3;
+    result.stolen = static_cast<double>(system.get_stats().stolen - stolen) / (STEAL_ROUNDS * BENCHMARK_BATCH);
+
+    std::vector<float> input(PARALLEL_FOR_ELEMENTS);
+    std::vector<float> output(PARALLEL_FOR_ELEMENTS);
+    for (uint32_t i = 0; i < PARALLEL_FOR_ELEMENTS; ++i) {
+        input[i] = static_cast<float>(i);
+    }
+    auto kernel = [&input, &output](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            float value = input[i];
+            for (int k = 0; k < 16; ++k) {
+                value = value * 0.999f + 0.5f;
+            }
+            output[i] = value;
+        }
+    };
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < PARALLEL_FOR_REPEATS; ++i) {
+        benchmark_wait(system, system.parallel_for(PARALLEL_FOR_ELEMENTS, 0, kernel));
+    }
+    result.parallel_for_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count()
+                             / PARALLEL_FOR_REPEATS;
+    return result;
+}
@@ -0,0 +1,154 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_JOBSYSTEM_H
+#define HELLO_VULKAN_JOBSYSTEM_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct job_t;
+typedef void (*job_function_t)(job_t* /*job*/, void* /*data*/);
+
+constexpr uint32_t MAX_JOB_CONTINUATIONS = 4;
+/*Keeps parallel_for well below the size of a job ring*/
+constexpr uint32_t MAX_PARALLEL_BATCHES = 1024;
+
+struct alignas(64) job_t {
+    job_function_t function;
+    job_t* parent;
+    /*The job itself plus every unfinished child*/
+    std::atomic<int32_t> unfinished;
+    std::atomic<uint32_t> continuation_count;
+    job_t* continuations[MAX_JOB_CONTINUATIONS];
+    /*Inline payload so spawning a job never touches the heap*/
+    unsigned char data[128 - sizeof(job_function_t) - sizeof(job_t*) - sizeof(std::atomic<int32_t>)
+                       - sizeof(std::atomic<uint32_t>) - sizeof(job_t*) * MAX_JOB_CONTINUATIONS];
+};
+
+struct job_system_stats_t {
+    uint64_t executed;
+    uint64_t stolen;
+};
+
+/*
+ * Chase-Lev work stealing deque. Only the owning worker calls push()/pop(),
+ * any thread may steal().
+ */
+class JobDeque {
+private:
+    static constexpr int64_t CAPACITY = 4096;
+    static constexpr int64_t MASK = CAPACITY - 1;
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<job_t*> jobs[CAPACITY];
+public:
+    bool push(job_t* job);
+    job_t* pop();
+    job_t* steal();
+};
+
+/*
+ * Work stealing job scheduler. Every worker owns a JobDeque, idle workers steal from
+ * random victims, and parents complete only after all children did. Threads that are
+ * not workers (UI, render thread) submit through a shared injection queue and help
+ * executing jobs while they wait(). Jobs live in rings owned by the system, so they stay
+ * valid until it is destroyed whichever thread created them.
+ */
+class JobSystem {
+private:
+    struct worker_t {
+        JobDeque deque;
+        std::thread thread;
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> stolen{0};
+        /*Jobs this worker creates, only it allocates from here*/
+        std::unique_ptr<job_t[]> ring;
+        uint32_t ring_index = 0;
+    };
+    std::vector<std::unique_ptr<worker_t>> workers;
+    /*Jobs created by threads that are not workers, shared between them*/
+    std::unique_ptr<job_t[]> external_ring;
+    std::atomic<uint32_t> external_ring_index{0};
+    std::mutex injection_lock;
+    std::deque<job_t*> injection_queue;
+    std::mutex sleep_lock;
+    std::condition_variable sleep_cond;
+    std::atomic<uint32_t> sleepers{0};
+    std::atomic<int64_t> pending{0};
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> external_executed{0};
+    void worker_main(uint32_t index);
+    job_t* allocate();
+    job_t* get_job();
+    job_t* steal_job(uint32_t self);
+    void execute(job_t* job);
+    void finish(job_t* job);
+    void wake();
+    template<typename F>
+    static void invoke(job_t* /*job*/, void* data) {
+        (*reinterpret_cast<F*>(data))();
+    }
+public:
+    explicit JobSystem(uint32_t worker_count = 0);
+    ~JobSystem();
+    job_t* create_job(job_function_t function, const void* data = nullptr, size_t size = 0);
+    job_t* create_child(job_t* parent, job_function_t function, const void* data = nullptr, size_t size = 0);
+    template<typename F>
+    job_t* create_job(F&& f, job_t* parent = nullptr) {
+        using functor_t = std::decay_t<F>;
+        static_assert(sizeof(functor_t) <= sizeof(job_t::data), "Job capture is too large!");
+        static_assert(std::is_trivially_destructible_v<functor_t>, "Job capture must be trivially destructible!");
+        job_t* job = parent ? create_child(parent, &invoke<functor_t>) : create_job(&invoke<functor_t>);
+        new (job->data) functor_t(std::forward<F>(f));
+        return job;
+    }
+    /*Runs f(begin, end) over [0, count) in batches; wait() on the returned job before f goes out of scope*/
+    template<typename F>
+    job_t* parallel_for(uint32_t count, uint32_t batch, const F& f) {
+        batch = std::max({batch, 1u, (count + MAX_PARALLEL_BATCHES - 1) / MAX_PARALLEL_BATCHES});
+        job_t* root = create_job(static_cast<job_function_t>(nullptr));
+        for (uint32_t begin = 0; begin < count; begin += batch) {
+            uint32_t end = std::min(count, begin + batch);
+            const F* fn = &f;
+            run(create_job([fn, begin, end]() { (*fn)(begin, end); }, root));
+        }
+        run(root);
+        return root;
+    }
+    /*Runs continuation once job and all its children completed. Must be called before run(job)*/
+    void add_continuation(job_t* job, job_t* continuation);
+    void run(job_t* job);
+    void wait(job_t* job);
+    bool is_finished(const job_t* job);
+    uint32_t get_worker_count();
+    job_system_stats_t get_stats();
+};
+
+struct job_benchmark_t {
+    uint32_t threads;
+    /*Empty jobs spawned from a job on a worker, wall time per job*/
+    double spawn_ns;
+    /*Jobs of about a microsecond all spawned on one worker, the others only get them by stealing*/
+    double steal_ms;
+    /*Share of those jobs that were stolen*/
+    double stolen;
+    /*parallel_for over a few million elements*/
+    double parallel_for_ms;
+};
+
+/*Runs each test on a job system of threads workers; the calling thread only waits*/
+job_benchmark_t benchmark_jobs(uint32_t threads);
+
+
+#endif //HELLO_VULKAN_JOBSYSTEM_H
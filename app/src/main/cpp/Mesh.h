@@ -0,0 +1,79 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_MESH_H
+#define HELLO_VULKAN_MESH_H
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+/*Interleaved vertex every mesh is converted to, matches the inputs of simple.vert*/
+struct mesh_vertex_t {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+static_assert(sizeof(mesh_vertex_t) == 32, "mesh_vertex_t must be tightly packed!");
+
+/*
+ * One indexed triangle list. Indices are relative to vertex_offset, so the primitive
+ * is drawn with vkCmdDrawIndexed(index_count, 1, first_index, vertex_offset, 0).
+ */
+struct mesh_primitive_t {
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t material;
+    /*Object space bounds*/
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+};
+
+struct mesh_t {
+    uint32_t first_primitive;
+    uint32_t primitive_count;
+};
+
+enum class mesh_alpha_mode_t : uint8_t {
+    OPAQUE,
+    MASK,
+    BLEND
+};
+
+struct mesh_material_t {
+    glm::vec4 base_color;
+    /*glTF texture index, -1 without a base color texture*/
+    int32_t base_color_texture;
+    float alpha_cutoff;
+    mesh_alpha_mode_t alpha_mode;
+    bool double_sided;
+};
+
+struct mesh_node_t {
+    glm::mat4 local;
+    /*local transform of every ancestor applied, parents come before their children*/
+    glm::mat4 world;
+    /*-1 for roots*/
+    int32_t parent;
+    /*-1 for nodes without geometry*/
+    int32_t mesh;
+};
+
+/*
+ * A whole scene packed for upload: the vertices of all primitives back to back in one
+ * array and their indices in another, so the GPU copy is a single staging pass.
+ */
+struct mesh_scene_t {
+    std::vector<mesh_vertex_t> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<mesh_primitive_t> primitives;
+    std::vector<mesh_t> meshes;
+    std::vector<mesh_material_t> materials;
+    std::vector<mesh_node_t> nodes;
+};
+
+
+#endif //HELLO_VULKAN_MESH_H
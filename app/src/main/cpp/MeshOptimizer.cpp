@@ -0,0 +1,478 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "MeshOptimizer.h"
+
+namespace {
+    /*Forsyth's tuned constants, independent of the cache the metrics simulate*/
+    constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+    constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+    constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+    constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+    struct forsyth_tables_t {
+        float cache[FORSYTH_CACHE_SIZE];
+        float valence[FORSYTH_MAX_VALENCE + 1];
+
+        forsyth_tables_t() {
+            for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+                /*The three vertices of the last triangle score the same so it is not simply fanned around*/
+                cache[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE
+                                 : std::pow(1.0f - static_cast<float>(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+            }
+            valence[0] = 0.0f;
+            for (uint32_t i = 1; i <= FORSYTH_MAX_VALENCE; ++i) {
+                /*Vertices with few triangles left are worth finishing*/
+                valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -FORSYTH_VALENCE_BOOST_POWER);
+            }
+        }
+
+        float score(int32_t cache_position, uint32_t live) const {
+            if (live == 0) return -1.0f;
+            float value = cache_position >= 0 ? cache[cache_position] : 0.0f;
+            return value + valence[std::min(live, FORSYTH_MAX_VALENCE)];
+        }
+    };
+
+    /*Triangles of every vertex in one array; the first live[v] entries of a vertex are not emitted yet*/
+    struct adjacency_t {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+        std::vector<uint32_t> live;
+
+        adjacency_t(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count):
+                offsets(vertex_count + 1, 0), triangles(index_count), live(vertex_count, 0) {
+            for (uint32_t i = 0; i < index_count; ++i) {
+                ++live[indices[i]];
+            }
+            for (uint32_t v = 0; v < vertex_count; ++v) {
+                offsets[v + 1] = offsets[v] + live[v];
+            }
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (uint32_t i = 0; i < index_count; ++i) {
+                triangles[fill[indices[i]]++] = i / 3;
+            }
+        }
+
+        void remove(uint32_t vertex, uint32_t triangle) {
+            uint32_t* begin = &triangles[offsets[vertex]];
+            uint32_t* end = begin + live[vertex];
+            uint32_t* it = std::find(begin, end, triangle);
+            if (it != end) {
+                std::swap(*it, end[-1]);
+                --live[vertex];
+            }
+        }
+    };
+
+    uint32_t cache_misses(const uint32_t* triangle, std::vector<uint32_t>& stamps, uint32_t& timestamp, uint32_t cache_size) {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            if (timestamp - stamps[v] > cache_size) {
+                stamps[v] = timestamp++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    struct primitive_result_t {
+        std::vector<mesh_vertex_t> vertices;
+        std::vector<uint32_t> indices;
+        vertex_cache_stats_t before;
+        vertex_cache_stats_t after;
+        uint32_t welded;
+    };
+
+    void optimize_primitive(const mesh_optimize_options_t& options, primitive_result_t& result) {
+        std::vector<mesh_vertex_t>& vertices = result.vertices;
+        std::vector<uint32_t>& indices = result.indices;
+        uint32_t index_count = static_cast<uint32_t>(indices.size());
+        result.before = analyze_vertex_cache(indices.data(), index_count, static_cast<uint32_t>(vertices.size()), options.cache_size);
+        result.welded = options.weld ? weld_vertices(vertices, indices) : 0;
+        uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+        if (options.method == vertex_cache_method_t::FORSYTH) {
+            optimize_vertex_cache_forsyth(indices.data(), index_count, vertex_count);
+        } else {
+            std::vector<uint32_t> clusters;
+            optimize_vertex_cache_tipsify(indices.data(), index_count, vertex_count, options.cache_size, &clusters);
+            if (options.overdraw_threshold > 0.0f) {
+                optimize_overdraw(indices.data(), index_count, vertices.data(), vertex_count, clusters, options.cache_size,
+                                  options.overdraw_threshold);
+            }
+        }
+        vertex_count = optimize_vertex_fetch(vertices, indices);
+        result.after = analyze_vertex_cache(indices.data(), index_count, vertex_count, options.cache_size);
+    }
+
+    void add_stats(vertex_cache_stats_t& total, const vertex_cache_stats_t& stats) {
+        total.transformed += stats.transformed;
+        total.triangles += stats.triangles;
+        total.vertices += stats.vertices;
+        total.acmr = total.triangles ? static_cast<float>(total.transformed) / total.triangles : 0.0f;
+        total.atvr = total.vertices ? static_cast<float>(total.transformed) / total.vertices : 0.0f;
+    }
+}
+
+vertex_cache_stats_t analyze_vertex_cache(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size) {
+    vertex_cache_stats_t stats{};
+    std::vector<uint32_t> stamps(vertex_count, 0);
+    std::vector<uint8_t> referenced(vertex_count, 0);
+    uint32_t timestamp = cache_size + 1;
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        stats.transformed += cache_misses(&indices[i], stamps, timestamp, cache_size);
+        for (int k = 0; k < 3; ++k) {
+            stats.vertices += referenced[indices[i + k]] ? 0 : 1;
+            referenced[indices[i + k]] = 1;
+        }
+    }
+    stats.triangles = index_count / 3;
+    stats.acmr = stats.triangles ? static_cast<float>(stats.transformed) / stats.triangles : 0.0f;
+    stats.atvr = stats.vertices ? static_cast<float>(stats.transformed) / stats.vertices : 0.0f;
+    return stats;
+}
+
+uint32_t weld_vertices(std::vector<mesh_vertex_t> &vertices, std::vector<uint32_t> &indices) {
+    uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+    /*Open addressing at most half full*/
+    uint32_t capacity = 16;
+    while (capacity < vertex_count * 2) capacity <<= 1;
+    std::vector<uint32_t> table(capacity, UINT32_MAX);
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<mesh_vertex_t> unique;
+    unique.reserve(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        /*Same word mix as hash_pipeline_state()*/
+        uint64_t words[sizeof(mesh_vertex_t) / sizeof(uint64_t)];
+        memcpy(words, &vertices[v], sizeof(words));
+        uint64_t hash = 0x9E3779B97F4A7C15ull;
+        for (uint64_t word: words) {
+            hash ^= word * 0xC2B2AE3D27D4EB4Full;
+            hash = (hash << 31 | hash >> 33) * 0x9E3779B185EBCA87ull;
+        }
+        uint32_t slot = static_cast<uint32_t>(hash ^ hash >> 29) & (capacity - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&unique[table[slot]], &vertices[v], sizeof(mesh_vertex_t)) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == UINT32_MAX) {
+            table[slot] = static_cast<uint32_t>(unique.size());
+            unique.push_back(vertices[v]);
+        }
+        remap[v] = table[slot];
+    }
+    for (uint32_t& index: indices) {
+        index = remap[index];
+    }
+    uint32_t welded = vertex_count - static_cast<uint32_t>(unique.size());
+    vertices = std::move(unique);
+    return welded;
+}
+
+void optimize_vertex_cache_forsyth(uint32_t *indices, uint32_t index_count, uint32_t vertex_count) {
+    static const forsyth_tables_t tables;
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count == 0) return;
+    adjacency_t adjacency(indices, triangle_count * 3, vertex_count);
+    std::vector<float> vertex_scores(vertex_count);
+    std::vector<int32_t> cache_positions(vertex_count, -1);
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        vertex_scores[v] = tables.score(-1, adjacency.live[v]);
+    }
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    int64_t best = 0;
+    float best_score = -1.0f;
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        const uint32_t* triangle = &indices[t * 3];
+        float score = vertex_scores[triangle[0]] + vertex_scores[triangle[1]] + vertex_scores[triangle[2]];
+        if (score > best_score) {
+            best_score = score;
+            best = t;
+        }
+    }
+
+    std::vector<uint32_t> output(triangle_count * 3);
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t next_cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cache_count = 0;
+    uint32_t cursor = 0;
+    for (uint32_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        if (best < 0) {
+            /*Nothing in the cache has triangles left, continue with the next unused one*/
+            while (emitted[cursor]) ++cursor;
+            best = cursor;
+        }
+        uint32_t t = static_cast<uint32_t>(best);
+        emitted[t] = 1;
+        memcpy(&output[emitted_count * 3], &indices[t * 3], 3 * sizeof(uint32_t));
+
+        /*The triangle's vertices move to the front, the rest of the cache shifts back*/
+        uint32_t next_count = 0;
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = indices[t * 3 + k];
+            adjacency.remove(v, t);
+            if (std::find(next_cache, next_cache + next_count, v) == next_cache + next_count) {
+                next_cache[next_count++] = v;
+            }
+        }
+        uint32_t fresh = next_count;
+        for (uint32_t i = 0; i < cache_count; ++i) {
+            uint32_t v = cache[i];
+            cache_positions[v] = -1;
+            if (next_count < FORSYTH_CACHE_SIZE + 3 && std::find(next_cache, next_cache + fresh, v) == next_cache + fresh) {
+                next_cache[next_count++] = v;
+            }
+        }
+        for (uint32_t i = 0; i < next_count; ++i) {
+            cache_positions[next_cache[i]] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+        }
+        /*Also rescores the vertices that fell out of the cache*/
+        for (uint32_t i = 0; i < cache_count; ++i) {
+            vertex_scores[cache[i]] = tables.score(cache_positions[cache[i]], adjacency.live[cache[i]]);
+        }
+        for (uint32_t i = 0; i < next_count; ++i) {
+            vertex_scores[next_cache[i]] = tables.score(cache_positions[next_cache[i]], adjacency.live[next_cache[i]]);
+        }
+
+        best = -1;
+        best_score = -1.0f;
+        for (uint32_t i = 0; i < std::min(next_count, FORSYTH_CACHE_SIZE); ++i) {
+            uint32_t v = next_cache[i];
+            for (uint32_t j = 0; j < adjacency.live[v]; ++j) {
+                uint32_t candidate = adjacency.triangles[adjacency.offsets[v] + j];
+                const uint32_t* triangle = &indices[candidate * 3];
+                float score = vertex_scores[triangle[0]] + vertex_scores[triangle[1]] + vertex_scores[triangle[2]];
+                if (score > best_score) {
+                    best_score = score;
+                    best = candidate;
+                }
+            }
+        }
+        memcpy(cache, next_cache, next_count * sizeof(uint32_t));
+        cache_count = next_count;
+    }
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+void optimize_vertex_cache_tipsify(uint32_t *indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size,
+                                   std::vector<uint32_t> *clusters) {
+    uint32_t triangle_count = index_count / 3;
+    if (clusters) {
+        clusters->assign(1, 0);
+    }
+    if (triangle_count == 0) return;
+    adjacency_t adjacency(indices, triangle_count * 3, vertex_count);
+    std::vector<uint32_t>& live = adjacency.live;
+    std::vector<uint32_t> stamps(vertex_count, 0);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint32_t> dead_ends;
+    std::vector<uint32_t> output;
+    output.reserve(triangle_count * 3);
+    uint32_t timestamp = cache_size + 1;
+    uint32_t cursor = 0;
+    int64_t fan = 0;
+    while (fan >= 0) {
+        /*Emit every remaining triangle around the fanning vertex*/
+        size_t candidates = dead_ends.size();
+        for (uint32_t i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; ++i) {
+            uint32_t t = adjacency.triangles[i];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                dead_ends.push_back(v);
+                --live[v];
+                if (timestamp - stamps[v] > cache_size) {
+                    stamps[v] = timestamp++;
+                }
+            }
+        }
+
+        /*Next fan: the oldest vertex that will still be cached after its remaining triangles*/
+        int64_t next = -1;
+        int64_t best_priority = -1;
+        for (size_t i = candidates; i < dead_ends.size(); ++i) {
+            uint32_t v = dead_ends[i];
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (timestamp - stamps[v] + 2 * live[v] <= cache_size) {
+                priority = timestamp - stamps[v];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                next = v;
+            }
+        }
+        if (next < 0) {
+            /*Dead end: back up through recent vertices, then scan for any unfinished one*/
+            while (!dead_ends.empty() && next < 0) {
+                uint32_t v = dead_ends.back();
+                dead_ends.pop_back();
+                if (live[v] > 0) next = v;
+            }
+            while (next < 0 && cursor < vertex_count) {
+                if (live[cursor] > 0) next = cursor;
+                else ++cursor;
+            }
+            uint32_t emitted_triangles = static_cast<uint32_t>(output.size() / 3);
+            if (clusters && next >= 0 && emitted_triangles > clusters->back()) {
+                clusters->push_back(emitted_triangles);
+            }
+        }
+        fan = next;
+    }
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+void optimize_overdraw(uint32_t *indices, uint32_t index_count, const mesh_vertex_t *vertices, uint32_t vertex_count,
+                       const std::vector<uint32_t> &clusters, uint32_t cache_size, float threshold) {
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count == 0 || clusters.empty()) return;
+
+    /*ACMR of the input when the cache starts cold at each hard boundary*/
+    std::vector<uint32_t> stamps(vertex_count, 0);
+    uint32_t timestamp = cache_size + 1;
+    uint32_t mesh_misses = 0;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+        timestamp += cache_size + 1;
+        for (uint32_t t = clusters[c]; t < end; ++t) {
+            mesh_misses += cache_misses(&indices[t * 3], stamps, timestamp, cache_size);
+        }
+    }
+    float mesh_acmr = static_cast<float>(mesh_misses) / triangle_count;
+
+    /*Split where the cluster so far is already as cache friendly as allowed*/
+    std::vector<uint32_t> soft;
+    std::fill(stamps.begin(), stamps.end(), 0);
+    timestamp = cache_size + 1;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+        uint32_t start = clusters[c];
+        uint32_t misses = 0;
+        timestamp += cache_size + 1;
+        soft.push_back(start);
+        for (uint32_t t = clusters[c]; t < end; ++t) {
+            misses += cache_misses(&indices[t * 3], stamps, timestamp, cache_size);
+            if (t + 1 < end && static_cast<float>(misses) <= threshold * mesh_acmr * static_cast<float>(t + 1 - start)) {
+                soft.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                timestamp += cache_size + 1;
+            }
+        }
+    }
+
+    /*Area weighted centroids and normals*/
+    size_t cluster_count = soft.size();
+    std::vector<glm::vec3> centroids(cluster_count, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(cluster_count, glm::vec3(0.0f));
+    std::vector<float> areas(cluster_count, 0.0f);
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    for (size_t c = 0; c < cluster_count; ++c) {
+        uint32_t end = c + 1 < cluster_count ? soft[c + 1] : triangle_count;
+        for (uint32_t t = soft[c]; t < end; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3]].position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            centroids[c] += (a + b + d) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        mesh_centroid += centroids[c];
+        mesh_area += areas[c];
+        centroids[c] /= std::max(areas[c], 1e-20f);
+    }
+    mesh_centroid /= std::max(mesh_area, 1e-20f);
+
+    std::vector<float> keys(cluster_count);
+    std::vector<uint32_t> order(cluster_count);
+    for (size_t c = 0; c < cluster_count; ++c) {
+        float length = glm::length(normals[c]);
+        keys[c] = length > 0.0f ? glm::dot(centroids[c] - mesh_centroid, normals[c] / length) : 0.0f;
+        order[c] = static_cast<uint32_t>(c);
+    }
+    /*Outward facing clusters first*/
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangle_count * 3);
+    for (uint32_t c: order) {
+        uint32_t end = c + 1 < cluster_count ? soft[c + 1] : triangle_count;
+        output.insert(output.end(), indices + soft[c] * 3, indices + end * 3);
+    }
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+uint32_t optimize_vertex_fetch(std::vector<mesh_vertex_t> &vertices, std::vector<uint32_t> &indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<mesh_vertex_t> ordered;
+    ordered.reserve(vertices.size());
+    for (uint32_t& index: indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(ordered);
+    return static_cast<uint32_t>(vertices.size());
+}
+
+void optimize_mesh_scene(mesh_scene_t &scene, const mesh_optimize_options_t &options, JobSystem *jobs,
+                         std::vector<mesh_optimize_report_t> *report) {
+    uint32_t primitive_count = static_cast<uint32_t>(scene.primitives.size());
+    std::vector<primitive_result_t> results(primitive_count);
+    auto optimize = [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; ++i) {
+            const mesh_primitive_t& primitive = scene.primitives[i];
+            primitive_result_t& result = results[i];
+            auto vertices = scene.vertices.begin() + primitive.vertex_offset;
+            auto indices = scene.indices.begin() + primitive.first_index;
+            result.vertices.assign(vertices, vertices + primitive.vertex_count);
+            result.indices.assign(indices, indices + primitive.index_count);
+            optimize_primitive(options, result);
+        }
+    };
+    if (jobs) {
+        jobs->wait(jobs->parallel_for(primitive_count, 1, optimize));
+    } else {
+        optimize(0, primitive_count);
+    }
+
+    /*Welding and dropping unreferenced vertices shrink primitives, pack them again*/
+    uint32_t vertex_count = 0;
+    for (uint32_t i = 0; i < primitive_count; ++i) {
+        mesh_primitive_t& primitive = scene.primitives[i];
+        primitive.vertex_offset = static_cast<int32_t>(vertex_count);
+        primitive.vertex_count = static_cast<uint32_t>(results[i].vertices.size());
+        memcpy(&scene.vertices[vertex_count], results[i].vertices.data(), primitive.vertex_count * sizeof(mesh_vertex_t));
+        memcpy(&scene.indices[primitive.first_index], results[i].indices.data(), primitive.index_count * sizeof(uint32_t));
+        vertex_count += primitive.vertex_count;
+    }
+    scene.vertices.resize(vertex_count);
+
+    if (!report) return;
+    report->assign(scene.meshes.size(), mesh_optimize_report_t{});
+    for (size_t m = 0; m < scene.meshes.size(); ++m) {
+        mesh_optimize_report_t& entry = (*report)[m];
+        for (uint32_t i = 0; i < scene.meshes[m].primitive_count; ++i) {
+            const primitive_result_t& result = results[scene.meshes[m].first_primitive + i];
+            add_stats(entry.before, result.before);
+            add_stats(entry.after, result.after);
+            entry.welded += result.welded;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_MESHOPTIMIZER_H
+#define HELLO_VULKAN_MESHOPTIMIZER_H
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+#include "JobSystem.h"
+
+/*Entries of the FIFO post-transform cache the metrics are simulated with*/
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct vertex_cache_stats_t {
+    /*Vertices transformed per triangle, 0.5 at best and 3 at worst*/
+    float acmr;
+    /*Vertices transformed per referenced vertex, 1 at best*/
+    float atvr;
+    uint32_t transformed;
+    uint32_t triangles;
+    uint32_t vertices;
+};
+
+enum class vertex_cache_method_t {
+    /*Tom Forsyth's linear-speed scoring, usually the lowest ACMR*/
+    FORSYTH,
+    /*Sander et al. fan walk, faster and yields the clusters overdraw ordering needs*/
+    TIPSIFY
+};
+
+struct mesh_optimize_options_t {
+    vertex_cache_method_t method = vertex_cache_method_t::TIPSIFY;
+    uint32_t cache_size = VERTEX_CACHE_SIZE;
+    /*Clusters are sorted front to back when > 0 (Tipsify only); how much ACMR may grow, e.g. 1.05*/
+    float overdraw_threshold = 1.05f;
+    /*Merge bitwise identical vertices first*/
+    bool weld = true;
+};
+
+/*Metrics of one mesh: every primitive of it, summed*/
+struct mesh_optimize_report_t {
+    vertex_cache_stats_t before;
+    vertex_cache_stats_t after;
+    uint32_t welded;
+};
+
+/*FIFO cache simulation; indices must be < vertex_count*/
+vertex_cache_stats_t analyze_vertex_cache(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count,
+                                          uint32_t cache_size = VERTEX_CACHE_SIZE);
+/*Merges identical vertices through a hash of their bytes and drops the rest; returns how many were removed*/
+uint32_t weld_vertices(std::vector<mesh_vertex_t>& vertices, std::vector<uint32_t>& indices);
+/*Reorders triangles in place for the post-transform cache*/
+void optimize_vertex_cache_forsyth(uint32_t* indices, uint32_t index_count, uint32_t vertex_count);
+/*As above; clusters receives the first triangle of every run that ended in a cache flush*/
+void optimize_vertex_cache_tipsify(uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size,
+                                   std::vector<uint32_t>* clusters);
+/*
+ * Sorts clusters so triangles facing outwards from the mesh center come first, which
+ * lets them occlude the rest from most view directions. Clusters are split further
+ * while that keeps ACMR within threshold times the input's.
+ */
+void optimize_overdraw(uint32_t* indices, uint32_t index_count, const mesh_vertex_t* vertices, uint32_t vertex_count,
+                       const std::vector<uint32_t>& clusters, uint32_t cache_size, float threshold);
+/*Renumbers vertices in first use order so fetches walk memory linearly; unreferenced ones are dropped*/
+uint32_t optimize_vertex_fetch(std::vector<mesh_vertex_t>& vertices, std::vector<uint32_t>& indices);
+/*
+ * Runs weld, cache, overdraw and fetch optimization on every primitive of scene and
+ * repacks the arrays. Primitives are processed in parallel on jobs when given; report
+ * receives one entry per mesh.
+ */
+void optimize_mesh_scene(mesh_scene_t& scene, const mesh_optimize_options_t& options, JobSystem* jobs = nullptr,
+                         std::vector<mesh_optimize_report_t>* report = nullptr);
+
+
+#endif //HELLO_VULKAN_MESHOPTIMIZER_H
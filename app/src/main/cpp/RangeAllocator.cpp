@@ -0,0 +1,104 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <iterator>
+#include <stdexcept>
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(uint64_t capacity) {
+    grow(capacity);
+}
+
+void RangeAllocator::insert(uint64_t offset, uint64_t size) {
+    by_offset.emplace(offset, size);
+    by_size.emplace(size, offset);
+}
+
+void RangeAllocator::erase(std::map<uint64_t, uint64_t>::iterator it) {
+    by_size.erase({it->second, it->first});
+    by_offset.erase(it);
+}
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment) {
+    if (size == 0) {
+        throw std::invalid_argument("Range size must not be 0!");
+    }
+    /*Best fit; a range this size or larger may still be too small once aligned*/
+    for (auto it = by_size.lower_bound({size, 0}); it != by_size.end(); ++it) {
+        uint64_t offset = it->second;
+        uint64_t free_size = it->first;
+        uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (aligned + size > offset + free_size) continue;
+        erase(by_offset.find(offset));
+        if (aligned > offset) {
+            insert(offset, aligned - offset);
+        }
+        if (aligned + size < offset + free_size) {
+            insert(aligned + size, offset + free_size - aligned - size);
+        }
+        used += size;
+        return aligned;
+    }
+    return INVALID_OFFSET;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size) {
+    if (size == 0 || offset + size > capacity || size > used) {
+        throw std::out_of_range("Invalid range!");
+    }
+    auto next = by_offset.lower_bound(offset);
+    if (next != by_offset.end() && next->first < offset + size) {
+        throw std::runtime_error("Range is already free!");
+    }
+    if (next != by_offset.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second > offset) {
+            throw std::runtime_error("Range is already free!");
+        }
+    }
+    used -= size;
+    /*Merge with free neighbours so large ranges come back*/
+    if (next != by_offset.end() && next->first == offset + size) {
+        size += next->second;
+        erase(next);
+    }
+    auto previous = by_offset.lower_bound(offset);
+    if (previous != by_offset.begin()) {
+        --previous;
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            erase(previous);
+        }
+    }
+    insert(offset, size);
+}
+
+void RangeAllocator::grow(uint64_t new_capacity) {
+    if (new_capacity <= capacity) return;
+    uint64_t offset = capacity;
+    uint64_t size = new_capacity - capacity;
+    capacity = new_capacity;
+    if (!by_offset.empty()) {
+        auto last = std::prev(by_offset.end());
+        if (last->first + last->second == offset) {
+            offset = last->first;
+            size += last->second;
+            erase(last);
+        }
+    }
+    insert(offset, size);
+}
+
+uint64_t RangeAllocator::get_capacity() const {
+    return capacity;
+}
+
+uint64_t RangeAllocator::get_used() const {
+    return used;
+}
+
+uint64_t RangeAllocator::get_largest_free() const {
+    return by_size.empty() ? 0 : by_size.rbegin()->first;
+}
@@ -0,0 +1,39 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_RANGEALLOCATOR_H
+#define HELLO_VULKAN_RANGEALLOCATOR_H
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+/*
+ * Hands out aligned ranges of [0, capacity) in whatever unit the owner uses. Free
+ * ranges are indexed by offset, to merge neighbours on free, and by size, to pick the
+ * smallest one that fits; both are O(log n).
+ */
+class RangeAllocator {
+private:
+    std::map<uint64_t, uint64_t> by_offset;
+    std::set<std::pair<uint64_t, uint64_t>> by_size;
+    uint64_t capacity = 0;
+    uint64_t used = 0;
+    void insert(uint64_t offset, uint64_t size);
+    void erase(std::map<uint64_t, uint64_t>::iterator it);
+public:
+    static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+    explicit RangeAllocator(uint64_t capacity = 0);
+    /*Offset of the range, a multiple of alignment (a power of two); INVALID_OFFSET when nothing fits*/
+    uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+    void free(uint64_t offset, uint64_t size);
+    /*Appends [capacity, new_capacity) as free space*/
+    void grow(uint64_t new_capacity);
+    uint64_t get_capacity() const;
+    uint64_t get_used() const;
+    uint64_t get_largest_free() const;
+};
+
+
+#endif //HELLO_VULKAN_RANGEALLOCATOR_H
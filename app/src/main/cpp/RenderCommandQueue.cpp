@@ -0,0 +1,49 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <stdexcept>
+#include "RenderCommandQueue.h"
+
+RenderCommandQueue::RenderCommandQueue(size_t capacity): mask(capacity - 1), cells(new cell_t[capacity]) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        throw std::invalid_argument("Command queue capacity must be a power of two!");
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool RenderCommandQueue::push(const render_command_t &command) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        cell_t& cell = cells[pos & mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.command = command;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            /*Full*/
+            return false;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool RenderCommandQueue::pop(render_command_t &command) {
+    cell_t& cell = cells[tail & mask];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(tail + 1) < 0) {
+        /*Empty, or the producer owning this slot has not finished writing yet*/
+        return false;
+    }
+    command = cell.command;
+    cell.sequence.store(tail + mask + 1, std::memory_order_release);
+    ++tail;
+    return true;
+}
@@ -0,0 +1,89 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_RENDERCOMMANDQUEUE_H
+#define HELLO_VULKAN_RENDERCOMMANDQUEUE_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "RenderScheduler.h"
+
+/*
+ * Fixed-function state a material may change per draw. Values are the Vulkan enums
+ * (VkPrimitiveTopology, VkCullModeFlags, VkFrontFace, VkCompareOp) narrowed to bytes.
+ */
+struct raster_state_t {
+    uint8_t topology;
+    uint8_t cull_mode;
+    uint8_t front_face;
+    uint8_t depth_test;
+    uint8_t depth_write;
+    uint8_t depth_compare;
+    bool operator==(const raster_state_t& other) const {
+        return topology == other.topology && cull_mode == other.cull_mode && front_face == other.front_face
+               && depth_test == other.depth_test && depth_write == other.depth_write && depth_compare == other.depth_compare;
+    }
+    bool operator!=(const raster_state_t& other) const { return !(*this == other); }
+};
+
+enum class render_command_type_t {
+    SURFACE_CHANGED,
+    SET_RENDER_MODE,
+    SET_TRANSFORM,
+    SET_CAMERA,
+    SET_PERMUTATION,
+    SET_RASTER_STATE,
+    SET_MATERIAL,
+    LOAD_TEXTURE,
+    /*Replaces the scene with a binary glTF file*/
+    LOAD_MESH
+};
+
+struct render_command_t {
+    render_command_type_t type;
+    union {
+        struct {
+            uint32_t width;
+            uint32_t height;
+        } surface;
+        render_mode_t mode;
+        /*Column major, same layout as glm::mat4*/
+        float transform[16];
+        float view_proj[16];
+        /*shader_permutation_t bits*/
+        uint32_t permutation;
+        raster_state_t raster;
+        struct {
+            float tint[4];
+            uint32_t index;
+        } material;
+        char path[256];
+    };
+};
+
+/*
+ * Bounded multi-producer/single-consumer ring (Vyukov's sequence-numbered cells).
+ * Producers never take a lock and never wait on the consumer: when the ring is full
+ * push() fails instead of blocking the calling (UI) thread.
+ */
+class RenderCommandQueue {
+private:
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        render_command_t command;
+    };
+    const size_t mask;
+    std::unique_ptr<cell_t[]> cells;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) size_t tail = 0;
+public:
+    /*Capacity must be a power of two*/
+    explicit RenderCommandQueue(size_t capacity = 256);
+    bool push(const render_command_t& command);
+    bool pop(render_command_t& command);
+};
+
+
+#endif //HELLO_VULKAN_RENDERCOMMANDQUEUE_H
@@ -0,0 +1,71 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include "RenderScheduler.h"
+
+RenderScheduler::RenderScheduler(render_mode_t _mode): mode(_mode) {
+
+}
+
+void RenderScheduler::set_mode(render_mode_t _mode) {
+    std::lock_guard<std::mutex> guard(lock);
+    mode = _mode;
+    cond.notify_one();
+}
+
+render_mode_t RenderScheduler::get_mode() {
+    std::lock_guard<std::mutex> guard(lock);
+    return mode;
+}
+
+void RenderScheduler::mark_dirty(uint32_t flags) {
+    std::lock_guard<std::mutex> guard(lock);
+    dirty |= flags;
+    cond.notify_one();
+}
+
+void RenderScheduler::animate_for(clock::duration duration) {
+    std::lock_guard<std::mutex> guard(lock);
+    animate_until = std::max(animate_until, clock::now() + duration);
+    dirty |= DIRTY_ANIMATION;
+    cond.notify_one();
+}
+
+void RenderScheduler::pause() {
+    std::lock_guard<std::mutex> guard(lock);
+    paused = true;
+}
+
+void RenderScheduler::resume() {
+    std::lock_guard<std::mutex> guard(lock);
+    paused = false;
+    /*The surface content may have been discarded while we were in background*/
+    dirty |= DIRTY_SURFACE;
+    cond.notify_one();
+}
+
+void RenderScheduler::stop() {
+    std::lock_guard<std::mutex> guard(lock);
+    stopped = true;
+    cond.notify_one();
+}
+
+bool RenderScheduler::wait_for_frame(uint32_t& flags) {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        if (stopped) return false;
+        if (!paused) {
+            if (clock::now() < animate_until) {
+                dirty |= DIRTY_ANIMATION;
+            }
+            if (mode == render_mode_t::CONTINUOUS || dirty != DIRTY_NONE) {
+                flags = dirty;
+                dirty = DIRTY_NONE;
+                return true;
+            }
+        }
+        cond.wait(guard);
+    }
+}
@@ -0,0 +1,57 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_RENDERSCHEDULER_H
+#define HELLO_VULKAN_RENDERSCHEDULER_H
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+enum class render_mode_t {
+    /*Render every frame, paced by the present engine*/
+    CONTINUOUS,
+    /*Render only when something is marked dirty or an animation is running*/
+    ON_DEMAND
+};
+
+enum dirty_flag_t : uint32_t {
+    DIRTY_NONE      = 0,
+    DIRTY_SCENE     = 1 << 0,
+    DIRTY_SURFACE   = 1 << 1,
+    DIRTY_ANIMATION = 1 << 2,
+    DIRTY_ALL       = DIRTY_SCENE | DIRTY_SURFACE | DIRTY_ANIMATION
+};
+
+/*
+ * Decides when the render thread has to produce a frame. The render thread blocks in
+ * wait_for_frame() until some producer marks the scene/surface dirty or the animation
+ * clock is running, so static content costs no CPU or GPU time in ON_DEMAND mode.
+ */
+class RenderScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+private:
+    std::mutex lock;
+    std::condition_variable cond;
+    render_mode_t mode;
+    uint32_t dirty = DIRTY_ALL;
+    bool paused = false;
+    bool stopped = false;
+    clock::time_point animate_until{};
+public:
+    explicit RenderScheduler(render_mode_t _mode = render_mode_t::ON_DEMAND);
+    void set_mode(render_mode_t _mode);
+    render_mode_t get_mode();
+    void mark_dirty(uint32_t flags);
+    void animate_for(clock::duration duration);
+    void pause();
+    void resume();
+    void stop();
+    /*Blocks until a frame is due. Returns false once stopped, otherwise the consumed dirty flags*/
+    bool wait_for_frame(uint32_t& flags);
+};
+
+
+#endif //HELLO_VULKAN_RENDERSCHEDULER_H
@@ -0,0 +1,229 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_SIMD_H
+#define HELLO_VULKAN_SIMD_H
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Four float lanes over NEON on ARM and SSE2 on x86, the baselines of every Android
+ * ABI; other targets get a plain array. Masks are all-ones or all-zero lanes as the
+ * comparisons return them.
+ */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HELLO_VULKAN_SIMD_NEON 1
+typedef float32x4_t simd4f;
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HELLO_VULKAN_SIMD_SSE 1
+typedef __m128 simd4f;
+#else
+#define HELLO_VULKAN_SIMD_SCALAR 1
+struct simd4f {
+    float v[4];
+};
+#endif
+
+/*IEEE half with round to nearest even; overflow gives infinity and NaN stays NaN*/
+inline uint16_t float_to_half(float value) {
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+    uint32_t half;
+    if (f >= 0x47800000u) {
+        half = f > 0x7F800000u ? 0x7E00u : 0x7C00u;
+    } else if (f < 0x38800000u) {
+        /*Subnormal: adding 0.5 lets the FPU round the mantissa into place*/
+        float magic;
+        memcpy(&magic, &f, sizeof(magic));
+        magic += 0.5f;
+        memcpy(&half, &magic, sizeof(half));
+        half -= 0x3F000000u;
+    } else {
+        /*Rebias the exponent and round the 13 dropped mantissa bits*/
+        uint32_t odd = (f >> 13) & 1;
+        half = (f + 0xC8000FFFu + odd) >> 13;
+    }
+    return static_cast<uint16_t>(half | sign >> 16);
+}
+
+#if defined(HELLO_VULKAN_SIMD_NEON)
+
+inline simd4f simd_load(const float* p) { return vld1q_f32(p); }
+inline void simd_store(float* p, simd4f a) { vst1q_f32(p, a); }
+inline simd4f simd_splat(float a) { return vdupq_n_f32(a); }
+inline simd4f simd_add(simd4f a, simd4f b) { return vaddq_f32(a, b); }
+inline simd4f simd_sub(simd4f a, simd4f b) { return vsubq_f32(a, b); }
+inline simd4f simd_mul(simd4f a, simd4f b) { return vmulq_f32(a, b); }
+/*a * b + c*/
+inline simd4f simd_madd(simd4f a, simd4f b, simd4f c) { return vmlaq_f32(c, a, b); }
+inline simd4f simd_min(simd4f a, simd4f b) { return vminq_f32(a, b); }
+inline simd4f simd_max(simd4f a, simd4f b) { return vmaxq_f32(a, b); }
+inline simd4f simd_abs(simd4f a) { return vabsq_f32(a); }
+inline simd4f simd_less(simd4f a, simd4f b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+inline simd4f simd_greater(simd4f a, simd4f b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+inline simd4f simd_and(simd4f a, simd4f b) {
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+inline simd4f simd_or(simd4f a, simd4f b) {
+    return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+/*mask ? a : b*/
+inline simd4f simd_select(simd4f mask, simd4f a, simd4f b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+/*Bit N set when lane N of the mask is set*/
+inline int simd_mask(simd4f mask) {
+    static const int32_t bits[4] = {1, 2, 4, 8};
+    uint32x4_t selected = vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(reinterpret_cast<const uint32_t*>(bits)));
+    uint32x2_t pairs = vorr_u32(vget_low_u32(selected), vget_high_u32(selected));
+    return static_cast<int>(vget_lane_u32(pairs, 0) | vget_lane_u32(pairs, 1));
+}
+#if defined(__aarch64__)
+inline simd4f simd_div(simd4f a, simd4f b) { return vdivq_f32(a, b); }
+inline simd4f simd_sqrt(simd4f a) { return vsqrtq_f32(a); }
+#else
+inline simd4f simd_div(simd4f a, simd4f b) {
+    /*Estimate refined twice, close to a correctly rounded divide*/
+    float32x4_t r = vrecpeq_f32(b);
+    r = vmulq_f32(r, vrecpsq_f32(b, r));
+    r = vmulq_f32(r, vrecpsq_f32(b, r));
+    return vmulq_f32(a, r);
+}
+inline simd4f simd_sqrt(simd4f a) {
+    float32x4_t r = vrsqrteq_f32(a);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a, r), r));
+    /*rsqrt(0) is infinite, keep sqrt(0) at 0*/
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vmulq_f32(a, r)), vcgtq_f32(a, vdupq_n_f32(0.0f))));
+}
+#endif
+inline void simd_transpose(simd4f& r0, simd4f& r1, simd4f& r2, simd4f& r3) {
+    float32x4x2_t t01 = vtrnq_f32(r0, r1);
+    float32x4x2_t t23 = vtrnq_f32(r2, r3);
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+/*Round to nearest*/
+inline void simd_store_int(int32_t* p, simd4f a) {
+#if defined(__aarch64__)
+    vst1q_s32(p, vcvtnq_s32_f32(a));
+#else
+    /*Only truncation on ARMv7, round half away from zero instead*/
+    float32x4_t half = vbslq_f32(vcltq_f32(a, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    vst1q_s32(p, vcvtq_s32_f32(vaddq_f32(a, half)));
+#endif
+}
+inline void simd_store_half(uint16_t* p, simd4f a) {
+#if defined(__aarch64__)
+    vst1_u16(p, vreinterpret_u16_f16(vcvt_f16_f32(a)));
+#else
+    /*Half conversion is an optional ARMv7 extension*/
+    float lanes[4];
+    vst1q_f32(lanes, a);
+    for (int i = 0; i < 4; ++i) p[i] = float_to_half(lanes[i]);
+#endif
+}
+
+#elif defined(HELLO_VULKAN_SIMD_SSE)
+
+inline simd4f simd_load(const float* p) { return _mm_loadu_ps(p); }
+inline void simd_store(float* p, simd4f a) { _mm_storeu_ps(p, a); }
+inline simd4f simd_splat(float a) { return _mm_set1_ps(a); }
+inline simd4f simd_add(simd4f a, simd4f b) { return _mm_add_ps(a, b); }
+inline simd4f simd_sub(simd4f a, simd4f b) { return _mm_sub_ps(a, b); }
+inline simd4f simd_mul(simd4f a, simd4f b) { return _mm_mul_ps(a, b); }
+inline simd4f simd_madd(simd4f a, simd4f b, simd4f c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline simd4f simd_min(simd4f a, simd4f b) { return _mm_min_ps(a, b); }
+inline simd4f simd_max(simd4f a, simd4f b) { return _mm_max_ps(a, b); }
+inline simd4f simd_abs(simd4f a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline simd4f simd_less(simd4f a, simd4f b) { return _mm_cmplt_ps(a, b); }
+inline simd4f simd_greater(simd4f a, simd4f b) { return _mm_cmpgt_ps(a, b); }
+inline simd4f simd_and(simd4f a, simd4f b) { return _mm_and_ps(a, b); }
+inline simd4f simd_or(simd4f a, simd4f b) { return _mm_or_ps(a, b); }
+inline simd4f simd_select(simd4f mask, simd4f a, simd4f b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline int simd_mask(simd4f mask) { return _mm_movemask_ps(mask); }
+inline simd4f simd_div(simd4f a, simd4f b) { return _mm_div_ps(a, b); }
+inline simd4f simd_sqrt(simd4f a) { return _mm_sqrt_ps(a); }
+inline void simd_transpose(simd4f& r0, simd4f& r1, simd4f& r2, simd4f& r3) {
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+inline void simd_store_int(int32_t* p, simd4f a) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvtps_epi32(a));
+}
+/*float_to_half() on four lanes, F16C is not part of the Android x86 ABIs*/
+inline void simd_store_half(uint16_t* p, simd4f a) {
+    __m128 sign = _mm_and_ps(a, _mm_set1_ps(-0.0f));
+    __m128 absolute = _mm_xor_ps(a, sign);
+    __m128i bits = _mm_castps_si128(absolute);
+    __m128i regular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), bits);
+    __m128i nan = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absolute, absolute)), _mm_set1_epi32(0x200));
+    __m128i special = _mm_or_si128(nan, _mm_set1_epi32(0x7C00));
+    __m128i subnormal_mask = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), bits);
+    __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3F000000));
+    __m128i odd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+    __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, _mm_set1_epi32(static_cast<int32_t>(0xC8000FFFu))), odd), 13);
+    __m128i finite = _mm_or_si128(_mm_and_si128(subnormal_mask, subnormal), _mm_andnot_si128(subnormal_mask, normal));
+    __m128i half = _mm_or_si128(_mm_and_si128(regular, finite), _mm_andnot_si128(regular, special));
+    /*Sign extended so the saturating pack keeps the low 16 bits*/
+    half = _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(half, half));
+}
+
+#else
+
+inline simd4f simd_load(const float* p) { simd4f r; memcpy(r.v, p, sizeof(r.v)); return r; }
+inline void simd_store(float* p, simd4f a) { memcpy(p, a.v, sizeof(a.v)); }
+inline simd4f simd_splat(float a) { return {{a, a, a, a}}; }
+#define HELLO_VULKAN_SIMD_LANES(expr) simd4f r; for (int i = 0; i < 4; ++i) r.v[i] = (expr); return r
+inline simd4f simd_add(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(a.v[i] + b.v[i]); }
+inline simd4f simd_sub(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(a.v[i] - b.v[i]); }
+inline simd4f simd_mul(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(a.v[i] * b.v[i]); }
+inline simd4f simd_madd(simd4f a, simd4f b, simd4f c) { HELLO_VULKAN_SIMD_LANES(a.v[i] * b.v[i] + c.v[i]); }
+inline simd4f simd_min(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+inline simd4f simd_max(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+inline simd4f simd_abs(simd4f a) { HELLO_VULKAN_SIMD_LANES(std::fabs(a.v[i])); }
+inline float simd_lane_float(uint32_t bits) { float f; memcpy(&f, &bits, sizeof(f)); return f; }
+inline uint32_t simd_lane_bits(float f) { uint32_t bits; memcpy(&bits, &f, sizeof(bits)); return bits; }
+inline float simd_lane_mask(bool set) { return simd_lane_float(set ? ~0u : 0u); }
+inline simd4f simd_less(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(simd_lane_mask(a.v[i] < b.v[i])); }
+inline simd4f simd_greater(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(simd_lane_mask(a.v[i] > b.v[i])); }
+inline simd4f simd_and(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(simd_lane_float(simd_lane_bits(a.v[i]) & simd_lane_bits(b.v[i]))); }
+inline simd4f simd_or(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(simd_lane_float(simd_lane_bits(a.v[i]) | simd_lane_bits(b.v[i]))); }
+inline simd4f simd_select(simd4f mask, simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(simd_lane_bits(mask.v[i]) ? a.v[i] : b.v[i]); }
+inline simd4f simd_div(simd4f a, simd4f b) { HELLO_VULKAN_SIMD_LANES(a.v[i] / b.v[i]); }
+inline simd4f simd_sqrt(simd4f a) { HELLO_VULKAN_SIMD_LANES(std::sqrt(a.v[i])); }
+#undef HELLO_VULKAN_SIMD_LANES
+inline int simd_mask(simd4f mask) {
+    int bits = 0;
+    for (int i = 0; i < 4; ++i) bits |= simd_lane_bits(mask.v[i]) ? 1 << i : 0;
+    return bits;
+}
+inline void simd_transpose(simd4f& r0, simd4f& r1, simd4f& r2, simd4f& r3) {
+    simd4f* rows[4] = {&r0, &r1, &r2, &r3};
+    for (int i = 0; i < 4; ++i) {
+        for (int j = i + 1; j < 4; ++j) {
+            float t = rows[i]->v[j];
+            rows[i]->v[j] = rows[j]->v[i];
+            rows[j]->v[i] = t;
+        }
+    }
+}
+inline void simd_store_int(int32_t* p, simd4f a) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<int32_t>(std::lrint(a.v[i]));
+}
+inline void simd_store_half(uint16_t* p, simd4f a) {
+    for (int i = 0; i < 4; ++i) p[i] = float_to_half(a.v[i]);
+}
+
+#endif
+
+inline simd4f simd_clamp(simd4f a, simd4f low, simd4f high) { return simd_min(simd_max(a, low), high); }
+
+
+#endif //HELLO_VULKAN_SIMD_H
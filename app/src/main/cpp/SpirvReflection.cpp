@@ -0,0 +1,436 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "SpirvReflection.h"
+
+namespace {
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+    constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+    constexpr uint32_t UNDEFINED = UINT32_MAX;
+
+    /*Opcodes*/
+    constexpr uint32_t OP_ENTRY_POINT = 15;
+    constexpr uint32_t OP_TYPE_BOOL = 20;
+    constexpr uint32_t OP_TYPE_INT = 21;
+    constexpr uint32_t OP_TYPE_FLOAT = 22;
+    constexpr uint32_t OP_TYPE_VECTOR = 23;
+    constexpr uint32_t OP_TYPE_MATRIX = 24;
+    constexpr uint32_t OP_TYPE_IMAGE = 25;
+    constexpr uint32_t OP_TYPE_SAMPLER = 26;
+    constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+    constexpr uint32_t OP_TYPE_ARRAY = 28;
+    constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+    constexpr uint32_t OP_TYPE_STRUCT = 30;
+    constexpr uint32_t OP_TYPE_POINTER = 32;
+    constexpr uint32_t OP_CONSTANT = 43;
+    constexpr uint32_t OP_VARIABLE = 59;
+    constexpr uint32_t OP_DECORATE = 71;
+    constexpr uint32_t OP_MEMBER_DECORATE = 72;
+
+    /*Decorations*/
+    constexpr uint32_t DECORATION_SPEC_ID = 1;
+    constexpr uint32_t DECORATION_BLOCK = 2;
+    constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+    constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+    constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+    constexpr uint32_t DECORATION_BUILT_IN = 11;
+    constexpr uint32_t DECORATION_LOCATION = 30;
+    constexpr uint32_t DECORATION_BINDING = 33;
+    constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+    constexpr uint32_t DECORATION_OFFSET = 35;
+
+    /*Storage classes*/
+    constexpr uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+    constexpr uint32_t STORAGE_INPUT = 1;
+    constexpr uint32_t STORAGE_UNIFORM = 2;
+    constexpr uint32_t STORAGE_PUSH_CONSTANT = 9;
+    constexpr uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+    constexpr uint32_t DIM_BUFFER = 5;
+    constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+    struct id_info_t {
+        /*Defining instruction, null when the id is not a type/constant/variable*/
+        const uint32_t* def = nullptr;
+        uint32_t set = UNDEFINED;
+        uint32_t binding = UNDEFINED;
+        uint32_t location = UNDEFINED;
+        uint32_t array_stride = 0;
+        bool built_in = false;
+        bool block = false;
+        bool buffer_block = false;
+    };
+
+    struct member_info_t {
+        uint32_t offset = 0;
+        uint32_t matrix_stride = 0;
+    };
+
+    struct module_t {
+        std::vector<id_info_t> ids;
+        std::unordered_map<uint64_t, member_info_t> members;
+
+        static uint64_t key(uint32_t id, uint32_t member) {
+            return (static_cast<uint64_t>(id) << 32) | member;
+        }
+
+        uint32_t opcode(uint32_t id) const {
+            return ids[id].def ? (ids[id].def[0] & 0xFFFF) : 0;
+        }
+
+        uint32_t operand(uint32_t id, uint32_t index) const {
+            return ids[id].def[index];
+        }
+
+        uint32_t word_count(uint32_t id) const {
+            return ids[id].def[0] >> 16;
+        }
+
+        uint32_t size_of(uint32_t type, uint32_t matrix_stride = 0) const {
+            switch (opcode(type)) {
+                case OP_TYPE_BOOL:
+                    return 4;
+                case OP_TYPE_INT:
+                case OP_TYPE_FLOAT:
+                    return operand(type, 2) / 8;
+                case OP_TYPE_VECTOR:
+                    return operand(type, 3) * size_of(operand(type, 2));
+                case OP_TYPE_MATRIX:
+                    return operand(type, 3) * (matrix_stride ? matrix_stride : size_of(operand(type, 2)));
+                case OP_TYPE_ARRAY: {
+                    uint32_t stride = ids[type].array_stride;
+                    return array_length(type) * (stride ? stride : size_of(operand(type, 2)));
+                }
+                case OP_TYPE_STRUCT: {
+                    uint32_t size = 0;
+                    for (uint32_t m = 0; m + 2 < word_count(type); ++m) {
+                        auto it = members.find(key(type, m));
+                        member_info_t info = it != members.end() ? it->second : member_info_t{};
+                        size = std::max(size, info.offset + size_of(operand(type, 2 + m), info.matrix_stride));
+                    }
+                    return size;
+                }
+                default:
+                    return 0;
+            }
+        }
+
+        uint32_t array_length(uint32_t array_type) const {
+            uint32_t length_id = operand(array_type, 3);
+            return opcode(length_id) == OP_CONSTANT ? operand(length_id, 3) : 1;
+        }
+    };
+
+    VkShaderStageFlagBits stage_of(uint32_t execution_model) {
+        switch (execution_model) {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+            default:
+                throw std::runtime_error("Unsupported SPIR-V execution model!");
+        }
+    }
+
+    VkFormat format_of(const module_t& module, uint32_t type, uint32_t& size) {
+        uint32_t components = 1;
+        uint32_t scalar = type;
+        if (module.opcode(type) == OP_TYPE_VECTOR) {
+            scalar = module.operand(type, 2);
+            components = module.operand(type, 3);
+        }
+        size = module.size_of(type);
+        static const VkFormat FLOATS[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+        static const VkFormat SINTS[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+        static const VkFormat UINTS[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+        if (components < 1 || components > 4 || module.operand(scalar, 2) != 32) {
+            throw std::runtime_error("Unsupported vertex input type!");
+        }
+        if (module.opcode(scalar) == OP_TYPE_FLOAT) return FLOATS[components - 1];
+        if (module.opcode(scalar) == OP_TYPE_INT) {
+            return module.operand(scalar, 3) ? SINTS[components - 1] : UINTS[components - 1];
+        }
+        throw std::runtime_error("Unsupported vertex input type!");
+    }
+
+    VkDescriptorType descriptor_type_of(const module_t& module, uint32_t storage, uint32_t type) {
+        if (storage == STORAGE_STORAGE_BUFFER) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        if (storage == STORAGE_UNIFORM) {
+            return module.ids[type].buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+        switch (module.opcode(type)) {
+            case OP_TYPE_SAMPLER:
+                return VK_DESCRIPTOR_TYPE_SAMPLER;
+            case OP_TYPE_SAMPLED_IMAGE:
+                return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            case OP_TYPE_IMAGE: {
+                uint32_t dim = module.operand(type, 3);
+                bool storage_image = module.operand(type, 7) == 2;
+                if (dim == DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                if (dim == DIM_BUFFER) {
+                    return storage_image ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                }
+                return storage_image ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            default:
+                throw std::runtime_error("Unsupported SPIR-V descriptor type!");
+        }
+    }
+}
+
+uint64_t SpirvReflection::hash(const void *code, size_t size_in_bytes) {
+    /*FNV-1a*/
+    uint64_t h = 14695981039346656037ull;
+    auto bytes = static_cast<const uint8_t*>(code);
+    for (size_t i = 0; i < size_in_bytes; ++i) {
+        h = (h ^ bytes[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+const shader_reflection_t &SpirvReflection::reflect(const void *code, size_t size_in_bytes) {
+    static std::mutex lock;
+    static std::unordered_map<uint64_t, std::unique_ptr<shader_reflection_t>> cache;
+    uint64_t h = hash(code, size_in_bytes);
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = cache.find(h);
+    if (it != cache.end()) return *it->second;
+    if (size_in_bytes % 4 != 0 || size_in_bytes < SPIRV_HEADER_WORDS * 4) {
+        throw std::runtime_error("Invalid SPIR-V module!");
+    }
+    /*Copy so the words are aligned no matter where the bytecode lives*/
+    std::vector<uint32_t> words(size_in_bytes / 4);
+    memcpy(words.data(), code, size_in_bytes);
+    auto reflection = std::make_unique<shader_reflection_t>(parse(words.data(), words.size()));
+    reflection->hash = h;
+    return *cache.emplace(h, std::move(reflection)).first->second;
+}
+
+shader_reflection_t SpirvReflection::parse(const uint32_t *words, size_t count) {
+    if (words[0] != SPIRV_MAGIC) {
+        throw std::runtime_error("Invalid SPIR-V module!");
+    }
+    module_t module;
+    module.ids.resize(words[3]);
+    shader_reflection_t reflection{};
+    bool has_entry_point = false;
+    std::vector<uint32_t> variables;
+
+    for (size_t pos = SPIRV_HEADER_WORDS; pos < count;) {
+        const uint32_t* inst = words + pos;
+        uint32_t op = inst[0] & 0xFFFF;
+        uint32_t length = inst[0] >> 16;
+        if (length == 0 || pos + length > count) {
+            throw std::runtime_error("Malformed SPIR-V instruction!");
+        }
+        switch (op) {
+            case OP_ENTRY_POINT:
+                if (!has_entry_point) {
+                    reflection.stage = stage_of(inst[1]);
+                    has_entry_point = true;
+                }
+                break;
+            case OP_DECORATE: {
+                id_info_t& id = module.ids[inst[1]];
+                switch (inst[2]) {
+                    case DECORATION_BLOCK: id.block = true; break;
+                    case DECORATION_BUFFER_BLOCK: id.buffer_block = true; break;
+                    case DECORATION_ARRAY_STRIDE: id.array_stride = inst[3]; break;
+                    case DECORATION_BUILT_IN: id.built_in = true; break;
+                    case DECORATION_LOCATION: id.location = inst[3]; break;
+                    case DECORATION_BINDING: id.binding = inst[3]; break;
+                    case DECORATION_DESCRIPTOR_SET: id.set = inst[3]; break;
+                    case DECORATION_SPEC_ID: reflection.specialization_constants.push_back(inst[3]); break;
+                    default: break;
+                }
+                break;
+            }
+            case OP_MEMBER_DECORATE: {
+                member_info_t& member = module.members[module_t::key(inst[1], inst[2])];
+                if (inst[3] == DECORATION_OFFSET) member.offset = inst[4];
+                if (inst[3] == DECORATION_MATRIX_STRIDE) member.matrix_stride = inst[4];
+                if (inst[3] == DECORATION_BUILT_IN) module.ids[inst[1]].built_in = true;
+                break;
+            }
+            case OP_TYPE_BOOL:
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+            case OP_TYPE_VECTOR:
+            case OP_TYPE_MATRIX:
+            case OP_TYPE_IMAGE:
+            case OP_TYPE_SAMPLER:
+            case OP_TYPE_SAMPLED_IMAGE:
+            case OP_TYPE_ARRAY:
+            case OP_TYPE_RUNTIME_ARRAY:
+            case OP_TYPE_STRUCT:
+            case OP_TYPE_POINTER:
+                module.ids[inst[1]].def = inst;
+                break;
+            case OP_CONSTANT:
+            case OP_VARIABLE:
+                module.ids[inst[2]].def = inst;
+                if (op == OP_VARIABLE) variables.push_back(inst[2]);
+                break;
+            default:
+                break;
+        }
+        pos += length;
+    }
+    if (!has_entry_point) {
+        throw std::runtime_error("SPIR-V module has no entry point!");
+    }
+
+    for (uint32_t var: variables) {
+        const id_info_t& info = module.ids[var];
+        uint32_t storage = module.operand(var, 3);
+        /*Variables are always pointers, reflect the pointee*/
+        uint32_t type = module.operand(module.operand(var, 1), 3);
+        switch (storage) {
+            case STORAGE_INPUT: {
+                if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || info.built_in || module.ids[type].built_in
+                    || info.location == UNDEFINED) break;
+                shader_input_t input{};
+                input.location = info.location;
+                input.format = format_of(module, type, input.size);
+                reflection.inputs.push_back(input);
+                break;
+            }
+            case STORAGE_PUSH_CONSTANT:
+                reflection.push_constant_size = std::max(reflection.push_constant_size, module.size_of(type));
+                break;
+            case STORAGE_UNIFORM_CONSTANT:
+            case STORAGE_UNIFORM:
+            case STORAGE_STORAGE_BUFFER: {
+                if (info.binding == UNDEFINED) break;
+                shader_binding_t binding{};
+                binding.set = info.set == UNDEFINED ? 0 : info.set;
+                binding.binding = info.binding;
+                binding.count = 1;
+                if (module.opcode(type) == OP_TYPE_ARRAY) {
+                    binding.count = module.array_length(type);
+                    type = module.operand(type, 2);
+                } else if (module.opcode(type) == OP_TYPE_RUNTIME_ARRAY) {
+                    binding.count = 0;
+                    type = module.operand(type, 2);
+                }
+                binding.type = descriptor_type_of(module, storage, type);
+                binding.stages = reflection.stage;
+                reflection.bindings.push_back(binding);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const shader_binding_t& a, const shader_binding_t& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const shader_input_t& a, const shader_input_t& b) {
+        return a.location < b.location;
+    });
+    std::sort(reflection.specialization_constants.begin(), reflection.specialization_constants.end());
+    return reflection;
+}
+
+ShaderInterface::ShaderInterface(std::initializer_list<const shader_reflection_t *> stages) {
+    for (const shader_reflection_t* stage: stages) {
+        for (const shader_binding_t& binding: stage->bindings) {
+            auto it = std::find_if(bindings.begin(), bindings.end(), [&](const shader_binding_t& b) {
+                return b.set == binding.set && b.binding == binding.binding;
+            });
+            if (it == bindings.end()) {
+                bindings.push_back(binding);
+            } else if (it->type != binding.type) {
+                throw std::runtime_error("Shader stages disagree on a descriptor type!");
+            } else {
+                it->stages |= binding.stages;
+                it->count = std::max(it->count, binding.count);
+            }
+        }
+        if (stage->stage == VK_SHADER_STAGE_VERTEX_BIT) {
+            inputs = stage->inputs;
+        }
+        for (uint32_t id: stage->specialization_constants) {
+            if (id < 32) specialization_mask |= 1u << id;
+        }
+        if (stage->push_constant_size > 0) {
+            push_constants.stageFlags |= stage->stage;
+            push_constants.size = std::max(push_constants.size, stage->push_constant_size);
+        }
+    }
+    std::sort(bindings.begin(), bindings.end(), [](const shader_binding_t& a, const shader_binding_t& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderInterface::get_set_layout_bindings(uint32_t set) const {
+    std::vector<VkDescriptorSetLayoutBinding> result;
+    for (const shader_binding_t& binding: bindings) {
+        if (binding.set != set) continue;
+        VkDescriptorSetLayoutBinding layoutBinding{};
+        layoutBinding.binding = binding.binding;
+        layoutBinding.descriptorType = binding.type;
+        layoutBinding.descriptorCount = binding.count;
+        layoutBinding.stageFlags = binding.stages;
+        layoutBinding.pImmutableSamplers = nullptr;
+        result.push_back(layoutBinding);
+    }
+    return result;
+}
+
+std::vector<VkDescriptorPoolSize> ShaderInterface::get_pool_sizes(uint32_t set, uint32_t set_count) const {
+    std::vector<VkDescriptorPoolSize> result;
+    for (const shader_binding_t& binding: bindings) {
+        if (binding.set != set) continue;
+        auto it = std::find_if(result.begin(), result.end(), [&](const VkDescriptorPoolSize& size) {
+            return size.type == binding.type;
+        });
+        if (it == result.end()) {
+            result.push_back({binding.type, 0});
+            it = result.end() - 1;
+        }
+        it->descriptorCount += std::max(binding.count, 1u) * set_count;
+    }
+    return result;
+}
+
+uint32_t ShaderInterface::get_vertex_attributes(uint32_t binding, std::vector<VkVertexInputAttributeDescription> &attributes) const {
+    uint32_t offset = 0;
+    for (const shader_input_t& input: inputs) {
+        VkVertexInputAttributeDescription attribute{};
+        attribute.location = input.location;
+        attribute.binding = binding;
+        attribute.format = input.format;
+        attribute.offset = offset;
+        attributes.push_back(attribute);
+        offset += input.size;
+    }
+    return offset;
+}
+
+bool ShaderInterface::select_vertex_attributes(const std::vector<VkVertexInputAttributeDescription> &layout,
+                                               std::vector<VkVertexInputAttributeDescription> &attributes) const {
+    for (const shader_input_t& input: inputs) {
+        auto it = std::find_if(layout.begin(), layout.end(), [&input](const VkVertexInputAttributeDescription& attribute) {
+            return attribute.location == input.location;
+        });
+        if (it == layout.end()) return false;
+        attributes.push_back(*it);
+    }
+    return true;
+}
+
+bool ShaderInterface::get_push_constant_range(VkPushConstantRange &range) const {
+    range = push_constants;
+    return push_constants.size > 0;
+}
+
+uint32_t ShaderInterface::get_specialization_mask() const {
+    return specialization_mask;
+}
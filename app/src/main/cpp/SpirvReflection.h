@@ -0,0 +1,78 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_SPIRVREFLECTION_H
+#define HELLO_VULKAN_SPIRVREFLECTION_H
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct shader_binding_t {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    /*0 for runtime sized arrays*/
+    uint32_t count;
+    VkShaderStageFlags stages;
+};
+
+struct shader_input_t {
+    uint32_t location;
+    VkFormat format;
+    uint32_t size;
+};
+
+struct shader_reflection_t {
+    uint64_t hash;
+    VkShaderStageFlagBits stage;
+    /*Sorted by (set, binding)*/
+    std::vector<shader_binding_t> bindings;
+    /*Vertex stage only, sorted by location*/
+    std::vector<shader_input_t> inputs;
+    uint32_t push_constant_size;
+    /*constant_id of every specialization constant*/
+    std::vector<uint32_t> specialization_constants;
+};
+
+/*
+ * Minimal SPIR-V parser: walks the instruction stream once and resolves descriptor
+ * bindings, push constant block size and vertex inputs from the decorations and
+ * type declarations. Results are cached by a hash of the module bytes, so every
+ * distinct module is parsed once per process.
+ */
+class SpirvReflection {
+private:
+    static shader_reflection_t parse(const uint32_t* words, size_t count);
+public:
+    static uint64_t hash(const void* code, size_t size_in_bytes);
+    /*The returned reference stays valid for the lifetime of the process*/
+    static const shader_reflection_t& reflect(const void* code, size_t size_in_bytes);
+};
+
+/*Merged interface of the stages of one pipeline*/
+class ShaderInterface {
+private:
+    std::vector<shader_binding_t> bindings;
+    std::vector<shader_input_t> inputs;
+    VkPushConstantRange push_constants{};
+    uint32_t specialization_mask = 0;
+public:
+    ShaderInterface(std::initializer_list<const shader_reflection_t*> stages);
+    std::vector<VkDescriptorSetLayoutBinding> get_set_layout_bindings(uint32_t set) const;
+    /*Pool sizes for set_count instances of the given set*/
+    std::vector<VkDescriptorPoolSize> get_pool_sizes(uint32_t set, uint32_t set_count) const;
+    /*Tightly packed attributes in location order for one binding; returns the stride*/
+    uint32_t get_vertex_attributes(uint32_t binding, std::vector<VkVertexInputAttributeDescription>& attributes) const;
+    /*The attributes of a fixed layout the shader reads; false when it reads a location the layout lacks*/
+    bool select_vertex_attributes(const std::vector<VkVertexInputAttributeDescription>& layout,
+                                  std::vector<VkVertexInputAttributeDescription>& attributes) const;
+    bool get_push_constant_range(VkPushConstantRange& range) const;
+    /*Bit N is set when some stage declares constant_id N (N < 32)*/
+    uint32_t get_specialization_mask() const;
+};
+
+
+#endif //HELLO_VULKAN_SPIRVREFLECTION_H
@@ -0,0 +1,199 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "glm/gtc/matrix_transform.hpp"
+#include "VertexFormat.h"
+#include "Simd.h"
+
+namespace {
+    constexpr uint32_t ENCODE_BLOCK = 4;
+
+    /*Four vertices: load as rows of 4 floats, transpose into one register per component*/
+    void encode_block(const mesh_vertex_t* vertices, const glm::vec4* tangents, const vertex_quantization_t& quantization,
+                      packed_vertex_t* out, uint32_t count) {
+        const float* v = reinterpret_cast<const float*>(vertices);
+        simd4f px = simd_load(v), py = simd_load(v + 8), pz = simd_load(v + 16), nx = simd_load(v + 24);
+        simd4f ny = simd_load(v + 4), nz = simd_load(v + 12), u = simd_load(v + 20), w = simd_load(v + 28);
+        simd_transpose(px, py, pz, nx);
+        simd_transpose(ny, nz, u, w);
+        const float* t = reinterpret_cast<const float*>(tangents);
+        simd4f tx = simd_load(t), ty = simd_load(t + 4), tz = simd_load(t + 8), tw = simd_load(t + 12);
+        simd_transpose(tx, ty, tz, tw);
+
+        simd4f zero = simd_splat(0.0f);
+        simd4f one = simd_splat(1.0f);
+        simd4f minus_one = simd_splat(-1.0f);
+        simd4f snorm = simd_splat(32767.0f);
+        int32_t position[3][4];
+        int32_t normal[2][4];
+        uint16_t uv[2][4];
+        int32_t tangent[4][4];
+
+        simd4f inverse = simd_splat(1.0f / quantization.scale);
+        simd_store_int(position[0], simd_mul(simd_clamp(simd_mul(simd_sub(px, simd_splat(quantization.center.x)), inverse), minus_one, one), snorm));
+        simd_store_int(position[1], simd_mul(simd_clamp(simd_mul(simd_sub(py, simd_splat(quantization.center.y)), inverse), minus_one, one), snorm));
+        simd_store_int(position[2], simd_mul(simd_clamp(simd_mul(simd_sub(pz, simd_splat(quantization.center.z)), inverse), minus_one, one), snorm));
+
+        /*Octahedral: project onto |x| + |y| + |z| = 1 and fold the lower half over the diagonals*/
+        simd4f length = simd_max(simd_add(simd_add(simd_abs(nx), simd_abs(ny)), simd_abs(nz)), simd_splat(1e-20f));
+        simd4f ox = simd_div(nx, length);
+        simd4f oy = simd_div(ny, length);
+        simd4f fold_x = simd_mul(simd_sub(one, simd_abs(oy)), simd_select(simd_less(ox, zero), minus_one, one));
+        simd4f fold_y = simd_mul(simd_sub(one, simd_abs(ox)), simd_select(simd_less(oy, zero), minus_one, one));
+        simd4f lower = simd_less(nz, zero);
+        simd_store_int(normal[0], simd_mul(simd_clamp(simd_select(lower, fold_x, ox), minus_one, one), snorm));
+        simd_store_int(normal[1], simd_mul(simd_clamp(simd_select(lower, fold_y, oy), minus_one, one), snorm));
+
+        simd_store_half(uv[0], u);
+        simd_store_half(uv[1], w);
+
+        simd4f half = simd_splat(0.5f);
+        simd4f unorm10 = simd_splat(1023.0f);
+        simd_store_int(tangent[0], simd_mul(simd_clamp(simd_madd(tx, half, half), zero, one), unorm10));
+        simd_store_int(tangent[1], simd_mul(simd_clamp(simd_madd(ty, half, half), zero, one), unorm10));
+        simd_store_int(tangent[2], simd_mul(simd_clamp(simd_madd(tz, half, half), zero, one), unorm10));
+        simd_store_int(tangent[3], simd_select(simd_less(tw, zero), zero, simd_splat(3.0f)));
+
+        for (uint32_t i = 0; i < count; ++i) {
+            packed_vertex_t& packed = out[i];
+            packed.position[0] = static_cast<int16_t>(position[0][i]);
+            packed.position[1] = static_cast<int16_t>(position[1][i]);
+            packed.position[2] = static_cast<int16_t>(position[2][i]);
+            packed.position[3] = 32767;
+            packed.normal[0] = static_cast<int16_t>(normal[0][i]);
+            packed.normal[1] = static_cast<int16_t>(normal[1][i]);
+            packed.uv[0] = uv[0][i];
+            packed.uv[1] = uv[1][i];
+            packed.tangent = static_cast<uint32_t>(tangent[0][i]) | static_cast<uint32_t>(tangent[1][i]) << 10
+                             | static_cast<uint32_t>(tangent[2][i]) << 20 | static_cast<uint32_t>(tangent[3][i]) << 30;
+        }
+    }
+}
+
+vertex_quantization_t make_vertex_quantization(const glm::vec3 &bounds_min, const glm::vec3 &bounds_max) {
+    glm::vec3 extent = (bounds_max - bounds_min) * 0.5f;
+    float scale = std::max({extent.x, extent.y, extent.z});
+    /*Empty or flat in every axis, and the FLT_MAX bounds of primitives without vertices*/
+    if (!(scale > 1e-20f) || !std::isfinite(scale)) {
+        return {glm::vec3(0.0f), 1.0f};
+    }
+    return {(bounds_min + bounds_max) * 0.5f, scale};
+}
+
+glm::mat4 dequantization_matrix(vertex_format_t format, const vertex_quantization_t &quantization) {
+    if (format == vertex_format_t::FLOAT) return glm::mat4(1.0f);
+    return glm::scale(glm::translate(glm::mat4(1.0f), quantization.center), glm::vec3(quantization.scale));
+}
+
+const char *vertex_format_name(vertex_format_t format) {
+    return format == vertex_format_t::PACKED ? "packed" : "float";
+}
+
+uint32_t vertex_format_stride(vertex_format_t format) {
+    return format == vertex_format_t::PACKED ? sizeof(packed_vertex_t) : sizeof(mesh_vertex_t);
+}
+
+uint32_t get_vertex_layout(vertex_format_t format, std::vector<VkVertexInputAttributeDescription> &attributes) {
+    if (format == vertex_format_t::PACKED) {
+        attributes.push_back({0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(packed_vertex_t, position)});
+        attributes.push_back({1, 0, VK_FORMAT_R16G16_SNORM, offsetof(packed_vertex_t, normal)});
+        attributes.push_back({2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(packed_vertex_t, uv)});
+        attributes.push_back({3, 0, VK_FORMAT_A2B10G10R10_UNORM_PACK32, offsetof(packed_vertex_t, tangent)});
+    } else {
+        attributes.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(mesh_vertex_t, position)});
+        attributes.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(mesh_vertex_t, normal)});
+        attributes.push_back({2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(mesh_vertex_t, uv)});
+    }
+    return vertex_format_stride(format);
+}
+
+void compute_tangents(const mesh_vertex_t *vertices, uint32_t vertex_count, const uint32_t *indices, uint32_t index_count,
+                      glm::vec4 *tangents) {
+    std::vector<glm::vec3> sums(vertex_count * 2, glm::vec3(0.0f));
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        const mesh_vertex_t& a = vertices[indices[i]];
+        const mesh_vertex_t& b = vertices[indices[i + 1]];
+        const mesh_vertex_t& c = vertices[indices[i + 2]];
+        glm::vec3 edge1 = b.position - a.position;
+        glm::vec3 edge2 = c.position - a.position;
+        glm::vec2 delta1 = b.uv - a.uv;
+        glm::vec2 delta2 = c.uv - a.uv;
+        float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+        if (std::fabs(determinant) < 1e-20f) continue;
+        /*Lengyel: solve the edges for the directions u and v grow in, summed per vertex*/
+        glm::vec3 tangent = (edge1 * delta2.y - edge2 * delta1.y) / determinant;
+        glm::vec3 bitangent = (edge2 * delta1.x - edge1 * delta2.x) / determinant;
+        for (int k = 0; k < 3; ++k) {
+            sums[indices[i + k] * 2] += tangent;
+            sums[indices[i + k] * 2 + 1] += bitangent;
+        }
+    }
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        const glm::vec3& normal = vertices[v].normal;
+        /*Gram-Schmidt against the normal, any perpendicular when the uvs are degenerate*/
+        glm::vec3 tangent = sums[v * 2] - normal * glm::dot(normal, sums[v * 2]);
+        float length = glm::length(tangent);
+        if (!(length > 1e-20f)) {
+            glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            tangent = glm::cross(normal, axis);
+            length = glm::length(tangent);
+        }
+        tangent = length > 1e-20f ? tangent / length : glm::vec3(1.0f, 0.0f, 0.0f);
+        float sign = glm::dot(glm::cross(normal, tangent), sums[v * 2 + 1]) < 0.0f ? -1.0f : 1.0f;
+        tangents[v] = glm::vec4(tangent, sign);
+    }
+}
+
+void encode_packed_vertices(const mesh_vertex_t *vertices, const glm::vec4 *tangents, uint32_t count,
+                            const vertex_quantization_t &quantization, packed_vertex_t *out) {
+    uint32_t i = 0;
+    for (; i + ENCODE_BLOCK <= count; i += ENCODE_BLOCK) {
+        encode_block(vertices + i, tangents + i, quantization, out + i, ENCODE_BLOCK);
+    }
+    if (i < count) {
+        /*The tail goes through the same block, padded*/
+        mesh_vertex_t tail_vertices[ENCODE_BLOCK]{};
+        glm::vec4 tail_tangents[ENCODE_BLOCK]{};
+        std::copy(vertices + i, vertices + count, tail_vertices);
+        std::copy(tangents + i, tangents + count, tail_tangents);
+        encode_block(tail_vertices, tail_tangents, quantization, out + i, count - i);
+    }
+}
+
+void encode_vertices(vertex_format_t format, const mesh_vertex_t *vertices, uint32_t vertex_count, const uint32_t *indices,
+                     uint32_t index_count, const vertex_quantization_t &quantization, uint8_t *out) {
+    if (format == vertex_format_t::FLOAT) {
+        memcpy(out, vertices, vertex_count * sizeof(mesh_vertex_t));
+        return;
+    }
+    std::vector<glm::vec4> tangents(vertex_count);
+    compute_tangents(vertices, vertex_count, indices, index_count, tangents.data());
+    encode_packed_vertices(vertices, tangents.data(), vertex_count, quantization, reinterpret_cast<packed_vertex_t*>(out));
+}
+
+std::vector<uint8_t> encode_scene_vertices(const mesh_scene_t &scene, vertex_format_t format, JobSystem *jobs) {
+    uint32_t stride = vertex_format_stride(format);
+    std::vector<uint8_t> data(scene.vertices.size() * stride);
+    auto encode = [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; ++i) {
+            const mesh_primitive_t& primitive = scene.primitives[i];
+            if (primitive.vertex_count == 0) continue;
+            encode_vertices(format, &scene.vertices[primitive.vertex_offset], primitive.vertex_count,
+                            &scene.indices[primitive.first_index], primitive.index_count,
+                            make_vertex_quantization(primitive.bounds_min, primitive.bounds_max),
+                            &data[static_cast<size_t>(primitive.vertex_offset) * stride]);
+        }
+    };
+    uint32_t primitive_count = static_cast<uint32_t>(scene.primitives.size());
+    if (jobs) {
+        jobs->wait(jobs->parallel_for(primitive_count, 1, encode));
+    } else {
+        encode(0, primitive_count);
+    }
+    return data;
+}
@@ -0,0 +1,68 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VERTEXFORMAT_H
+#define HELLO_VULKAN_VERTEXFORMAT_H
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "Mesh.h"
+#include "JobSystem.h"
+
+enum class vertex_format_t : uint8_t {
+    /*mesh_vertex_t as loaded, 32 bytes, read by simple.vert*/
+    FLOAT,
+    /*packed_vertex_t, 20 bytes including a tangent, read by packed.vert*/
+    PACKED
+};
+
+/*
+ * Vertex the GPU reads in the PACKED format. A float vertex carrying the same
+ * tangent would take 48 bytes.
+ */
+struct packed_vertex_t {
+    /*R16G16B16A16_SNORM: position inside the primitive's quantization cube, w is 1*/
+    int16_t position[4];
+    /*R16G16_SNORM: octahedral normal*/
+    int16_t normal[2];
+    /*R16G16_SFLOAT*/
+    uint16_t uv[2];
+    /*A2B10G10R10_UNORM_PACK32: xyz * 0.5 + 0.5, bitangent sign in a (0 negative, 3 positive)*/
+    uint32_t tangent;
+};
+
+static_assert(sizeof(packed_vertex_t) == 20, "packed_vertex_t must be tightly packed!");
+
+/*Maps a primitive's bounds onto [-1, 1]; uniform so normals keep their direction*/
+struct vertex_quantization_t {
+    glm::vec3 center;
+    float scale;
+};
+
+vertex_quantization_t make_vertex_quantization(const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+/*Turns quantized positions back into object space, identity for FLOAT*/
+glm::mat4 dequantization_matrix(vertex_format_t format, const vertex_quantization_t& quantization);
+
+const char* vertex_format_name(vertex_format_t format);
+uint32_t vertex_format_stride(vertex_format_t format);
+/*Attributes of binding 0 by location: position, normal, uv and for PACKED tangent; returns the stride*/
+uint32_t get_vertex_layout(vertex_format_t format, std::vector<VkVertexInputAttributeDescription>& attributes);
+
+/*Per vertex tangents from the uv gradients of the triangles around it, w is the bitangent sign*/
+void compute_tangents(const mesh_vertex_t* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count,
+                      glm::vec4* tangents);
+/*Quantizes four vertices per step with NEON or SSE, see Simd.h*/
+void encode_packed_vertices(const mesh_vertex_t* vertices, const glm::vec4* tangents, uint32_t count,
+                            const vertex_quantization_t& quantization, packed_vertex_t* out);
+/*
+ * Writes count * vertex_format_stride(format) bytes of one primitive's vertices to out;
+ * indices are only read for the tangents.
+ */
+void encode_vertices(vertex_format_t format, const mesh_vertex_t* vertices, uint32_t vertex_count, const uint32_t* indices,
+                     uint32_t index_count, const vertex_quantization_t& quantization, uint8_t* out);
+/*All of scene.vertices in format, every primitive quantized by its own bounds; parallel on jobs when given*/
+std::vector<uint8_t> encode_scene_vertices(const mesh_scene_t& scene, vertex_format_t format, JobSystem* jobs = nullptr);
+
+
+#endif //HELLO_VULKAN_VERTEXFORMAT_H
@@ -0,0 +1,125 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "VkBindlessTable.h"
+#include "Log.h"
+
+static const char* TAG = "VkBindlessTable";
+
+VkBindlessTable::VkBindlessTable(VkDevice _device, uint32_t max_textures, uint32_t _capacity): device(_device) {
+    capacity = std::min(_capacity, max_textures);
+    if (capacity == 0) {
+        throw std::runtime_error("Device has no update-after-bind sampler descriptors!");
+    }
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = capacity;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    /*Unwritten slots are fine as long as no draw indexes them*/
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 1;
+    flagsInfo.pBindingFlags = &bindingFlags;
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, layout.put(device)) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = capacity;
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, pool.put(device)) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = layout.ptr();
+    if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bindless descriptor set!");
+    }
+
+    /*Lowest slots first*/
+    free_slots.resize(capacity);
+    for (uint32_t i = 0; i < capacity; ++i) {
+        free_slots[i] = capacity - 1 - i;
+    }
+    LOGI(TAG, "Bindless texture table with %u slots", capacity);
+}
+
+void VkBindlessTable::write(uint32_t slot, VkImageView view, VkSampler sampler) {
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = view;
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = set;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = slot;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    ++writes;
+}
+
+uint32_t VkBindlessTable::add(VkImageView view, VkSampler sampler) {
+    if (free_slots.empty()) {
+        throw std::runtime_error("Bindless texture table is full!");
+    }
+    uint32_t slot = free_slots.back();
+    free_slots.pop_back();
+    write(slot, view, sampler);
+    return slot;
+}
+
+void VkBindlessTable::remove(uint32_t slot, uint64_t value) {
+    if (slot >= capacity) {
+        throw std::out_of_range("Invalid bindless texture slot!");
+    }
+    if (!pending.empty() && pending.back().value > value) {
+        throw std::runtime_error("Bindless retire values must not decrease!");
+    }
+    pending.push_back({value, slot});
+}
+
+void VkBindlessTable::collect(uint64_t completed) {
+    while (!pending.empty() && pending.front().value <= completed) {
+        free_slots.push_back(pending.front().slot);
+        pending.pop_front();
+    }
+}
+
+VkDescriptorSetLayout VkBindlessTable::get_layout() const {
+    return layout;
+}
+
+VkDescriptorSet VkBindlessTable::get_set() const {
+    return set;
+}
+
+bindless_stats_t VkBindlessTable::get_stats() const {
+    uint32_t pending_free = static_cast<uint32_t>(pending.size());
+    return {capacity, capacity - static_cast<uint32_t>(free_slots.size()) - pending_free, pending_free, writes};
+}
@@ -0,0 +1,64 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKBINDLESSTABLE_H
+#define HELLO_VULKAN_VKBINDLESSTABLE_H
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkUnique.h"
+
+struct bindless_stats_t {
+    uint32_t capacity;
+    uint32_t live;
+    uint32_t pending_free;
+    uint64_t writes;
+};
+
+/*
+ * One descriptor set holding a large, partially bound array of combined image samplers
+ * (set BINDLESS_SET, binding 0). Shaders index it with a slot from the per-draw data,
+ * so the set is bound once per frame no matter how many textures the draws use.
+ *
+ * The binding is update-after-bind: slots can be written while command buffers that
+ * bound the set are recorded or pending, as long as those command buffers do not read
+ * them. Freed slots are therefore only reused once the frames that could still sample
+ * them have completed.
+ */
+class VkBindlessTable {
+private:
+    struct pending_slot_t {
+        uint64_t value;
+        uint32_t slot;
+    };
+    VkDevice device;
+    uint32_t capacity;
+    VkUniqueDescriptorSetLayout layout;
+    VkUniqueDescriptorPool pool;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    std::vector<uint32_t> free_slots;
+    std::deque<pending_slot_t> pending;
+    uint64_t writes = 0;
+    void write(uint32_t slot, VkImageView view, VkSampler sampler);
+public:
+    static constexpr uint32_t BINDLESS_SET = 1;
+    static constexpr uint32_t MAX_TEXTURES = 4096;
+    /*capacity is clamped to max_textures, the update-after-bind limit of the device (device_features_t)*/
+    VkBindlessTable(VkDevice device, uint32_t max_textures, uint32_t capacity = MAX_TEXTURES);
+    VkBindlessTable(const VkBindlessTable&) = delete;
+    VkBindlessTable& operator=(const VkBindlessTable&) = delete;
+    /*Writes the texture into a free slot and returns the slot*/
+    uint32_t add(VkImageView view, VkSampler sampler);
+    /*The slot may be reused once the submission with value has completed; values must not decrease*/
+    void remove(uint32_t slot, uint64_t value);
+    /*Returns slots retired with a value <= completed to the free list*/
+    void collect(uint64_t completed);
+    VkDescriptorSetLayout get_layout() const;
+    VkDescriptorSet get_set() const;
+    bindless_stats_t get_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKBINDLESSTABLE_H
@@ -2,7 +2,10 @@
 // Created by 86187 on 2026/2/6.
 //
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <string>
 #include "VkContext.h"
 #include "Log.h"
 
@@ -54,13 +57,35 @@ bool VkContext::is_suitable(VkPhysicalDevice gpu) {
     return true;
 }
 
+bool VkContext::has_device_extension(VkPhysicalDevice gpu, const char *name) {
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(gpu, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(gpu, nullptr, &count, extensions.data());
+    for (const VkExtensionProperties& extension: extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PFN_vkVoidFunction VkContext::get_device_function(const char *name, const char *suffix) {
+    PFN_vkVoidFunction function = vkGetDeviceProcAddr(dev, name);
+    if (function == nullptr && suffix != nullptr) {
+        std::string extension_name = std::string(name) + suffix;
+        function = vkGetDeviceProcAddr(dev, extension_name.c_str());
+    }
+    return function;
+}
+
 bool VkContext::find_queue_families(VkPhysicalDevice gpu) {
     uint32_t count = 0;
     std::vector<VkQueueFamilyProperties> families;
     vkGetPhysicalDeviceQueueFamilyProperties(gpu, &count, nullptr);
     families.resize(count);
     vkGetPhysicalDeviceQueueFamilyProperties(gpu, &count, families.data());
-    for (int i = 0; i < families.size(); ++i) {
+    for (uint32_t i = 0; i < families.size(); ++i) {
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(gpu, i, surface, &presentSupport);
         if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && presentSupport) {
@@ -116,6 +141,14 @@ swap_chain_format_t VkContext::choose_swap_chain_format() {
 }
 
 void VkContext::create_instance() {
+    /*A 1.0 loader has no vkEnumerateInstanceVersion and may reject any other apiVersion*/
+    auto enumerate_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+    instance_version = VK_API_VERSION_1_0;
+    if (enumerate_version == nullptr || enumerate_version(&instance_version) != VK_SUCCESS) {
+        instance_version = VK_API_VERSION_1_0;
+    }
+    instance_version = std::min(instance_version, VK_API_VERSION_1_3);
+
     /*Create instance*/
     VkApplicationInfo applicationInfo{};
     applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -123,7 +156,7 @@ void VkContext::create_instance() {
     applicationInfo.pEngineName = "No Name";
     applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    applicationInfo.apiVersion = VK_API_VERSION_1_3;
+    applicationInfo.apiVersion = instance_version;
 
     const std::vector<const char*> enabledLayerNames = {
 //            "VK_LAYER_KHRONOS_validation"
@@ -143,6 +176,10 @@ void VkContext::create_instance() {
     if (vkCreateInstance(&instanceCreateInfo, nullptr, &instance) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create vkInstance!");
     }
+    if (instance_version >= VK_API_VERSION_1_1) {
+        get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+        get_properties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+    }
 }
 
 void VkContext::create_logic_device() {
@@ -159,19 +196,108 @@ void VkContext::create_logic_device() {
     float priority = 1.0f;
     queueCreateInfo.pQueuePriorities = &priority;
 
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(GPU, &properties);
+    /*A device version above the instance's cannot be used*/
+    features.api_version = std::min(properties.apiVersion, instance_version);
+
+    /*Vulkan 1.2/1.3 features are only queried and enabled when both the device and the instance have that version*/
+    bool core12 = features.api_version >= VK_API_VERSION_1_2 && get_features2 != nullptr;
+    bool core13 = core12 && features.api_version >= VK_API_VERSION_1_3;
+    /*Before 1.3 extended dynamic state is an extension with a feature of its own*/
+    bool dynamic_state_extension = core12 && !core13 && has_device_extension(GPU, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT supportedDynamicState{};
+    supportedDynamicState.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    VkPhysicalDeviceVulkan13Features supported13{};
+    supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_13_FEATURES;
+    VkPhysicalDeviceVulkan12Features supported12{};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    supported12.pNext = core13 ? static_cast<void*>(&supported13) : dynamic_state_extension ? &supportedDynamicState : nullptr;
+    VkPhysicalDeviceFeatures2 supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = &supported12;
+    if (core12) {
+        get_features2(GPU, &supported);
+    } else {
+        vkGetPhysicalDeviceFeatures(GPU, &supported.features);
+    }
+    features.dynamic_rendering = supported13.dynamicRendering;
+    dynamic_state_extension = dynamic_state_extension && supportedDynamicState.extendedDynamicState;
+    features.extended_dynamic_state = core13 || dynamic_state_extension;
+    features.descriptor_indexing = supported.features.shaderSampledImageArrayDynamicIndexing && supported12.runtimeDescriptorArray
+                                   && supported12.descriptorBindingPartiallyBound && supported12.descriptorBindingSampledImageUpdateAfterBind
+                                   && get_properties2 != nullptr;
+    if (features.descriptor_indexing) {
+        /*Combined image samplers count against both the sampler and the sampled image limits*/
+        VkPhysicalDeviceDescriptorIndexingProperties indexing{};
+        indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &indexing;
+        get_properties2(GPU, &properties2);
+        features.max_bindless_textures = std::min({indexing.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                   indexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                   indexing.maxDescriptorSetUpdateAfterBindSamplers,
+                                                   indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+                                                   indexing.maxUpdateAfterBindDescriptorsInAllPools});
+    }
+    features.draw_indirect_first_instance = supported.features.drawIndirectFirstInstance;
+    features.multi_draw_indirect = supported.features.multiDrawIndirect;
+    /*The limit is 1 unless multiDrawIndirect is enabled*/
+    features.max_draw_indirect_count = features.multi_draw_indirect ? properties.limits.maxDrawIndirectCount : 1;
+
     VkDeviceCreateInfo deviceCreateInfo{};
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = features.descriptor_indexing;
+    deviceFeatures.drawIndirectFirstInstance = features.draw_indirect_first_instance;
+    deviceFeatures.multiDrawIndirect = features.multi_draw_indirect;
+    VkPhysicalDeviceVulkan13Features enabled13{};
+    enabled13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_13_FEATURES;
+    enabled13.dynamicRendering = features.dynamic_rendering;
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT enabledDynamicState{};
+    enabledDynamicState.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    enabledDynamicState.extendedDynamicState = dynamic_state_extension;
+    VkPhysicalDeviceVulkan12Features enabled12{};
+    enabled12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    enabled12.pNext = core13 ? static_cast<void*>(&enabled13) : dynamic_state_extension ? &enabledDynamicState : nullptr;
+    enabled12.runtimeDescriptorArray = features.descriptor_indexing;
+    enabled12.descriptorBindingPartiallyBound = features.descriptor_indexing;
+    enabled12.descriptorBindingSampledImageUpdateAfterBind = features.descriptor_indexing;
+    enabled12.drawIndirectCount = core12 && supported12.drawIndirectCount;
+    VkPhysicalDeviceFeatures2 enabledFeatures{};
+    enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    enabledFeatures.pNext = &enabled12;
+    enabledFeatures.features = deviceFeatures;
     const std::vector<const char*> enabledDeviceLayerNames = {
 
     };
-    const std::vector<const char*> enabledDeviceExtensionNames = {
+    std::vector<const char*> enabledDeviceExtensionNames = {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
+    features.descriptor_update_template = features.api_version >= VK_API_VERSION_1_1;
+    if (!features.descriptor_update_template && has_device_extension(GPU, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+        features.descriptor_update_template = true;
+        enabledDeviceExtensionNames.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    }
+    features.push_descriptor = features.descriptor_update_template && has_device_extension(GPU, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    if (features.push_descriptor) {
+        enabledDeviceExtensionNames.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+    if (dynamic_state_extension) {
+        enabledDeviceExtensionNames.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    }
+    features.draw_indirect_count = enabled12.drawIndirectCount;
+    if (!features.draw_indirect_count && has_device_extension(GPU, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+        features.draw_indirect_count = true;
+        enabledDeviceExtensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
     deviceCreateInfo.queueCreateInfoCount = 1;
-    deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
+    /*Features2 replaces pEnabledFeatures when it is chained*/
+    deviceCreateInfo.pNext = core12 ? &enabledFeatures : nullptr;
+    deviceCreateInfo.pEnabledFeatures = core12 ? nullptr : &deviceFeatures;
     deviceCreateInfo.enabledLayerCount = enabledDeviceLayerNames.size();
     deviceCreateInfo.ppEnabledLayerNames = enabledDeviceLayerNames.data();
     deviceCreateInfo.enabledExtensionCount = enabledDeviceExtensionNames.size();
@@ -179,11 +305,32 @@ void VkContext::create_logic_device() {
     if (vkCreateDevice(GPU, &deviceCreateInfo, nullptr, &dev) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create vkDevice!");
     }
+    if (features.dynamic_rendering) {
+        functions.begin_rendering = reinterpret_cast<PFN_vkCmdBeginRendering>(get_device_function("vkCmdBeginRendering"));
+        functions.end_rendering = reinterpret_cast<PFN_vkCmdEndRendering>(get_device_function("vkCmdEndRendering"));
+        features.dynamic_rendering = functions.begin_rendering && functions.end_rendering;
+    }
+    if (features.extended_dynamic_state) {
+        const char* suffix = core13 ? nullptr : "EXT";
+        functions.set_cull_mode = reinterpret_cast<PFN_vkCmdSetCullMode>(get_device_function("vkCmdSetCullMode", suffix));
+        functions.set_front_face = reinterpret_cast<PFN_vkCmdSetFrontFace>(get_device_function("vkCmdSetFrontFace", suffix));
+        functions.set_primitive_topology = reinterpret_cast<PFN_vkCmdSetPrimitiveTopology>(
+                get_device_function("vkCmdSetPrimitiveTopology", suffix));
+        functions.set_depth_test_enable = reinterpret_cast<PFN_vkCmdSetDepthTestEnable>(get_device_function("vkCmdSetDepthTestEnable", suffix));
+        functions.set_depth_write_enable = reinterpret_cast<PFN_vkCmdSetDepthWriteEnable>(
+                get_device_function("vkCmdSetDepthWriteEnable", suffix));
+        functions.set_depth_compare_op = reinterpret_cast<PFN_vkCmdSetDepthCompareOp>(get_device_function("vkCmdSetDepthCompareOp", suffix));
+        features.extended_dynamic_state = functions.set_cull_mode && functions.set_front_face && functions.set_primitive_topology
+                                          && functions.set_depth_test_enable && functions.set_depth_write_enable
+                                          && functions.set_depth_compare_op;
+    }
     vkGetDeviceQueue(dev, graphics_queue_info.index, 0, &graphics_queue_info.queue);
     vkGetDeviceQueue(dev, present_queue_info.index, 0, &present_queue_info.queue);
+    LOGI(TAG, "Device API %u.%u, dynamic rendering %s, descriptor indexing %s", features.api_version >> 22, (features.api_version >> 12) & 0x3FF,
+         features.dynamic_rendering ? "supported" : "unsupported", features.descriptor_indexing ? "supported" : "unsupported");
 }
 
-void VkContext::create_swap_chain() {
+void VkContext::create_swap_chain(VkSwapchainKHR old_swap_chain) {
     /*Create swap chain*/
     choose_swap_chain_format();
     VkSwapchainCreateInfoKHR swapchainCreateInfo{};
@@ -202,12 +349,20 @@ void VkContext::create_swap_chain() {
     swapchainCreateInfo.preTransform = swap_chain_details.capabilities.currentTransform;
     swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchainCreateInfo.clipped = VK_TRUE;
-    swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    swapchainCreateInfo.oldSwapchain = old_swap_chain;
     if (vkCreateSwapchainKHR(dev, &swapchainCreateInfo, nullptr, &swap_chain) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create vkSwapChainKHR!");
     }
 }
 
+void VkContext::recreate_swap_chain() {
+    vkDeviceWaitIdle(dev);
+    query_swap_chain_details(GPU);
+    VkSwapchainKHR old_swap_chain = swap_chain;
+    create_swap_chain(old_swap_chain);
+    vkDestroySwapchainKHR(dev, old_swap_chain, nullptr);
+}
+
 void VkContext::create_surface() {
     /*Create surface*/
     VkAndroidSurfaceCreateInfoKHR surfaceCreateInfo{};
@@ -244,3 +399,11 @@ queue_info_t VkContext::get_queue_info(const queue_type_t& type) {
         throw std::invalid_argument("Unknown queue type");
     }
 }
+
+const device_features_t &VkContext::get_features() const {
+    return features;
+}
+
+const device_functions_t &VkContext::get_functions() const {
+    return functions;
+}
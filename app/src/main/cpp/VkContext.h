@@ -27,6 +27,45 @@ struct queue_info_t {
     VkQueue queue;
 };
 
+/*Optional capabilities that were found and enabled on the logical device*/
+struct device_features_t {
+    uint32_t api_version;
+    bool dynamic_rendering;
+    /*Cull mode, front face, topology and depth state via vkCmdSet*, core in 1.3 or VK_EXT_extended_dynamic_state*/
+    bool extended_dynamic_state;
+    /*Partially bound, update-after-bind sampler arrays indexed per draw, core in 1.2*/
+    bool descriptor_indexing;
+    /*Update-after-bind combined image samplers a set may hold, 0 without descriptor indexing*/
+    uint32_t max_bindless_textures;
+    /*Descriptor update templates, core in 1.1 or VK_KHR_descriptor_update_template*/
+    bool descriptor_update_template;
+    /*VK_KHR_push_descriptor: sets written straight into the command buffer, needs update templates here*/
+    bool push_descriptor;
+    /*Indirect draws may start at a non-zero instance, which indexes the per-draw data*/
+    bool draw_indirect_first_instance;
+    /*More than one draw per indirect call, up to max_draw_indirect_count*/
+    bool multi_draw_indirect;
+    uint32_t max_draw_indirect_count;
+    /*Draw count read from a buffer, core in 1.2 or VK_KHR_draw_indirect_count*/
+    bool draw_indirect_count;
+};
+
+/*
+ * Entry points newer than Vulkan 1.0. The libvulkan.so of older API levels only exports
+ * 1.0, so they are looked up on the device; null when the device does not provide them.
+ */
+struct device_functions_t {
+    PFN_vkCmdBeginRendering begin_rendering;
+    PFN_vkCmdEndRendering end_rendering;
+    /*Core in 1.3, the VK_EXT_extended_dynamic_state names otherwise*/
+    PFN_vkCmdSetCullMode set_cull_mode;
+    PFN_vkCmdSetFrontFace set_front_face;
+    PFN_vkCmdSetPrimitiveTopology set_primitive_topology;
+    PFN_vkCmdSetDepthTestEnable set_depth_test_enable;
+    PFN_vkCmdSetDepthWriteEnable set_depth_write_enable;
+    PFN_vkCmdSetDepthCompareOp set_depth_compare_op;
+};
+
 enum class queue_type_t {
     GRAPHICS,
     PRESENT
@@ -44,23 +83,36 @@ private:
     swap_chain_details_t swap_chain_details{};
     queue_info_t graphics_queue_info{};
     queue_info_t present_queue_info{};
+    device_features_t features{};
+    device_functions_t functions{};
+    /*Highest version both the loader and the instance support*/
+    uint32_t instance_version = 0;
+    /*Null on a Vulkan 1.0 instance*/
+    PFN_vkGetPhysicalDeviceFeatures2 get_features2 = nullptr;
+    PFN_vkGetPhysicalDeviceProperties2 get_properties2 = nullptr;
     VkPhysicalDevice find_GPU();
     bool is_suitable(VkPhysicalDevice gpu);
+    bool has_device_extension(VkPhysicalDevice gpu, const char* name);
+    /*Looks up name, then name with suffix appended; null if neither exists*/
+    PFN_vkVoidFunction get_device_function(const char* name, const char* suffix = nullptr);
     bool find_queue_families(VkPhysicalDevice gpu);
     void query_swap_chain_details(VkPhysicalDevice gpu);
     swap_chain_format_t choose_swap_chain_format();
     void create_instance();
     void create_logic_device();
-    void create_swap_chain();
+    void create_swap_chain(VkSwapchainKHR old_swap_chain = VK_NULL_HANDLE);
     void create_surface();
 public:
     explicit VkContext(ANativeWindow* _window);
     virtual ~VkContext();
+    void recreate_swap_chain();
     VkSwapchainKHR get_swap_chain();
     swap_chain_format_t get_swap_chain_format();
     VkDevice get_device();
     VkPhysicalDevice get_physical_device();
     queue_info_t get_queue_info(const queue_type_t& type);
+    const device_features_t& get_features() const;
+    const device_functions_t& get_functions() const;
 };
 
 
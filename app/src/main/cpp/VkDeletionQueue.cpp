@@ -0,0 +1,87 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <stdexcept>
+#include "VkDeletionQueue.h"
+#include "Log.h"
+
+static const char* TAG = "VkDeletionQueue";
+
+template<typename T>
+static T from_u64(uint64_t handle) {
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(static_cast<uintptr_t>(handle));
+    } else {
+        return static_cast<T>(handle);
+    }
+}
+
+VkDeletionQueue::VkDeletionQueue(VkDevice _device): device(_device) {
+
+}
+
+void VkDeletionQueue::set_device(VkDevice _device) {
+    device = _device;
+}
+
+void VkDeletionQueue::retire_handle(uint64_t value, VkObjectType type, uint64_t handle) {
+    if (handle == 0) return;
+    if (!entries.empty() && entries.back().value > value) {
+        throw std::runtime_error("Deletion queue values must not decrease!");
+    }
+    entries.push_back({value, type, handle});
+}
+
+size_t VkDeletionQueue::collect(uint64_t completed) {
+    size_t count = 0;
+    while (!entries.empty() && entries.front().value <= completed) {
+        destroy(entries.front());
+        entries.pop_front();
+        ++count;
+    }
+    return count;
+}
+
+void VkDeletionQueue::flush() {
+    for (const entry_t& entry: entries) {
+        destroy(entry);
+    }
+    entries.clear();
+}
+
+size_t VkDeletionQueue::size() const {
+    return entries.size();
+}
+
+void VkDeletionQueue::destroy(const entry_t &entry) {
+    switch (entry.type) {
+        case VK_OBJECT_TYPE_BUFFER:
+            vkDestroyBuffer(device, from_u64<VkBuffer>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE:
+            vkDestroyImage(device, from_u64<VkImage>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE_VIEW:
+            vkDestroyImageView(device, from_u64<VkImageView>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:
+            vkFreeMemory(device, from_u64<VkDeviceMemory>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_SAMPLER:
+            vkDestroySampler(device, from_u64<VkSampler>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_FRAMEBUFFER:
+            vkDestroyFramebuffer(device, from_u64<VkFramebuffer>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_PIPELINE:
+            vkDestroyPipeline(device, from_u64<VkPipeline>(entry.handle), nullptr);
+            break;
+        case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+            vkDestroyDescriptorPool(device, from_u64<VkDescriptorPool>(entry.handle), nullptr);
+            break;
+        default:
+            LOGW(TAG, "Unable to destroy object of type %d", entry.type);
+            break;
+    }
+}
@@ -0,0 +1,56 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKDELETIONQUEUE_H
+#define HELLO_VULKAN_VKDELETIONQUEUE_H
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <vulkan/vulkan.h>
+
+/*
+ * Defers destruction of Vulkan objects until the GPU is done with them. Objects are
+ * retired with the value of the submission that may still reference them (frame
+ * counter or timeline semaphore value) and destroyed by collect() once that value
+ * has completed. Values must be retired in non-decreasing order.
+ */
+class VkDeletionQueue {
+private:
+    struct entry_t {
+        uint64_t value;
+        VkObjectType type;
+        uint64_t handle;
+    };
+    VkDevice device;
+    std::deque<entry_t> entries;
+    void destroy(const entry_t& entry);
+    void retire_handle(uint64_t value, VkObjectType type, uint64_t handle);
+    template<typename T>
+    static uint64_t to_u64(T handle) {
+        if constexpr (std::is_pointer_v<T>) {
+            return reinterpret_cast<uintptr_t>(handle);
+        } else {
+            return static_cast<uint64_t>(handle);
+        }
+    }
+public:
+    explicit VkDeletionQueue(VkDevice device = VK_NULL_HANDLE);
+    void set_device(VkDevice);
+    /*
+     * The object type is explicit because non-dispatchable handles are all uint64_t on
+     * 32-bit ABIs, so they can not be told apart by overloading.
+     */
+    template<typename T>
+    void retire(uint64_t value, VkObjectType type, T handle) {
+        retire_handle(value, type, to_u64(handle));
+    }
+    /*Destroys everything retired with a value <= completed. Returns the number of destroyed objects*/
+    size_t collect(uint64_t completed);
+    /*Destroys everything; the device must be idle*/
+    void flush();
+    size_t size() const;
+};
+
+
+#endif //HELLO_VULKAN_VKDELETIONQUEUE_H
@@ -0,0 +1,220 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include "VkDescriptorAllocator.h"
+#include "Log.h"
+
+static const char* TAG = "VkDescriptorAllocator";
+
+VkDescriptorAllocator::VkDescriptorAllocator(VkDevice _device, std::vector<VkDescriptorPoolSize> _pool_sizes, uint32_t _sets_per_pool):
+        device(_device), pool_sizes(std::move(_pool_sizes)), sets_per_pool(_sets_per_pool) {
+    if (sets_per_pool == 0) {
+        throw std::invalid_argument("Descriptor pools need at least one set!");
+    }
+}
+
+VkDescriptorAllocator::~VkDescriptorAllocator() {
+    for (VkDescriptorPool pool: pools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+}
+
+VkDescriptorPool VkDescriptorAllocator::next_pool() {
+    VkDescriptorPool pool;
+    if (!free_pools.empty()) {
+        pool = free_pools.back();
+        free_pools.pop_back();
+    } else {
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        poolInfo.pPoolSizes = pool_sizes.data();
+        poolInfo.maxSets = sets_per_pool;
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create descriptor pool!");
+        }
+        pools.push_back(pool);
+        LOGD(TAG, "Created descriptor pool %zu with %u sets", pools.size(), sets_per_pool);
+    }
+    used_pools.push_back(pool);
+    return pool;
+}
+
+VkDescriptorSet VkDescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    if (current == VK_NULL_HANDLE) {
+        current = next_pool();
+    }
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = current;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        /*A fresh pool always has room for one set of the sizes it was made for*/
+        ++pool_switches;
+        current = next_pool();
+        allocInfo.descriptorPool = current;
+        result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor set!");
+    }
+    ++allocations;
+    return set;
+}
+
+void VkDescriptorAllocator::reset() {
+    for (VkDescriptorPool pool: used_pools) {
+        vkResetDescriptorPool(device, pool, 0);
+        free_pools.push_back(pool);
+    }
+    used_pools.clear();
+    current = VK_NULL_HANDLE;
+    ++resets;
+}
+
+void VkDescriptorAllocator::retire(uint64_t value) {
+    if (!retired_pools.empty() && retired_pools.back().value > value) {
+        throw std::runtime_error("Descriptor pool retire values must not decrease!");
+    }
+    for (VkDescriptorPool pool: used_pools) {
+        retired_pools.push_back({value, pool});
+    }
+    used_pools.clear();
+    current = VK_NULL_HANDLE;
+}
+
+void VkDescriptorAllocator::collect(uint64_t completed) {
+    bool recycled = false;
+    while (!retired_pools.empty() && retired_pools.front().value <= completed) {
+        vkResetDescriptorPool(device, retired_pools.front().pool, 0);
+        free_pools.push_back(retired_pools.front().pool);
+        retired_pools.pop_front();
+        recycled = true;
+    }
+    if (recycled) ++resets;
+}
+
+descriptor_allocator_stats_t VkDescriptorAllocator::get_stats() const {
+    return {
+        static_cast<uint32_t>(pools.size()),
+        static_cast<uint32_t>(used_pools.size()),
+        static_cast<uint32_t>(free_pools.size()),
+        allocations,
+        pool_switches,
+        resets
+    };
+}
+
+descriptor_write_t buffer_descriptor(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    descriptor_write_t write{};
+    write.resource = handle_bits(buffer);
+    write.offset = offset;
+    write.range = range;
+    write.binding = binding;
+    write.type = type;
+    return write;
+}
+
+descriptor_write_t image_descriptor(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout) {
+    descriptor_write_t write{};
+    write.resource = handle_bits(view);
+    write.sampler = handle_bits(sampler);
+    write.binding = binding;
+    write.type = type;
+    write.image_layout = layout;
+    return write;
+}
+
+bool is_buffer_descriptor(uint32_t type) {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+           || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+void write_descriptors(VkDevice device, VkDescriptorSet set, const descriptor_write_t *writes, uint32_t count) {
+    constexpr uint32_t MAX_WRITES = 16;
+    if (count > MAX_WRITES) {
+        throw std::runtime_error("Too many descriptors in one set!");
+    }
+    VkDescriptorBufferInfo bufferInfos[MAX_WRITES];
+    VkDescriptorImageInfo imageInfos[MAX_WRITES];
+    VkWriteDescriptorSet descriptorWrites[MAX_WRITES];
+    for (uint32_t i = 0; i < count; ++i) {
+        const descriptor_write_t& write = writes[i];
+        descriptorWrites[i] = {};
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = set;
+        descriptorWrites[i].dstBinding = write.binding;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = static_cast<VkDescriptorType>(write.type);
+        descriptorWrites[i].descriptorCount = 1;
+        if (is_buffer_descriptor(write.type)) {
+            bufferInfos[i] = {handle_from_bits<VkBuffer>(write.resource), write.offset, write.range};
+            descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+        } else {
+            imageInfos[i] = {handle_from_bits<VkSampler>(write.sampler), handle_from_bits<VkImageView>(write.resource),
+                             static_cast<VkImageLayout>(write.image_layout)};
+            descriptorWrites[i].pImageInfo = &imageInfos[i];
+        }
+    }
+    vkUpdateDescriptorSets(device, count, descriptorWrites, 0, nullptr);
+}
+
+VkDescriptorSetCache::VkDescriptorSetCache(VkDevice _device, std::vector<VkDescriptorPoolSize> pool_sizes, uint32_t sets_per_pool):
+        device(_device), allocator(_device, std::move(pool_sizes), sets_per_pool) {
+
+}
+
+uint64_t VkDescriptorSetCache::hash(VkDescriptorSetLayout layout, const descriptor_write_t *writes, uint32_t count) {
+    /*Same word mix as hash_pipeline_state()*/
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ handle_bits(layout);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t words[sizeof(descriptor_write_t) / sizeof(uint64_t)];
+        memcpy(words, &writes[i], sizeof(words));
+        for (uint64_t word: words) {
+            hash ^= word * 0xC2B2AE3D27D4EB4Full;
+            hash = (hash << 31 | hash >> 33) * 0x9E3779B185EBCA87ull;
+        }
+    }
+    return hash ^ hash >> 29;
+}
+
+VkDescriptorSet VkDescriptorSetCache::get(VkDescriptorSetLayout layout, const descriptor_write_t *writes, uint32_t count) {
+    uint64_t key = hash(layout, writes, count);
+    auto [begin, end] = entries.equal_range(key);
+    for (auto it = begin; it != end; ++it) {
+        const entry_t& entry = it->second;
+        if (entry.layout == layout && entry.writes.size() == count
+            && memcmp(entry.writes.data(), writes, count * sizeof(descriptor_write_t)) == 0) {
+            ++hits;
+            return entry.set;
+        }
+    }
+    ++misses;
+    VkDescriptorSet set = allocator.allocate(layout);
+    write_descriptors(device, set, writes, count);
+    entries.emplace(key, entry_t{layout, std::vector<descriptor_write_t>(writes, writes + count), set});
+    return set;
+}
+
+void VkDescriptorSetCache::invalidate(uint64_t value) {
+    entries.clear();
+    allocator.retire(value);
+}
+
+void VkDescriptorSetCache::collect(uint64_t completed) {
+    allocator.collect(completed);
+}
+
+descriptor_cache_stats_t VkDescriptorSetCache::get_stats() const {
+    return {static_cast<uint32_t>(entries.size()), hits, misses};
+}
+
+descriptor_allocator_stats_t VkDescriptorSetCache::get_allocator_stats() const {
+    return allocator.get_stats();
+}
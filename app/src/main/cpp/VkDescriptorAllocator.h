@@ -0,0 +1,131 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKDESCRIPTORALLOCATOR_H
+#define HELLO_VULKAN_VKDESCRIPTORALLOCATOR_H
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkUnique.h"
+
+struct descriptor_allocator_stats_t {
+    /*Pools created, in use and waiting for reuse*/
+    uint32_t pools;
+    uint32_t used_pools;
+    uint32_t free_pools;
+    uint64_t allocations;
+    /*Times a full pool was chained to a new one*/
+    uint64_t pool_switches;
+    uint64_t resets;
+};
+
+/*
+ * Hands out descriptor sets from a chain of pools. When the current pool reports
+ * VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL the allocation moves on to
+ * a recycled or new pool, so the number of sets is not fixed up front. Sets are never
+ * freed one by one: reset() recycles every pool at once for transient per-frame sets,
+ * retire()/collect() do the same once the GPU finished with a generation of sets.
+ */
+class VkDescriptorAllocator {
+private:
+    struct retired_pool_t {
+        uint64_t value;
+        VkDescriptorPool pool;
+    };
+    VkDevice device;
+    std::vector<VkDescriptorPoolSize> pool_sizes;
+    uint32_t sets_per_pool;
+    VkDescriptorPool current = VK_NULL_HANDLE;
+    /*Every pool ever created, destroyed with the allocator*/
+    std::vector<VkDescriptorPool> pools;
+    std::vector<VkDescriptorPool> used_pools;
+    std::vector<VkDescriptorPool> free_pools;
+    std::deque<retired_pool_t> retired_pools;
+    uint64_t allocations = 0;
+    uint64_t pool_switches = 0;
+    uint64_t resets = 0;
+    VkDescriptorPool next_pool();
+public:
+    /*pool_sizes holds the descriptors of sets_per_pool sets, see ShaderInterface::get_pool_sizes()*/
+    VkDescriptorAllocator(VkDevice device, std::vector<VkDescriptorPoolSize> pool_sizes, uint32_t sets_per_pool);
+    VkDescriptorAllocator(const VkDescriptorAllocator&) = delete;
+    VkDescriptorAllocator& operator=(const VkDescriptorAllocator&) = delete;
+    ~VkDescriptorAllocator();
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    /*Recycles every pool right away; no set may still be used by the GPU*/
+    void reset();
+    /*Recycles every pool once the submission with value has completed; values must not decrease*/
+    void retire(uint64_t value);
+    void collect(uint64_t completed);
+    descriptor_allocator_stats_t get_stats() const;
+};
+
+/*
+ * One descriptor of a set, in a hashable form without padding. Buffers fill offset
+ * and range, images fill sampler and image_layout; unused fields stay zero.
+ */
+struct descriptor_write_t {
+    /*VkBuffer or VkImageView, see handle_bits()*/
+    uint64_t resource;
+    /*VkSampler of a combined image sampler*/
+    uint64_t sampler;
+    uint64_t offset;
+    uint64_t range;
+    uint32_t binding;
+    /*VkDescriptorType*/
+    uint32_t type;
+    /*VkImageLayout*/
+    uint32_t image_layout;
+    uint32_t reserved;
+};
+
+static_assert(std::has_unique_object_representations_v<descriptor_write_t>, "descriptor_write_t must not contain padding!");
+
+descriptor_write_t buffer_descriptor(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+descriptor_write_t image_descriptor(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout);
+/*True when the VkDescriptorType reads VkDescriptorBufferInfo*/
+bool is_buffer_descriptor(uint32_t type);
+/*Writes count descriptors into set with one vkUpdateDescriptorSets call*/
+void write_descriptors(VkDevice device, VkDescriptorSet set, const descriptor_write_t* writes, uint32_t count);
+
+struct descriptor_cache_stats_t {
+    uint32_t sets;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+/*
+ * Sets that never change after being written, looked up by a hash of their layout and
+ * contents so equal materials share one set and a hit costs no allocation or write.
+ * The cache does not know when a resource dies: once any cached resource is destroyed
+ * the whole cache has to be invalidated, which retires its pools with the submission
+ * value that may still read the sets.
+ */
+class VkDescriptorSetCache {
+private:
+    struct entry_t {
+        VkDescriptorSetLayout layout;
+        std::vector<descriptor_write_t> writes;
+        VkDescriptorSet set;
+    };
+    VkDevice device;
+    VkDescriptorAllocator allocator;
+    std::unordered_multimap<uint64_t, entry_t> entries;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    static uint64_t hash(VkDescriptorSetLayout layout, const descriptor_write_t* writes, uint32_t count);
+public:
+    VkDescriptorSetCache(VkDevice device, std::vector<VkDescriptorPoolSize> pool_sizes, uint32_t sets_per_pool);
+    VkDescriptorSet get(VkDescriptorSetLayout layout, const descriptor_write_t* writes, uint32_t count);
+    void invalidate(uint64_t value);
+    void collect(uint64_t completed);
+    descriptor_cache_stats_t get_stats() const;
+    descriptor_allocator_stats_t get_allocator_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKDESCRIPTORALLOCATOR_H
@@ -0,0 +1,108 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <stdexcept>
+#include <string>
+#include "VkDescriptorTemplate.h"
+
+/*The core name, or the VK_KHR_descriptor_update_template one before 1.1*/
+static PFN_vkVoidFunction get_template_function(VkDevice device, const char* name, const char* extension_name) {
+    PFN_vkVoidFunction function = vkGetDeviceProcAddr(device, name);
+    if (function == nullptr) {
+        function = vkGetDeviceProcAddr(device, extension_name);
+    }
+    if (function == nullptr) {
+        throw std::runtime_error(std::string(name) + " is not available!");
+    }
+    return function;
+}
+
+VkDescriptorTemplate::VkDescriptorTemplate(VkDevice _device, const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                                           VkDescriptorSetLayout layout): device(_device) {
+    create(bindings, layout, VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET);
+}
+
+VkDescriptorTemplate::VkDescriptorTemplate(VkDevice _device, const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                                           VkDescriptorSetLayout layout, VkPipelineLayout _pipeline_layout, uint32_t _set):
+        device(_device), pipeline_layout(_pipeline_layout), set(_set) {
+    push_with_template = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetWithTemplateKHR"));
+    if (push_with_template == nullptr) {
+        throw std::runtime_error("vkCmdPushDescriptorSetWithTemplateKHR is not available!");
+    }
+    create(bindings, layout, VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR);
+}
+
+void VkDescriptorTemplate::create(const std::vector<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayout layout,
+                                  VkDescriptorUpdateTemplateType type) {
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    for (const VkDescriptorSetLayoutBinding& binding: bindings) {
+        /*Runtime arrays are written by index, not through a template*/
+        if (binding.descriptorCount == 0) continue;
+        if (binding.binding >= binding_offsets.size()) {
+            binding_offsets.resize(binding.binding + 1, UINT32_MAX);
+        }
+        binding_offsets[binding.binding] = descriptor_count;
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.descriptorType;
+        entry.offset = descriptor_count * sizeof(descriptor_data_t);
+        entry.stride = sizeof(descriptor_data_t);
+        entries.push_back(entry);
+        descriptor_count += binding.descriptorCount;
+    }
+    if (descriptor_count > MAX_TEMPLATE_DESCRIPTORS) {
+        throw std::runtime_error("Too many descriptors for an update template!");
+    }
+
+    auto create_template = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplate>(
+            get_template_function(device, "vkCreateDescriptorUpdateTemplate", "vkCreateDescriptorUpdateTemplateKHR"));
+    auto destroy_template = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplate>(
+            get_template_function(device, "vkDestroyDescriptorUpdateTemplate", "vkDestroyDescriptorUpdateTemplateKHR"));
+    update_with_template = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplate>(
+            get_template_function(device, "vkUpdateDescriptorSetWithTemplate", "vkUpdateDescriptorSetWithTemplateKHR"));
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = type;
+    templateInfo.descriptorSetLayout = layout;
+    templateInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    templateInfo.pipelineLayout = pipeline_layout;
+    templateInfo.set = set;
+    if (create_template(device, &templateInfo, nullptr, update_template.put(device, destroy_template)) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor update template!");
+    }
+}
+
+uint32_t VkDescriptorTemplate::size() const {
+    return descriptor_count;
+}
+
+void VkDescriptorTemplate::pack(const descriptor_write_t *writes, uint32_t count, descriptor_data_t *data) const {
+    for (uint32_t i = 0; i < count; ++i) {
+        const descriptor_write_t& write = writes[i];
+        if (write.binding >= binding_offsets.size() || binding_offsets[write.binding] == UINT32_MAX) {
+            throw std::out_of_range("Descriptor binding is not part of the template!");
+        }
+        descriptor_data_t& element = data[binding_offsets[write.binding]];
+        if (is_buffer_descriptor(write.type)) {
+            element.buffer = {handle_from_bits<VkBuffer>(write.resource), write.offset, write.range};
+        } else {
+            element.image = {handle_from_bits<VkSampler>(write.sampler), handle_from_bits<VkImageView>(write.resource),
+                             static_cast<VkImageLayout>(write.image_layout)};
+        }
+    }
+}
+
+void VkDescriptorTemplate::update(VkDescriptorSet dst_set, const descriptor_data_t *data) const {
+    update_with_template(device, dst_set, update_template, data);
+}
+
+void VkDescriptorTemplate::push(VkCommandBuffer command_buffer, const descriptor_data_t *data) const {
+    push_with_template(command_buffer, update_template, pipeline_layout, set, data);
+}
@@ -0,0 +1,59 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKDESCRIPTORTEMPLATE_H
+#define HELLO_VULKAN_VKDESCRIPTORTEMPLATE_H
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkUnique.h"
+#include "VkDescriptorAllocator.h"
+
+/*One descriptor of template data, large enough for every descriptor kind*/
+union descriptor_data_t {
+    VkDescriptorImageInfo image;
+    VkDescriptorBufferInfo buffer;
+    VkBufferView texel_buffer;
+};
+
+/*
+ * Descriptor update template generated from the bindings of one set layout. Data is
+ * a flat array of descriptor_data_t, one element per descriptor in binding order, so
+ * the driver walks a fixed layout instead of decoding VkWriteDescriptorSet structs.
+ * A push template writes the set straight into a command buffer with
+ * VK_KHR_push_descriptor; its set layout must have been created with
+ * VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR.
+ */
+class VkDescriptorTemplate {
+private:
+    VkDevice device;
+    VkUniqueDescriptorUpdateTemplate update_template;
+    VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+    uint32_t set = 0;
+    /*Core in 1.1, VK_KHR_descriptor_update_template otherwise; none is exported at every API level*/
+    PFN_vkUpdateDescriptorSetWithTemplate update_with_template = nullptr;
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR push_with_template = nullptr;
+    /*First data element of each binding number, UINT32_MAX when the set has no such binding*/
+    std::vector<uint32_t> binding_offsets;
+    uint32_t descriptor_count = 0;
+    void create(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayout layout, VkDescriptorUpdateTemplateType type);
+public:
+    static constexpr uint32_t MAX_TEMPLATE_DESCRIPTORS = 16;
+    /*Updates sets allocated with layout*/
+    VkDescriptorTemplate(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayout layout);
+    /*Pushes set number set of pipeline_layout*/
+    VkDescriptorTemplate(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayout layout,
+                         VkPipelineLayout pipeline_layout, uint32_t set);
+    VkDescriptorTemplate(const VkDescriptorTemplate&) = delete;
+    VkDescriptorTemplate& operator=(const VkDescriptorTemplate&) = delete;
+    /*Number of descriptor_data_t elements the template reads*/
+    uint32_t size() const;
+    /*Scatters writes into data, which holds size() elements*/
+    void pack(const descriptor_write_t* writes, uint32_t count, descriptor_data_t* data) const;
+    void update(VkDescriptorSet set, const descriptor_data_t* data) const;
+    void push(VkCommandBuffer command_buffer, const descriptor_data_t* data) const;
+};
+
+
+#endif //HELLO_VULKAN_VKDESCRIPTORTEMPLATE_H
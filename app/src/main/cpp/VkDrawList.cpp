@@ -0,0 +1,166 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "VkDrawList.h"
+
+const char *draw_submission_name(draw_submission_t submission) {
+    switch (submission) {
+        case draw_submission_t::INDIRECT: return "indirect draws";
+        case draw_submission_t::INDIRECT_COUNT: return "indirect count draws";
+        default: return "direct draws";
+    }
+}
+
+VkDrawList::VkDrawList(VkDevice device, VkResourceRegistry &resources, uint32_t frame_count, draw_submission_t submission,
+                       uint32_t max_draw_count, uint32_t capacity): resources(resources), submission(submission),
+                                                                     max_batch_draws(std::max(max_draw_count, 1u)) {
+    if (submission == draw_submission_t::DIRECT) {
+        max_batch_draws = UINT32_MAX;
+    }
+    if (submission == draw_submission_t::INDIRECT_COUNT) {
+        /*Core in 1.2, the extension's entry point otherwise*/
+        draw_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCount"));
+        if (!draw_indirect_count) {
+            draw_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+                    vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        }
+        if (!draw_indirect_count) {
+            throw std::runtime_error("vkCmdDrawIndexedIndirectCount is not available!");
+        }
+    }
+    frames.resize(frame_count);
+    for (frame_t& slot: frames) {
+        create_buffers(slot, std::max(capacity, 1u));
+    }
+}
+
+VkDrawList::~VkDrawList() {
+    for (frame_t& slot: frames) {
+        resources.destroy(slot.commands);
+        resources.destroy(slot.draws);
+        resources.destroy(slot.counts);
+    }
+}
+
+void VkDrawList::create_buffers(frame_t &slot, uint32_t capacity) {
+    /*Host visible and coherent like the UBOs; storage so a compute pass can fill them instead*/
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkBufferUsageFlags indirect = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    slot.commands = resources.create_buffer({capacity * sizeof(VkDrawIndexedIndirectCommand), indirect, properties});
+    slot.draws = resources.create_buffer({capacity * sizeof(draw_data_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, properties});
+    /*Every batch holds at least one draw, so there are never more batches than draws*/
+    slot.counts = resources.create_buffer({capacity * sizeof(uint32_t), indirect, properties});
+    slot.capacity = capacity;
+}
+
+void VkDrawList::begin(uint32_t frame_index, uint32_t count) {
+    frame = frame_index;
+    frame_t& slot = frames.at(frame);
+    if (count > slot.capacity) {
+        /*The slot's last submission has completed, its buffers can go right away*/
+        resources.destroy(slot.commands);
+        resources.destroy(slot.draws);
+        resources.destroy(slot.counts);
+        create_buffers(slot, std::max(count, slot.capacity * 2));
+    }
+    commands = static_cast<VkDrawIndexedIndirectCommand*>(resources.get_mapped(slot.commands));
+    draws = static_cast<draw_data_t*>(resources.get_mapped(slot.draws));
+    reserved = count;
+    draw_count = 0;
+    batches.clear();
+    direct_commands.clear();
+}
+
+void VkDrawList::add(VkPipeline pipeline, const raster_state_t &raster, VkIndexType index_type, uint32_t index_count,
+                     uint32_t first_index, int32_t vertex_offset, const draw_data_t &data) {
+    if (draw_count >= reserved) {
+        throw std::out_of_range("More draws than reserved!");
+    }
+    /*The draw's index doubles as its instance, see DrawData in the shaders*/
+    VkDrawIndexedIndirectCommand command{index_count, 1, first_index, vertex_offset, draw_count};
+    commands[draw_count] = command;
+    if (submission == draw_submission_t::DIRECT) {
+        /*Mapped memory may be write-combined, never read it back*/
+        direct_commands.push_back(command);
+    }
+    draw_batch_t* batch = batches.empty() ? nullptr : &batches.back();
+    if (batch && batch->pipeline == pipeline && batch->raster == raster && batch->index_type == index_type
+        && batch->draw_count < max_batch_draws) {
+        ++batch->draw_count;
+    } else {
+        batches.push_back({pipeline, raster, index_type, draw_count, 1});
+        batch = &batches.back();
+    }
+    draw_data_t& written = draws[draw_count];
+    written = data;
+    written.batch = static_cast<uint32_t>(batches.size() - 1);
+    written.batch_first = batch->first_draw;
+    ++draw_count;
+}
+
+void VkDrawList::end() {
+    auto* counts = static_cast<uint32_t*>(resources.get_mapped(frames[frame].counts));
+    for (size_t i = 0; i < batches.size(); ++i) {
+        counts[i] = batches[i].draw_count;
+    }
+}
+
+void VkDrawList::record(VkCommandBuffer command_buffer, const std::function<void(const draw_batch_t &)> &bind,
+                        VkBuffer commands_override, VkBuffer counts_override) {
+    const frame_t& slot = frames[frame];
+    VkBuffer indirect_buffer = commands_override != VK_NULL_HANDLE ? commands_override : resources.get_buffer(slot.commands);
+    VkBuffer count_buffer = counts_override != VK_NULL_HANDLE ? counts_override : resources.get_buffer(slot.counts);
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    calls = 0;
+    for (size_t i = 0; i < batches.size(); ++i) {
+        const draw_batch_t& batch = batches[i];
+        bind(batch);
+        VkDeviceSize offset = static_cast<VkDeviceSize>(batch.first_draw) * stride;
+        switch (submission) {
+            case draw_submission_t::INDIRECT_COUNT:
+                draw_indirect_count(command_buffer, indirect_buffer, offset, count_buffer, i * sizeof(uint32_t), batch.draw_count, stride);
+                ++calls;
+                break;
+            case draw_submission_t::INDIRECT:
+                /*Batches are capped at maxDrawIndirectCount, 1 without multiDrawIndirect*/
+                vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, offset, batch.draw_count, stride);
+                ++calls;
+                break;
+            default:
+                for (uint32_t d = batch.first_draw; d < batch.first_draw + batch.draw_count; ++d) {
+                    const VkDrawIndexedIndirectCommand& command = direct_commands[d];
+                    vkCmdDrawIndexed(command_buffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset,
+                                     command.firstInstance);
+                }
+                calls += batch.draw_count;
+                break;
+        }
+    }
+}
+
+draw_submission_t VkDrawList::get_submission() const {
+    return submission;
+}
+
+uint32_t VkDrawList::get_draw_count() const {
+    return draw_count;
+}
+
+VkBuffer VkDrawList::get_command_buffer() const {
+    return resources.get_buffer(frames[frame].commands);
+}
+
+VkBuffer VkDrawList::get_draw_buffer() const {
+    return resources.get_buffer(frames[frame].draws);
+}
+
+VkDeviceSize VkDrawList::get_draw_buffer_size() const {
+    return static_cast<VkDeviceSize>(frames[frame].capacity) * sizeof(draw_data_t);
+}
+
+draw_list_stats_t VkDrawList::get_stats() const {
+    return {draw_count, static_cast<uint32_t>(batches.size()), calls, frames[frame].capacity};
+}
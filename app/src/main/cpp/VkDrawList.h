@@ -0,0 +1,127 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKDRAWLIST_H
+#define HELLO_VULKAN_VKDRAWLIST_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "glm/glm.hpp"
+#include "RenderCommandQueue.h"
+#include "VkResourceRegistry.h"
+
+/*How the recorded draw list reaches the GPU*/
+enum class draw_submission_t {
+    /*One vkCmdDrawIndexed per draw, when indirect draws can not start at a non-zero instance*/
+    DIRECT,
+    /*vkCmdDrawIndexedIndirect per batch, one draw per call without multiDrawIndirect*/
+    INDIRECT,
+    /*vkCmdDrawIndexedIndirectCount per batch, the count is read from a buffer*/
+    INDIRECT_COUNT
+};
+
+const char* draw_submission_name(draw_submission_t);
+
+/*Per-draw data read by the vertex shader as draws[gl_InstanceIndex], std430 layout of DrawData*/
+struct draw_data_t {
+    glm::mat4 model;
+    glm::vec4 tint;
+    /*Bounding sphere in model space: center, radius*/
+    glm::vec4 sphere;
+    uint32_t material;
+    /*Filled in by VkDrawList::add(): the batch's count slot and its first draw*/
+    uint32_t batch;
+    uint32_t batch_first;
+    uint32_t padding;
+};
+
+static_assert(sizeof(draw_data_t) == 112, "draw_data_t must match the std430 layout of DrawData!");
+
+/*A run of draws sharing pipeline, raster state and index type, recorded as one indirect call*/
+struct draw_batch_t {
+    VkPipeline pipeline;
+    raster_state_t raster;
+    VkIndexType index_type;
+    uint32_t first_draw;
+    uint32_t draw_count;
+};
+
+struct draw_list_stats_t {
+    uint32_t draws;
+    uint32_t batches;
+    /*vkCmdDraw* calls of the last record*/
+    uint32_t calls;
+    /*Draws each frame slot has room for*/
+    uint32_t capacity;
+};
+
+/*
+ * Per-frame draw list. Draws are written straight into persistently mapped buffers as
+ * VkDrawIndexedIndirectCommand records plus their draw_data_t, with firstInstance set to
+ * the draw's own index so the shader finds its data without push constants. Consecutive
+ * draws with the same state form a batch, and recording costs one call per batch however
+ * many objects it holds. The count buffer holds the draw count of each batch; it is
+ * written by the CPU here and is where a GPU culling pass can write its own.
+ */
+class VkDrawList {
+private:
+    struct frame_t {
+        buffer_handle_t commands;
+        buffer_handle_t draws;
+        buffer_handle_t counts;
+        uint32_t capacity;
+    };
+    VkResourceRegistry& resources;
+    draw_submission_t submission;
+    uint32_t max_batch_draws;
+    PFN_vkCmdDrawIndexedIndirectCount draw_indirect_count = nullptr;
+    std::vector<frame_t> frames;
+    uint32_t frame = 0;
+    VkDrawIndexedIndirectCommand* commands = nullptr;
+    draw_data_t* draws = nullptr;
+    uint32_t draw_count = 0;
+    uint32_t reserved = 0;
+    std::vector<draw_batch_t> batches;
+    /*CPU copy of the commands for DIRECT*/
+    std::vector<VkDrawIndexedIndirectCommand> direct_commands;
+    uint32_t calls = 0;
+    void create_buffers(frame_t& slot, uint32_t capacity);
+public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 1024;
+    /*max_draw_count is maxDrawIndirectCount, 1 without multiDrawIndirect*/
+    VkDrawList(VkDevice device, VkResourceRegistry& resources, uint32_t frame_count, draw_submission_t submission,
+               uint32_t max_draw_count, uint32_t capacity = DEFAULT_CAPACITY);
+    VkDrawList(const VkDrawList&) = delete;
+    VkDrawList& operator=(const VkDrawList&) = delete;
+    ~VkDrawList();
+    /*
+     * Starts filling frame slot frame, whose last submission must have completed. Room
+     * for draw_count draws is reserved up front: the buffers grow before anything is
+     * written, so add() never reallocates.
+     */
+    void begin(uint32_t frame, uint32_t draw_count);
+    void add(VkPipeline pipeline, const raster_state_t& raster, VkIndexType index_type, uint32_t index_count, uint32_t first_index,
+             int32_t vertex_offset, const draw_data_t& data);
+    /*Writes the batch counts*/
+    void end();
+    /*
+     * bind is called once per batch to set its pipeline, raster state and index buffer.
+     * The commands and counts are read from the given buffers instead when a GPU pass
+     * rewrote them, laid out the same way.
+     */
+    void record(VkCommandBuffer command_buffer, const std::function<void(const draw_batch_t&)>& bind,
+                VkBuffer commands_override = VK_NULL_HANDLE, VkBuffer counts_override = VK_NULL_HANDLE);
+    draw_submission_t get_submission() const;
+    uint32_t get_draw_count() const;
+    /*Indirect commands of the current frame as written by add()*/
+    VkBuffer get_command_buffer() const;
+    /*Storage buffer with the draw_data_t of the current frame*/
+    VkBuffer get_draw_buffer() const;
+    VkDeviceSize get_draw_buffer_size() const;
+    draw_list_stats_t get_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKDRAWLIST_H
@@ -0,0 +1,134 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "VkGeometryArena.h"
+
+VkGeometryArena::VkGeometryArena(VkResourceRegistry &resources, uint32_t vertex_stride, uint32_t vertex_capacity,
+                                 VkDeviceSize index_capacity): resources(resources), vertex_stride(vertex_stride),
+                                                               vertex_ranges(vertex_capacity), index_ranges(index_capacity) {
+    vertex_buffer = create_buffer(static_cast<VkDeviceSize>(vertex_capacity) * vertex_stride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    index_buffer = create_buffer(index_capacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+buffer_handle_t VkGeometryArena::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage) {
+    /*Source of the copy when the arena grows*/
+    return resources.create_buffer({size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
+}
+
+void VkGeometryArena::grow(VkCommandBuffer command_buffer, buffer_handle_t &buffer, RangeAllocator &allocator, uint64_t needed,
+                           VkDeviceSize unit_size, VkBufferUsageFlags usage, uint64_t retire_value) {
+    uint64_t capacity = allocator.get_capacity();
+    /*Doubling keeps the number of copies logarithmic; the new space may merge with a free tail*/
+    uint64_t new_capacity = std::max(capacity * 2, capacity + needed);
+    buffer_handle_t larger = create_buffer(new_capacity * unit_size, usage);
+    VkBufferCopy region{0, 0, capacity * unit_size};
+    vkCmdCopyBuffer(command_buffer, resources.get_buffer(buffer), resources.get_buffer(larger), 1, &region);
+    /*Uploads recorded next may land in ranges the copy also writes, a second grow reads them*/
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+    /*Frames in flight still draw from the old buffer*/
+    resources.retire(buffer, retire_value);
+    buffer = larger;
+    allocator.grow(new_capacity);
+    ++grows;
+}
+
+VkIndexType VkGeometryArena::select_index_type(uint32_t vertex_count) {
+    return vertex_count <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t VkGeometryArena::index_size(VkIndexType index_type) {
+    return index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void VkGeometryArena::write_indices(const uint32_t *indices, uint32_t index_count, VkIndexType index_type, void *out) {
+    if (index_type == VK_INDEX_TYPE_UINT32) {
+        std::copy(indices, indices + index_count, static_cast<uint32_t*>(out));
+    } else {
+        std::transform(indices, indices + index_count, static_cast<uint16_t*>(out), [](uint32_t index) {
+            return static_cast<uint16_t>(index);
+        });
+    }
+}
+
+geometry_range_t VkGeometryArena::allocate(VkCommandBuffer command_buffer, uint32_t vertex_count, uint32_t index_count,
+                                           uint64_t retire_value) {
+    if (vertex_count == 0 || index_count == 0) {
+        throw std::invalid_argument("Empty geometry range!");
+    }
+    geometry_range_t range{};
+    range.vertex_count = vertex_count;
+    range.index_count = index_count;
+    range.index_type = select_index_type(vertex_count);
+    uint32_t size = index_size(range.index_type);
+
+    uint64_t vertex_offset = vertex_ranges.allocate(vertex_count);
+    if (vertex_offset == RangeAllocator::INVALID_OFFSET) {
+        grow(command_buffer, vertex_buffer, vertex_ranges, vertex_count, vertex_stride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+             retire_value);
+        vertex_offset = vertex_ranges.allocate(vertex_count);
+    }
+    uint64_t index_offset = index_ranges.allocate(static_cast<uint64_t>(index_count) * size, size);
+    if (index_offset == RangeAllocator::INVALID_OFFSET) {
+        /*Enough for the worst alignment of the new space*/
+        grow(command_buffer, index_buffer, index_ranges, static_cast<uint64_t>(index_count) * size + size, 1,
+             VK_BUFFER_USAGE_INDEX_BUFFER_BIT, retire_value);
+        index_offset = index_ranges.allocate(static_cast<uint64_t>(index_count) * size, size);
+    }
+    /*vertexOffset is an int32_t and firstIndex a uint32_t*/
+    if (vertex_offset > INT32_MAX || index_offset / size > UINT32_MAX) {
+        throw std::runtime_error("Geometry arena is out of addressable space!");
+    }
+    range.vertex_offset = static_cast<int32_t>(vertex_offset);
+    range.first_index = static_cast<uint32_t>(index_offset / size);
+    ++live_ranges;
+    return range;
+}
+
+void VkGeometryArena::free(const geometry_range_t &range, uint64_t value) {
+    if (!pending.empty() && pending.back().value > value) {
+        throw std::runtime_error("Geometry retire values must not decrease!");
+    }
+    pending.push_back({value, range});
+}
+
+void VkGeometryArena::collect(uint64_t completed) {
+    while (!pending.empty() && pending.front().value <= completed) {
+        const geometry_range_t& range = pending.front().range;
+        uint32_t size = index_size(range.index_type);
+        vertex_ranges.free(static_cast<uint64_t>(range.vertex_offset), range.vertex_count);
+        index_ranges.free(static_cast<uint64_t>(range.first_index) * size, static_cast<uint64_t>(range.index_count) * size);
+        --live_ranges;
+        pending.pop_front();
+    }
+}
+
+VkDeviceSize VkGeometryArena::get_vertex_offset(const geometry_range_t &range) const {
+    return static_cast<VkDeviceSize>(range.vertex_offset) * vertex_stride;
+}
+
+VkDeviceSize VkGeometryArena::get_index_offset(const geometry_range_t &range) const {
+    return static_cast<VkDeviceSize>(range.first_index) * index_size(range.index_type);
+}
+
+VkBuffer VkGeometryArena::get_vertex_buffer() const {
+    return resources.get_buffer(vertex_buffer);
+}
+
+VkBuffer VkGeometryArena::get_index_buffer() const {
+    return resources.get_buffer(index_buffer);
+}
+
+geometry_arena_stats_t VkGeometryArena::get_stats() const {
+    return {vertex_ranges.get_capacity() * vertex_stride, vertex_ranges.get_used() * vertex_stride,
+            index_ranges.get_capacity(), index_ranges.get_used(), live_ranges - static_cast<uint32_t>(pending.size()),
+            static_cast<uint32_t>(pending.size()), grows};
+}
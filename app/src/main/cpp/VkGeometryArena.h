@@ -0,0 +1,91 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKGEOMETRYARENA_H
+#define HELLO_VULKAN_VKGEOMETRYARENA_H
+#include <cstdint>
+#include <deque>
+#include <vulkan/vulkan.h>
+#include "RangeAllocator.h"
+#include "VkResourceRegistry.h"
+
+/*Where one mesh lives: draw with vkCmdDrawIndexed(index_count, n, first_index, vertex_offset, 0)*/
+struct geometry_range_t {
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+    /*In units of index_type, the index buffer is always bound at offset 0*/
+    uint32_t first_index;
+    uint32_t index_count;
+    VkIndexType index_type;
+};
+
+struct geometry_arena_stats_t {
+    VkDeviceSize vertex_capacity;
+    VkDeviceSize vertex_used;
+    VkDeviceSize index_capacity;
+    VkDeviceSize index_used;
+    uint32_t ranges;
+    uint32_t pending_free;
+    uint32_t grows;
+};
+
+/*
+ * One vertex buffer and one index buffer shared by every mesh, so draws never rebind
+ * them. Meshes whose vertices fit 16-bit indices get them; both index sizes live in the
+ * same buffer, aligned to their size, so switching is only a vkCmdBindIndexBuffer with
+ * the other type. Full buffers are replaced by larger ones and the old contents copied
+ * on the GPU. Freed ranges are only reused once the frames that could still read them
+ * have completed, as in VkBindlessTable.
+ */
+class VkGeometryArena {
+private:
+    struct pending_range_t {
+        uint64_t value;
+        geometry_range_t range;
+    };
+    VkResourceRegistry& resources;
+    uint32_t vertex_stride;
+    buffer_handle_t vertex_buffer;
+    buffer_handle_t index_buffer;
+    /*In vertices*/
+    RangeAllocator vertex_ranges;
+    /*In bytes*/
+    RangeAllocator index_ranges;
+    std::deque<pending_range_t> pending;
+    uint32_t live_ranges = 0;
+    uint32_t grows = 0;
+    buffer_handle_t create_buffer(VkDeviceSize size, VkBufferUsageFlags usage);
+    void grow(VkCommandBuffer command_buffer, buffer_handle_t& buffer, RangeAllocator& allocator, uint64_t needed,
+              VkDeviceSize unit_size, VkBufferUsageFlags usage, uint64_t retire_value);
+public:
+    static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 256 * 1024;
+    static constexpr VkDeviceSize DEFAULT_INDEX_CAPACITY = 4 * 1024 * 1024;
+    VkGeometryArena(VkResourceRegistry& resources, uint32_t vertex_stride, uint32_t vertex_capacity = DEFAULT_VERTEX_CAPACITY,
+                    VkDeviceSize index_capacity = DEFAULT_INDEX_CAPACITY);
+    VkGeometryArena(const VkGeometryArena&) = delete;
+    VkGeometryArena& operator=(const VkGeometryArena&) = delete;
+    /*Indices are relative to vertex_offset, so 16 bits cover up to 65536 vertices*/
+    static VkIndexType select_index_type(uint32_t vertex_count);
+    static uint32_t index_size(VkIndexType index_type);
+    /*Narrows to 16 bits when index_type says so*/
+    static void write_indices(const uint32_t* indices, uint32_t index_count, VkIndexType index_type, void* out);
+    /*
+     * Grows the buffers when needed: the copy of the old contents is recorded into
+     * command_buffer, ahead of the uploads the caller records, and the old buffers are
+     * retired with retire_value.
+     */
+    geometry_range_t allocate(VkCommandBuffer command_buffer, uint32_t vertex_count, uint32_t index_count, uint64_t retire_value);
+    /*The range may be reused once the submission with value has completed; values must not decrease*/
+    void free(const geometry_range_t& range, uint64_t value);
+    /*Returns ranges freed with a value <= completed*/
+    void collect(uint64_t completed);
+    VkDeviceSize get_vertex_offset(const geometry_range_t& range) const;
+    VkDeviceSize get_index_offset(const geometry_range_t& range) const;
+    VkBuffer get_vertex_buffer() const;
+    VkBuffer get_index_buffer() const;
+    geometry_arena_stats_t get_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKGEOMETRYARENA_H
@@ -0,0 +1,360 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "VkGpuCulling.h"
+#include "VkPermutationCache.h"
+#include "SpirvReflection.h"
+
+namespace {
+    constexpr uint32_t CULL_GROUP_SIZE = 64;
+    constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+    /*Bit 0 feeds COMPACT in cull.comp*/
+    constexpr uint32_t CULL_COMPACT = 1 << 0;
+
+    /*Push constants of hiz.comp*/
+    struct reduce_constants_t {
+        int32_t source_size[2];
+        int32_t destination_size[2];
+    };
+
+    uint32_t previous_power_of_two(uint32_t value) {
+        uint32_t power = 1;
+        while (power * 2 <= value) power *= 2;
+        return power;
+    }
+
+    void create_layouts(VkDevice device, const ShaderInterface& shader_interface, VkUniqueDescriptorSetLayout& set_layout,
+                        VkUniquePipelineLayout& pipeline_layout) {
+        std::vector<VkDescriptorSetLayoutBinding> bindings = shader_interface.get_set_layout_bindings(0);
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, set_layout.put(device)) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create descriptor set layout!");
+        }
+        VkPushConstantRange pushConstantRange{};
+        bool hasPushConstants = shader_interface.get_push_constant_range(pushConstantRange);
+        VkDescriptorSetLayout setLayouts[] = {set_layout};
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = setLayouts;
+        pipelineLayoutInfo.pushConstantRangeCount = hasPushConstants ? 1 : 0;
+        pipelineLayoutInfo.pPushConstantRanges = hasPushConstants ? &pushConstantRange : nullptr;
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, pipeline_layout.put(device)) != VK_SUCCESS) {
+            throw std::runtime_error("Unable to create pipeline layout!");
+        }
+    }
+
+    VkImageMemoryBarrier image_barrier(VkImage image, VkImageAspectFlags aspect, VkAccessFlags src_access, VkAccessFlags dst_access,
+                                       VkImageLayout old_layout, VkImageLayout new_layout) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = aspect;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.layerCount = 1;
+        return barrier;
+    }
+
+    void memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+                        VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+VkGpuCulling::VkGpuCulling(VkDevice device, VkResourceRegistry &resources, VkShaderLibrary &shaders, VkPipelineCache cache,
+                           uint32_t frame_count, bool compact, bool occlusion): device(device), resources(resources), compact(compact),
+                                                                                 occlusion(occlusion) {
+    ShaderInterface cull_interface({&shaders.reflect("cull.comp")});
+    ShaderInterface reduce_interface({&shaders.reflect("hiz.comp")});
+    create_layouts(device, cull_interface, cull_layout, cull_pipeline_layout);
+    create_layouts(device, reduce_interface, reduce_layout, reduce_pipeline_layout);
+    cull_pipeline = create_pipeline(shaders, cache, "cull.comp", cull_pipeline_layout, compact ? CULL_COMPACT : 0);
+    reduce_pipeline = create_pipeline(shaders, cache, "hiz.comp", reduce_pipeline_layout, 0);
+    cull_descriptors = std::make_unique<VkDescriptorAllocator>(device, cull_interface.get_pool_sizes(0, frame_count), frame_count);
+    /*A 4096 pixel side needs 13 levels*/
+    constexpr uint32_t REDUCE_SETS_PER_POOL = 16;
+    reduce_descriptors = std::make_unique<VkDescriptorAllocator>(device, reduce_interface.get_pool_sizes(0, REDUCE_SETS_PER_POOL),
+                                                                 REDUCE_SETS_PER_POOL);
+
+    /*Point sampling, texels are picked by level and footprint*/
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, sampler.put(device)) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create texture sampler!");
+    }
+
+    frames.resize(frame_count);
+    for (frame_t& slot: frames) {
+        slot.uniforms = resources.create_buffer({sizeof(cull_uniforms_t), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT});
+        slot.stats = resources.create_buffer({2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+                                              | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
+        slot.set = cull_descriptors->allocate(cull_layout);
+        slot.draws = 0;
+        create_frame_buffers(slot, VkDrawList::DEFAULT_CAPACITY);
+    }
+    readback = resources.create_buffer({frame_count * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT});
+}
+
+VkGpuCulling::~VkGpuCulling() {
+    destroy_pyramid();
+    for (frame_t& slot: frames) {
+        destroy_frame_buffers(slot);
+        resources.destroy(slot.uniforms);
+        resources.destroy(slot.stats);
+    }
+    resources.destroy(readback);
+    resources.destroy(cull_pipeline);
+    resources.destroy(reduce_pipeline);
+}
+
+pipeline_handle_t VkGpuCulling::create_pipeline(VkShaderLibrary &shaders, VkPipelineCache cache, const char *name, VkPipelineLayout layout,
+                                                uint32_t permutation) {
+    permutation_constants_t specialization(permutation);
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaders.get_module(name);
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specialization.info;
+    pipelineInfo.layout = layout;
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline!");
+    }
+    return resources.add_pipeline(pipeline, layout);
+}
+
+void VkGpuCulling::create_frame_buffers(frame_t &slot, uint32_t capacity) {
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    slot.visible = resources.create_buffer({capacity * sizeof(VkDrawIndexedIndirectCommand), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
+    slot.counts = resources.create_buffer({capacity * sizeof(uint32_t), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
+    slot.capacity = capacity;
+}
+
+void VkGpuCulling::destroy_frame_buffers(frame_t &slot) {
+    resources.destroy(slot.visible);
+    resources.destroy(slot.counts);
+}
+
+void VkGpuCulling::destroy_pyramid() {
+    for (VkImageView view: level_views) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    level_views.clear();
+    reduce_sets.clear();
+    reduce_descriptors->reset();
+    if (pyramid.valid()) {
+        resources.destroy(pyramid);
+        pyramid = {};
+    }
+}
+
+void VkGpuCulling::resize(VkImageView depth_view, VkExtent2D extent) {
+    destroy_pyramid();
+    pyramid_initialized = false;
+    pyramid_valid = false;
+    depth_extent = extent;
+    if (occlusion) {
+        /*Powers of two so every level halves exactly*/
+        pyramid_extent = {previous_power_of_two(std::max(extent.width, 1u)), previous_power_of_two(std::max(extent.height, 1u))};
+        pyramid_levels = 1;
+        while ((std::max(pyramid_extent.width, pyramid_extent.height) >> pyramid_levels) > 0) ++pyramid_levels;
+    } else {
+        /*Never sampled, cull.comp's binding only needs a valid image*/
+        pyramid_extent = {1, 1};
+        pyramid_levels = 1;
+    }
+
+    image_desc_t desc{};
+    desc.width = pyramid_extent.width;
+    desc.height = pyramid_extent.height;
+    desc.format = VK_FORMAT_R32_SFLOAT;
+    desc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    desc.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    desc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    desc.mip_levels = pyramid_levels;
+    pyramid = resources.create_image(desc);
+
+    for (uint32_t level = 0; level < pyramid_levels; ++level) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resources.get_image(pyramid);
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+        VkImageView view;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("Unable to create VkImageView!");
+        }
+        level_views.push_back(view);
+    }
+    if (!occlusion) return;
+    /*Sets never change until the next resize*/
+    for (uint32_t level = 0; level < pyramid_levels; ++level) {
+        VkDescriptorSet set = reduce_descriptors->allocate(reduce_layout);
+        descriptor_write_t writes[] = {
+                level == 0 ? image_descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depth_view, sampler,
+                                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+                           : image_descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, level_views[level - 1], sampler,
+                                              VK_IMAGE_LAYOUT_GENERAL),
+                image_descriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, level_views[level], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL)
+        };
+        write_descriptors(device, set, writes, 2);
+        reduce_sets.push_back(set);
+    }
+}
+
+bool VkGpuCulling::collect(uint32_t frame, cull_stats_t &stats) {
+    frame_t& slot = frames.at(frame);
+    if (slot.draws == 0) return false;
+    const auto* counters = static_cast<const uint32_t*>(resources.get_mapped(readback)) + frame * 2;
+    stats = {slot.draws, counters[0], counters[1]};
+    slot.draws = 0;
+    return true;
+}
+
+void VkGpuCulling::cull(VkCommandBuffer command_buffer, uint32_t frame, const VkDrawList &draw_list, const glm::mat4 &view_proj) {
+    frame_t& slot = frames.at(frame);
+    uint32_t draw_count = draw_list.get_draw_count();
+    if (draw_count > slot.capacity) {
+        /*The slot's last submission has completed*/
+        destroy_frame_buffers(slot);
+        create_frame_buffers(slot, std::max(draw_count, slot.capacity * 2));
+    }
+    frame_view_proj = view_proj;
+    cull_uniforms_t uniforms{};
+    uniforms.previous_view_proj = pyramid_view_proj;
+    extract_frustum_planes(view_proj, uniforms.planes);
+    uniforms.pyramid_size = glm::vec2(pyramid_extent.width, pyramid_extent.height);
+    uniforms.draw_count = draw_count;
+    uniforms.occlusion = occlusion && pyramid_valid ? 1 : 0;
+    *static_cast<cull_uniforms_t*>(resources.get_mapped(slot.uniforms)) = uniforms;
+
+    /*The draw list buffers may have grown since the slot was last used*/
+    descriptor_write_t writes[] = {
+            buffer_descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, resources.get_buffer(slot.uniforms), 0, sizeof(cull_uniforms_t)),
+            buffer_descriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, draw_list.get_draw_buffer(), 0, VK_WHOLE_SIZE),
+            buffer_descriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, draw_list.get_command_buffer(), 0, VK_WHOLE_SIZE),
+            buffer_descriptor(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, resources.get_buffer(slot.visible), 0, VK_WHOLE_SIZE),
+            buffer_descriptor(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, resources.get_buffer(slot.counts), 0, VK_WHOLE_SIZE),
+            buffer_descriptor(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, resources.get_buffer(slot.stats), 0, VK_WHOLE_SIZE),
+            image_descriptor(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, resources.get_image_view(pyramid), sampler, VK_IMAGE_LAYOUT_GENERAL)
+    };
+    write_descriptors(device, slot.set, writes, 7);
+
+    vkCmdFillBuffer(command_buffer, resources.get_buffer(slot.counts), 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(command_buffer, resources.get_buffer(slot.stats), 0, VK_WHOLE_SIZE, 0);
+    /*The fills, and the previous frame's pyramid, before the culling reads them*/
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    if (!pyramid_initialized) {
+        VkImageMemoryBarrier pyramidBarrier = image_barrier(resources.get_image(pyramid), VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                                                            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 1, &pyramidBarrier);
+        pyramid_initialized = true;
+    } else {
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (draw_count > 0) {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, resources.get_pipeline(cull_pipeline));
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout, 0, 1, &slot.set, 0, nullptr);
+        vkCmdDispatch(command_buffer, (draw_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    }
+    memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    slot.draws = draw_count;
+}
+
+void VkGpuCulling::finish(VkCommandBuffer command_buffer, uint32_t frame, VkImage depth_image) {
+    frame_t& slot = frames.at(frame);
+    if (occlusion && pyramid.valid()) {
+        /*Depth writes before the reduction reads them, and this frame's culling reads of the pyramid before it is rewritten*/
+        VkImageMemoryBarrier depthBarrier = image_barrier(depth_image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                                          VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, resources.get_pipeline(reduce_pipeline));
+        for (uint32_t level = 0; level < pyramid_levels; ++level) {
+            reduce_constants_t constants{};
+            constants.source_size[0] = static_cast<int32_t>(level == 0 ? depth_extent.width : std::max(pyramid_extent.width >> (level - 1), 1u));
+            constants.source_size[1] = static_cast<int32_t>(level == 0 ? depth_extent.height : std::max(pyramid_extent.height >> (level - 1), 1u));
+            constants.destination_size[0] = static_cast<int32_t>(std::max(pyramid_extent.width >> level, 1u));
+            constants.destination_size[1] = static_cast<int32_t>(std::max(pyramid_extent.height >> level, 1u));
+            if (level > 0) {
+                memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            }
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, reduce_pipeline_layout, 0, 1, &reduce_sets[level], 0, nullptr);
+            vkCmdPushConstants(command_buffer, reduce_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+            vkCmdDispatch(command_buffer, (constants.destination_size[0] + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+                          (constants.destination_size[1] + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+        }
+        /*Back to the layout the next frame clears; its depth tests wait for the reduction*/
+        depthBarrier = image_barrier(depth_image, VK_IMAGE_ASPECT_DEPTH_BIT, 0,
+                                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+        pyramid_valid = true;
+        pyramid_view_proj = frame_view_proj;
+    }
+
+    /*Counters into this slot's entry of the ring, read after the slot's fence*/
+    memory_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    VkBufferCopy region{0, frame * 2 * sizeof(uint32_t), 2 * sizeof(uint32_t)};
+    vkCmdCopyBuffer(command_buffer, resources.get_buffer(slot.stats), resources.get_buffer(readback), 1, &region);
+    memory_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
+
+VkBuffer VkGpuCulling::get_visible_buffer(uint32_t frame) const {
+    return resources.get_buffer(frames.at(frame).visible);
+}
+
+VkBuffer VkGpuCulling::get_count_buffer(uint32_t frame) const {
+    return resources.get_buffer(frames.at(frame).counts);
+}
+
+bool VkGpuCulling::uses_occlusion() const {
+    return occlusion;
+}
@@ -0,0 +1,121 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKGPUCULLING_H
+#define HELLO_VULKAN_VKGPUCULLING_H
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "glm/glm.hpp"
+#include "VkUnique.h"
+#include "VkResourceRegistry.h"
+#include "VkShaderLibrary.h"
+#include "VkDescriptorAllocator.h"
+#include "VkDrawList.h"
+#include "BoundingVolumes.h"
+
+/*Per-frame inputs of cull.comp, std140 layout of Cull*/
+struct cull_uniforms_t {
+    glm::mat4 previous_view_proj;
+    /*World space, xyz the inward normal*/
+    glm::vec4 planes[6];
+    glm::vec2 pyramid_size;
+    uint32_t draw_count;
+    uint32_t occlusion;
+};
+
+static_assert(sizeof(cull_uniforms_t) == 176, "cull_uniforms_t must match the std140 layout of Cull!");
+
+/*What the culling pass of one frame rejected*/
+struct cull_stats_t {
+    uint32_t draws;
+    uint32_t frustum_culled;
+    uint32_t occlusion_culled;
+};
+
+/*
+ * Decides visibility on the GPU. A compute pass tests the bounding sphere of every draw
+ * of the frame's VkDrawList against the frustum and, when occlusion is enabled, against
+ * a hierarchical depth pyramid of the previous frame, then writes the visible draws into
+ * the slot's own indirect buffer. With draw counts from a buffer the visible draws of each
+ * batch are packed and counted; otherwise culled draws keep their place with 0 instances.
+ *
+ * The pyramid holds the farthest depth of each texel's footprint, rebuilt from the depth
+ * buffer after every frame, and is shared by the frames in flight like the depth buffer.
+ * Objects are projected with the camera of the frame that produced it; an object that
+ * moved into view from behind an occluder can stay culled for one frame.
+ *
+ * Culled counts are copied into a host visible ring, one entry per frame slot, and read
+ * once the slot's fence was waited.
+ */
+class VkGpuCulling {
+private:
+    struct frame_t {
+        buffer_handle_t uniforms;
+        buffer_handle_t visible;
+        buffer_handle_t counts;
+        buffer_handle_t stats;
+        VkDescriptorSet set;
+        uint32_t capacity;
+        /*Draws culled by the last frame recorded into the slot, 0 until one was*/
+        uint32_t draws;
+    };
+    VkDevice device;
+    VkResourceRegistry& resources;
+    bool compact;
+    bool occlusion;
+    VkUniqueDescriptorSetLayout cull_layout;
+    VkUniqueDescriptorSetLayout reduce_layout;
+    VkUniquePipelineLayout cull_pipeline_layout;
+    VkUniquePipelineLayout reduce_pipeline_layout;
+    pipeline_handle_t cull_pipeline;
+    pipeline_handle_t reduce_pipeline;
+    std::unique_ptr<VkDescriptorAllocator> cull_descriptors;
+    std::unique_ptr<VkDescriptorAllocator> reduce_descriptors;
+    VkUniqueSampler sampler;
+    std::vector<frame_t> frames;
+    /*Two counters per frame slot*/
+    buffer_handle_t readback;
+    image_handle_t pyramid;
+    /*One view per level, level i is written from level i - 1*/
+    std::vector<VkImageView> level_views;
+    std::vector<VkDescriptorSet> reduce_sets;
+    VkExtent2D depth_extent{};
+    VkExtent2D pyramid_extent{};
+    uint32_t pyramid_levels = 0;
+    /*Still UNDEFINED until the first pass moved it to GENERAL*/
+    bool pyramid_initialized = false;
+    /*Holds the depth of a frame drawn at the current size*/
+    bool pyramid_valid = false;
+    glm::mat4 pyramid_view_proj = glm::mat4(1.0f);
+    glm::mat4 frame_view_proj = glm::mat4(1.0f);
+    pipeline_handle_t create_pipeline(VkShaderLibrary& shaders, VkPipelineCache cache, const char* name, VkPipelineLayout layout,
+                                      uint32_t permutation);
+    void create_frame_buffers(frame_t& slot, uint32_t capacity);
+    void destroy_frame_buffers(frame_t& slot);
+    void destroy_pyramid();
+public:
+    /*compact needs vkCmdDrawIndexedIndirectCount; occlusion needs a sampled depth buffer whose contents are stored*/
+    VkGpuCulling(VkDevice device, VkResourceRegistry& resources, VkShaderLibrary& shaders, VkPipelineCache cache, uint32_t frame_count,
+                 bool compact, bool occlusion);
+    VkGpuCulling(const VkGpuCulling&) = delete;
+    VkGpuCulling& operator=(const VkGpuCulling&) = delete;
+    ~VkGpuCulling();
+    /*Rebuilds the pyramid for a new depth buffer; the device must be idle. Needed before the first cull()*/
+    void resize(VkImageView depth_view, VkExtent2D extent);
+    /*Stats of the last frame recorded into slot frame; its fence must have been waited. False if there was none*/
+    bool collect(uint32_t frame, cull_stats_t& stats);
+    /*Before rendering: culls the draw list of slot frame, built for view_proj*/
+    void cull(VkCommandBuffer command_buffer, uint32_t frame, const VkDrawList& draw_list, const glm::mat4& view_proj);
+    /*After rendering: reduces depth_image into the pyramid for the next frame and queues the stats readback*/
+    void finish(VkCommandBuffer command_buffer, uint32_t frame, VkImage depth_image);
+    /*Commands and counts to draw slot frame with, see VkDrawList::record()*/
+    VkBuffer get_visible_buffer(uint32_t frame) const;
+    VkBuffer get_count_buffer(uint32_t frame) const;
+    bool uses_occlusion() const;
+};
+
+
+#endif //HELLO_VULKAN_VKGPUCULLING_H
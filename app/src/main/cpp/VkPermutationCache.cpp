@@ -0,0 +1,132 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <exception>
+#include <stdexcept>
+#include "VkPermutationCache.h"
+#include "Log.h"
+
+static const char* TAG = "VkPermutationCache";
+
+permutation_constants_t::permutation_constants_t(uint32_t permutation) {
+    for (uint32_t i = 0; i < MAX_PERMUTATION_BITS; ++i) {
+        values[i] = (permutation >> i) & 1 ? VK_TRUE : VK_FALSE;
+        entries[i].constantID = i;
+        entries[i].offset = i * sizeof(VkBool32);
+        entries[i].size = sizeof(VkBool32);
+    }
+    info.mapEntryCount = MAX_PERMUTATION_BITS;
+    info.pMapEntries = entries;
+    info.dataSize = sizeof(values);
+    info.pData = values;
+}
+
+VkPermutationCache::VkPermutationCache(VkPipelineTable &_table, const pipeline_state_t &_base, uint32_t supported_bits, builder_t _builder,
+                                       VkPipelineCompiler* _compiler):
+        table(&_table), base(_base), builder(std::move(_builder)), compiler(_compiler),
+        supported(supported_bits & ((1u << MAX_PERMUTATION_BITS) - 1)) {
+
+}
+
+uint32_t VkPermutationCache::normalize(uint32_t permutation) const {
+    return permutation & supported;
+}
+
+bool VkPermutationCache::dynamic_raster() const {
+    return base.dynamic_raster != 0;
+}
+
+uint64_t VkPermutationCache::key_of(uint32_t permutation, const raster_state_t &raster) const {
+    return normalize(permutation) | static_cast<uint64_t>(pack_raster_state(baked_raster_state(raster, dynamic_raster()))) << 32;
+}
+
+pipeline_entry_t *VkPermutationCache::request(uint32_t permutation, const raster_state_t& raster, bool async) {
+    permutation = normalize(permutation);
+    uint64_t key = key_of(permutation, raster);
+    auto it = variants.find(key);
+    if (it != variants.end()) {
+        ++hits;
+        return it->second;
+    }
+    ++misses;
+    pipeline_state_t state = base;
+    state.permutation = permutation;
+    state.raster = baked_raster_state(raster, dynamic_raster());
+    bool created;
+    pipeline_entry_t* entry = table->acquire(state, created);
+    variants.emplace(key, entry);
+    if (!created) {
+        ++shared;
+        return entry;
+    }
+    if (async && compiler != nullptr) {
+        /*The builder is copied, the job may outlive this cache*/
+        compiler->compile([build = builder, entry]() {
+            try {
+                VkPipeline pipeline = build(entry->state);
+                VkPipelineTable::publish(entry, pipeline);
+                return pipeline;
+            } catch (const std::exception&) {
+                VkPipelineTable::fail(entry);
+                throw;
+            }
+        });
+        LOGD(TAG, "Compiling pipeline permutation 0x%x in the background", permutation);
+    } else {
+        try {
+            VkPipelineTable::publish(entry, builder(entry->state));
+        } catch (const std::exception&) {
+            VkPipelineTable::fail(entry);
+            throw;
+        }
+        LOGD(TAG, "Created pipeline permutation 0x%x", permutation);
+    }
+    return entry;
+}
+
+VkPipeline VkPermutationCache::use_fallback() {
+    if (fallback == nullptr || VkPipelineTable::status(fallback) != pipeline_status_t::READY) {
+        throw std::runtime_error("Pipeline permutation is not ready and there is no fallback!");
+    }
+    ++fallbacks;
+    return fallback->pipeline;
+}
+
+VkPipeline VkPermutationCache::get(uint32_t permutation, const raster_state_t& raster) {
+    pipeline_entry_t* entry = request(permutation, raster, true);
+    if (VkPipelineTable::status(entry) == pipeline_status_t::READY) {
+        return entry->pipeline;
+    }
+    return use_fallback();
+}
+
+void VkPermutationCache::set_fallback(uint32_t permutation, const raster_state_t& raster) {
+    pipeline_entry_t* entry = request(permutation, raster, false);
+    /*Another thread may still be compiling it*/
+    if (VkPipelineTable::wait(entry) == VK_NULL_HANDLE) {
+        throw std::runtime_error("Unable to create fallback pipeline!");
+    }
+    fallback = entry;
+}
+
+bool VkPermutationCache::contains(uint32_t permutation, const raster_state_t& raster) const {
+    auto it = variants.find(key_of(permutation, raster));
+    return it != variants.end() && VkPipelineTable::status(it->second) == pipeline_status_t::READY;
+}
+
+permutation_stats_t VkPermutationCache::get_stats() const {
+    permutation_stats_t stats{};
+    for (auto& [key, entry]: variants) {
+        switch (VkPipelineTable::status(entry)) {
+            case pipeline_status_t::READY: ++stats.pipelines; break;
+            case pipeline_status_t::PENDING: ++stats.pending; break;
+            default: break;
+        }
+    }
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.shared = shared;
+    stats.fallbacks = fallbacks;
+    return stats;
+}
@@ -0,0 +1,90 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKPERMUTATIONCACHE_H
+#define HELLO_VULKAN_VKPERMUTATIONCACHE_H
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include "VkPipelineCompiler.h"
+#include "VkPipelineTable.h"
+
+/*Bit N of a permutation feeds the shader's constant_id N*/
+enum shader_permutation_t : uint32_t {
+    PERMUTATION_NONE = 0,
+    PERMUTATION_TEXTURE = 1 << 0,
+    PERMUTATION_ALPHA_TEST = 1 << 1,
+    /*Encode to sRGB in the shader, for UNORM swapchains*/
+    PERMUTATION_SRGB_ENCODE = 1 << 2,
+};
+
+constexpr uint32_t MAX_PERMUTATION_BITS = 8;
+
+/*VkSpecializationInfo pointing into its own storage, so it can not be copied*/
+struct permutation_constants_t {
+    VkBool32 values[MAX_PERMUTATION_BITS];
+    VkSpecializationMapEntry entries[MAX_PERMUTATION_BITS];
+    VkSpecializationInfo info;
+    explicit permutation_constants_t(uint32_t permutation);
+    permutation_constants_t(const permutation_constants_t&) = delete;
+    permutation_constants_t& operator=(const permutation_constants_t&) = delete;
+};
+
+struct permutation_stats_t {
+    uint32_t pipelines;
+    uint32_t pending;
+    uint64_t hits;
+    uint64_t misses;
+    /*Misses that found the pipeline already in the table*/
+    uint64_t shared;
+    /*Lookups answered with the fallback while the variant was compiling*/
+    uint64_t fallbacks;
+};
+
+/*
+ * Pipeline variants of one base pipeline_state_t, keyed by permutation bitmask and
+ * the raster state of the draw (only its topology class when the base uses dynamic
+ * raster state, so materials differing in cull/depth state share one pipeline).
+ * Variants are looked up in the shared VkPipelineTable and only created on first
+ * request, so only permutations that are actually drawn get compiled, and variants
+ * equal to another material's pipeline are not compiled twice. Bits the shaders do
+ * not declare are masked out before the lookup.
+ * With a compiler, get() never blocks: a missing variant is compiled on a worker
+ * and the fallback variant is returned until it is ready.
+ */
+class VkPermutationCache {
+public:
+    typedef std::function<VkPipeline(const pipeline_state_t&)> builder_t;
+private:
+    VkPipelineTable* table = nullptr;
+    pipeline_state_t base;
+    builder_t builder;
+    VkPipelineCompiler* compiler = nullptr;
+    uint32_t supported = 0;
+    /*permutation | pack_raster_state() << 32*/
+    std::unordered_map<uint64_t, pipeline_entry_t*> variants;
+    pipeline_entry_t* fallback = nullptr;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t shared = 0;
+    uint64_t fallbacks = 0;
+    uint64_t key_of(uint32_t permutation, const raster_state_t& raster) const;
+    pipeline_entry_t* request(uint32_t permutation, const raster_state_t& raster, bool async);
+    VkPipeline use_fallback();
+    bool dynamic_raster() const;
+public:
+    VkPermutationCache(VkPipelineTable& table, const pipeline_state_t& base, uint32_t supported_bits, builder_t builder,
+                       VkPipelineCompiler* compiler = nullptr);
+    uint32_t normalize(uint32_t permutation) const;
+    VkPipeline get(uint32_t permutation, const raster_state_t& raster);
+    /*Compiles synchronously if needed and makes the variant the fallback for pending ones*/
+    void set_fallback(uint32_t permutation, const raster_state_t& raster);
+    /*True when the variant can be bound without falling back*/
+    bool contains(uint32_t permutation, const raster_state_t& raster) const;
+    permutation_stats_t get_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKPERMUTATIONCACHE_H
@@ -0,0 +1,86 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <exception>
+#include "VkPipelineCompiler.h"
+#include "Log.h"
+
+static const char* TAG = "VkPipelineCompiler";
+
+pipeline_future_t::pipeline_future_t(std::shared_ptr<pipeline_compile_state_t> _state): state(std::move(_state)) {
+
+}
+
+bool pipeline_future_t::valid() const {
+    return state != nullptr;
+}
+
+pipeline_status_t pipeline_future_t::status() const {
+    return state->status.load(std::memory_order_acquire);
+}
+
+bool pipeline_future_t::ready() const {
+    return status() == pipeline_status_t::READY;
+}
+
+VkPipeline pipeline_future_t::get() const {
+    state->status.wait(pipeline_status_t::PENDING, std::memory_order_acquire);
+    return state->pipeline;
+}
+
+VkPipelineCompiler::VkPipelineCompiler(JobSystem &_jobs, std::function<void()> _on_complete):
+        jobs(&_jobs), on_complete(std::move(_on_complete)) {
+
+}
+
+VkPipelineCompiler::~VkPipelineCompiler() {
+    wait_idle();
+}
+
+pipeline_future_t VkPipelineCompiler::compile(std::function<VkPipeline()> build) {
+    auto state = std::make_shared<pipeline_compile_state_t>();
+    state->build = std::move(build);
+    /*The job keeps its own reference, so dropping the future never frees a running compilation*/
+    auto ref = new std::shared_ptr<pipeline_compile_state_t>(state);
+    in_flight.fetch_add(1, std::memory_order_relaxed);
+    job_t* job = jobs->create_job([this, ref]() {
+        pipeline_compile_state_t& s = **ref;
+        pipeline_status_t result = pipeline_status_t::READY;
+        try {
+            s.pipeline = s.build();
+        } catch (const std::exception& e) {
+            LOGE(TAG, "Pipeline compilation failed: %s", e.what());
+            result = pipeline_status_t::FAILED;
+        }
+        (result == pipeline_status_t::READY ? compiled : failed).fetch_add(1, std::memory_order_relaxed);
+        s.build = nullptr;
+        s.status.store(result, std::memory_order_release);
+        s.status.notify_all();
+        delete ref;
+        if (on_complete) on_complete();
+        std::lock_guard<std::mutex> guard(idle_lock);
+        if (in_flight.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            idle_cond.notify_all();
+        }
+    });
+    jobs->run(job);
+    return pipeline_future_t(std::move(state));
+}
+
+void VkPipelineCompiler::wait_idle() {
+    std::unique_lock<std::mutex> guard(idle_lock);
+    idle_cond.wait(guard, [this]() { return in_flight.load(std::memory_order_acquire) == 0; });
+}
+
+uint32_t VkPipelineCompiler::get_in_flight() const {
+    return in_flight.load(std::memory_order_relaxed);
+}
+
+uint64_t VkPipelineCompiler::get_compiled() const {
+    return compiled.load(std::memory_order_relaxed);
+}
+
+uint64_t VkPipelineCompiler::get_failed() const {
+    return failed.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,71 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKPIPELINECOMPILER_H
+#define HELLO_VULKAN_VKPIPELINECOMPILER_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vulkan/vulkan.h>
+#include "JobSystem.h"
+
+enum class pipeline_status_t : uint32_t {
+    PENDING,
+    READY,
+    FAILED
+};
+
+struct pipeline_compile_state_t {
+    std::atomic<pipeline_status_t> status{pipeline_status_t::PENDING};
+    /*Written once by the worker before status leaves PENDING*/
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    std::function<VkPipeline()> build;
+};
+
+/*Shared handle to one background compilation, empty when default constructed*/
+class pipeline_future_t {
+private:
+    std::shared_ptr<pipeline_compile_state_t> state;
+public:
+    pipeline_future_t() = default;
+    explicit pipeline_future_t(std::shared_ptr<pipeline_compile_state_t> state);
+    bool valid() const;
+    pipeline_status_t status() const;
+    bool ready() const;
+    /*Blocks until the worker finished, VK_NULL_HANDLE if compilation failed*/
+    VkPipeline get() const;
+};
+
+/*
+ * Compiles pipelines on the JobSystem workers so the render thread never waits for
+ * the driver. The pipeline cache passed to vkCreateGraphicsPipelines is internally
+ * synchronized, so any number of compilations may run at once.
+ */
+class VkPipelineCompiler {
+private:
+    JobSystem* jobs;
+    /*Called on the worker after a compilation finished, e.g. to request a frame*/
+    std::function<void()> on_complete;
+    /*Only decremented under idle_lock, so wait_idle() cannot return while a worker still signals it*/
+    std::atomic<uint32_t> in_flight{0};
+    std::mutex idle_lock;
+    std::condition_variable idle_cond;
+    std::atomic<uint64_t> compiled{0};
+    std::atomic<uint64_t> failed{0};
+public:
+    VkPipelineCompiler(JobSystem& jobs, std::function<void()> on_complete = nullptr);
+    ~VkPipelineCompiler();
+    pipeline_future_t compile(std::function<VkPipeline()> build);
+    /*Blocks until every submitted compilation finished*/
+    void wait_idle();
+    uint32_t get_in_flight() const;
+    uint64_t get_compiled() const;
+    uint64_t get_failed() const;
+};
+
+
+#endif //HELLO_VULKAN_VKPIPELINECOMPILER_H
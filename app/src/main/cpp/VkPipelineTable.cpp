@@ -0,0 +1,178 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include "VkPipelineTable.h"
+
+pipeline_state_t make_pipeline_state() {
+    pipeline_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.polygon_mode = VK_POLYGON_MODE_FILL;
+    state.raster = make_raster_state();
+    state.blend_enable = VK_FALSE;
+    state.src_color_blend = VK_BLEND_FACTOR_ONE;
+    state.dst_color_blend = VK_BLEND_FACTOR_ZERO;
+    state.color_blend_op = VK_BLEND_OP_ADD;
+    state.src_alpha_blend = VK_BLEND_FACTOR_ONE;
+    state.dst_alpha_blend = VK_BLEND_FACTOR_ZERO;
+    state.alpha_blend_op = VK_BLEND_OP_ADD;
+    state.color_write_mask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    return state;
+}
+
+raster_state_t make_raster_state() {
+    raster_state_t raster{};
+    raster.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    raster.cull_mode = VK_CULL_MODE_NONE;
+    raster.front_face = VK_FRONT_FACE_CLOCKWISE;
+    raster.depth_test = VK_FALSE;
+    raster.depth_write = VK_FALSE;
+    raster.depth_compare = VK_COMPARE_OP_LESS;
+    return raster;
+}
+
+raster_state_t baked_raster_state(const raster_state_t &raster, bool dynamic) {
+    if (!dynamic) return raster;
+    raster_state_t baked = make_raster_state();
+    /*Dynamic topology must stay within the class the pipeline was created with*/
+    switch (raster.topology) {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            baked.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            break;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            baked.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+            break;
+        case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+            baked.topology = VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+            break;
+        default:
+            baked.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            break;
+    }
+    return baked;
+}
+
+uint32_t pack_raster_state(const raster_state_t &raster) {
+    return raster.topology | (raster.cull_mode & 0x3u) << 4 | (raster.front_face & 0x1u) << 6 | (raster.depth_test & 0x1u) << 7
+           | (raster.depth_write & 0x1u) << 8 | (raster.depth_compare & 0x7u) << 9;
+}
+
+uint64_t hash_pipeline_state(const pipeline_state_t &state) {
+    /*Word-wise multiply/rotate mix, 16 rounds for the whole state*/
+    uint64_t words[sizeof(pipeline_state_t) / sizeof(uint64_t)];
+    memcpy(words, &state, sizeof(words));
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (uint64_t word: words) {
+        hash ^= word * 0xC2B2AE3D27D4EB4Full;
+        hash = (hash << 31 | hash >> 33) * 0x9E3779B185EBCA87ull;
+    }
+    hash ^= hash >> 29;
+    /*0 marks a free slot*/
+    return hash != 0 ? hash : 1;
+}
+
+bool operator==(const pipeline_state_t &a, const pipeline_state_t &b) {
+    return memcmp(&a, &b, sizeof(pipeline_state_t)) == 0;
+}
+
+VkPipelineTable::VkPipelineTable(uint32_t capacity) {
+    uint32_t size = 1;
+    while (size < capacity) size <<= 1;
+    entries = std::make_unique<pipeline_entry_t[]>(size);
+    mask = size - 1;
+}
+
+pipeline_entry_t *VkPipelineTable::probe(const pipeline_state_t &state, uint64_t hash, bool insert, bool &created) {
+    created = false;
+    lookups.fetch_add(1, std::memory_order_relaxed);
+    uint32_t index = static_cast<uint32_t>(hash) & mask;
+    for (uint32_t i = 0; i <= mask; ++i, index = (index + 1) & mask) {
+        pipeline_entry_t& entry = entries[index];
+        uint64_t slot_hash = entry.hash.load(std::memory_order_acquire);
+        if (slot_hash == 0) {
+            if (!insert) return nullptr;
+            if (entry.hash.compare_exchange_strong(slot_hash, hash, std::memory_order_acq_rel)) {
+                entry.state = state;
+                entry.published.store(1, std::memory_order_release);
+                entry.published.notify_all();
+                size.fetch_add(1, std::memory_order_relaxed);
+                inserts.fetch_add(1, std::memory_order_relaxed);
+                probes.fetch_add(i, std::memory_order_relaxed);
+                created = true;
+                return &entry;
+            }
+            /*Lost the race, slot_hash now holds the winner's hash*/
+        }
+        if (slot_hash == hash) {
+            /*The claiming thread writes the state right after its CAS*/
+            entry.published.wait(0, std::memory_order_acquire);
+            if (entry.state == state) {
+                probes.fetch_add(i, std::memory_order_relaxed);
+                return &entry;
+            }
+        }
+    }
+    if (insert) {
+        throw std::runtime_error("Pipeline table is full!");
+    }
+    return nullptr;
+}
+
+pipeline_entry_t *VkPipelineTable::acquire(const pipeline_state_t &state, bool &created) {
+    return probe(state, hash_pipeline_state(state), true, created);
+}
+
+pipeline_entry_t *VkPipelineTable::find(const pipeline_state_t &state) {
+    bool created;
+    return probe(state, hash_pipeline_state(state), false, created);
+}
+
+void VkPipelineTable::publish(pipeline_entry_t *entry, VkPipeline pipeline) {
+    entry->pipeline = pipeline;
+    entry->status.store(pipeline_status_t::READY, std::memory_order_release);
+    entry->status.notify_all();
+}
+
+void VkPipelineTable::fail(pipeline_entry_t *entry) {
+    entry->status.store(pipeline_status_t::FAILED, std::memory_order_release);
+    entry->status.notify_all();
+}
+
+pipeline_status_t VkPipelineTable::status(const pipeline_entry_t *entry) {
+    return entry->status.load(std::memory_order_acquire);
+}
+
+VkPipeline VkPipelineTable::wait(const pipeline_entry_t *entry) {
+    entry->status.wait(pipeline_status_t::PENDING, std::memory_order_acquire);
+    return entry->pipeline;
+}
+
+void VkPipelineTable::clear(VkDeletionQueue &deletion_queue, uint64_t retire_value) {
+    for (uint32_t i = 0; i <= mask; ++i) {
+        pipeline_entry_t& entry = entries[i];
+        if (entry.hash.load(std::memory_order_relaxed) == 0) continue;
+        if (status(&entry) == pipeline_status_t::READY) {
+            deletion_queue.retire(retire_value, VK_OBJECT_TYPE_PIPELINE, entry.pipeline);
+        }
+        entry.pipeline = VK_NULL_HANDLE;
+        entry.status.store(pipeline_status_t::PENDING, std::memory_order_relaxed);
+        entry.published.store(0, std::memory_order_relaxed);
+        entry.hash.store(0, std::memory_order_release);
+    }
+    size.store(0, std::memory_order_relaxed);
+}
+
+pipeline_table_stats_t VkPipelineTable::get_stats() const {
+    return {
+        size.load(std::memory_order_relaxed),
+        mask + 1,
+        lookups.load(std::memory_order_relaxed),
+        inserts.load(std::memory_order_relaxed),
+        probes.load(std::memory_order_relaxed)
+    };
+}
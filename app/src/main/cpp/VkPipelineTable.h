@@ -0,0 +1,135 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKPIPELINETABLE_H
+#define HELLO_VULKAN_VKPIPELINETABLE_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vulkan/vulkan.h>
+#include "VkDeletionQueue.h"
+#include "VkUnique.h"
+#include "VkPipelineCompiler.h"
+#include "RenderCommandQueue.h"
+
+constexpr uint32_t MAX_PIPELINE_VERTEX_ATTRIBUTES = 8;
+
+struct pipeline_vertex_attribute_t {
+    uint8_t location;
+    uint8_t binding;
+    uint16_t offset;
+    /*VkFormat*/
+    uint32_t format;
+};
+
+/*
+ * Everything that identifies a graphics pipeline, packed into two cache lines with
+ * no implicit padding so it can be hashed and compared as raw bytes. Enum fields are
+ * narrowed to the smallest type holding the core Vulkan values. Unused attributes
+ * and reserved bytes must stay zero, which make_pipeline_state() guarantees.
+ */
+struct pipeline_state_t {
+    /*VkShaderLibrary::hash_name of each stage*/
+    uint64_t vertex_shader;
+    uint64_t fragment_shader;
+    /*VkPipelineLayout and VkRenderPass, see handle_bits()*/
+    uint64_t layout;
+    uint64_t render_pass;
+    /*VkFormat of the color attachment*/
+    uint32_t color_format;
+    /*shader_permutation_t bits fed as specialization constants*/
+    uint32_t permutation;
+    uint16_t vertex_stride;
+    uint8_t attribute_count;
+    uint8_t polygon_mode;
+    /*Only the topology class is baked when dynamic_raster is set*/
+    raster_state_t raster;
+    uint8_t blend_enable;
+    uint8_t src_color_blend;
+    uint8_t dst_color_blend;
+    uint8_t color_blend_op;
+    uint8_t src_alpha_blend;
+    uint8_t dst_alpha_blend;
+    uint8_t alpha_blend_op;
+    uint8_t color_write_mask;
+    /*Raster state is set with vkCmdSet* (Vulkan 1.3 extended dynamic state)*/
+    uint8_t dynamic_raster;
+    uint8_t reserved;
+    /*VkFormat of the depth attachment, VK_FORMAT_UNDEFINED without one*/
+    uint32_t depth_format;
+    pipeline_vertex_attribute_t attributes[MAX_PIPELINE_VERTEX_ATTRIBUTES];
+};
+
+static_assert(sizeof(pipeline_state_t) == 128, "pipeline_state_t must not contain padding!");
+static_assert(std::has_unique_object_representations_v<pipeline_state_t>, "pipeline_state_t must not contain padding!");
+
+/*Zeroed state with the defaults of the old hard-coded pipeline: opaque triangle list, no culling, no depth*/
+pipeline_state_t make_pipeline_state();
+raster_state_t make_raster_state();
+/*Drops what extended dynamic state can change at draw time, keeping the topology class*/
+raster_state_t baked_raster_state(const raster_state_t& raster, bool dynamic);
+uint32_t pack_raster_state(const raster_state_t&);
+uint64_t hash_pipeline_state(const pipeline_state_t&);
+bool operator==(const pipeline_state_t&, const pipeline_state_t&);
+
+struct pipeline_entry_t {
+    /*0 while the slot is free*/
+    std::atomic<uint64_t> hash{0};
+    /*Set once state was written by the thread that claimed the slot*/
+    std::atomic<uint32_t> published{0};
+    std::atomic<pipeline_status_t> status{pipeline_status_t::PENDING};
+    pipeline_state_t state;
+    /*Valid once status is READY*/
+    VkPipeline pipeline = VK_NULL_HANDLE;
+};
+
+struct pipeline_table_stats_t {
+    uint32_t size;
+    uint32_t capacity;
+    uint64_t lookups;
+    uint64_t inserts;
+    uint64_t probes;
+};
+
+/*
+ * Deduplicating map from pipeline_state_t to VkPipeline. Open addressing with linear
+ * probing over a fixed array; a slot is claimed by a CAS on its hash and is never
+ * freed, so concurrent lookups of the same state always meet in the same slot and
+ * only the thread that claimed it creates the pipeline. Lookups take no lock and
+ * cost one hash plus a short probe. The table does not grow.
+ */
+class VkPipelineTable {
+private:
+    std::unique_ptr<pipeline_entry_t[]> entries;
+    uint32_t mask;
+    std::atomic<uint32_t> size{0};
+    std::atomic<uint64_t> lookups{0};
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> probes{0};
+    pipeline_entry_t* probe(const pipeline_state_t& state, uint64_t hash, bool insert, bool& created);
+public:
+    /*capacity is rounded up to a power of two*/
+    explicit VkPipelineTable(uint32_t capacity = 256);
+    VkPipelineTable(const VkPipelineTable&) = delete;
+    VkPipelineTable& operator=(const VkPipelineTable&) = delete;
+    /*
+     * Returns the entry of state, inserting it when missing. created is true for
+     * exactly one caller per state, which then has to publish() or fail() the entry.
+     */
+    pipeline_entry_t* acquire(const pipeline_state_t& state, bool& created);
+    /*nullptr when state was never acquired*/
+    pipeline_entry_t* find(const pipeline_state_t& state);
+    static void publish(pipeline_entry_t* entry, VkPipeline pipeline);
+    static void fail(pipeline_entry_t* entry);
+    static pipeline_status_t status(const pipeline_entry_t* entry);
+    /*Blocks while the entry is PENDING; VK_NULL_HANDLE if creation failed*/
+    static VkPipeline wait(const pipeline_entry_t* entry);
+    /*Retires every pipeline and empties the table. No other thread may use the table meanwhile*/
+    void clear(VkDeletionQueue& deletion_queue, uint64_t retire_value);
+    pipeline_table_stats_t get_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKPIPELINETABLE_H
@@ -3,18 +3,28 @@
 //
 
 #include "VkRenderer.h"
-#include "VkShader.h"
+#include <limits>
+#include <android/asset_manager_jni.h>
 #include "Log.h"
+#include "BoundingVolumes.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 static const char* TAG = "VkRenderer";
-
-static const float vertexes[] = {
-        1.f, 1.f, 1.f, 1.f,
-        -1.f, 1.f, 0.f, 1.f,
-        -1.f, -1.f, 0.f, 0.f,
-        1.f, -1.f, 1.f, 0.f
+const char* TEXTURE_FILE_PATH = "/data/data/cn.touchair.hello_vulkan/files/652234-statue-1275469_1920.jpg";
+const char* SHADER_ARCHIVE_PATH = "shaders/shaders.pak";
+const char* MESH_FILE_PATH = "/data/data/cn.touchair.hello_vulkan/files/scene.glb";
+/*Sets per descriptor pool; more pools are chained when they run out*/
+const uint32_t FRAME_SETS_PER_POOL = 16;
+const uint32_t MATERIAL_SETS_PER_POOL = 64;
+/*Per mesh optimizer metrics beyond this many are only summed*/
+const size_t MAX_LOGGED_MESHES = 32;
+
+static const mesh_vertex_t vertexes[] = {
+        {{1.f, 1.f, 0.f}, {0.f, 0.f, 1.f}, {1.f, 1.f}},
+        {{-1.f, 1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 1.f}},
+        {{-1.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f}},
+        {{1.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {1.f, 0.f}}
 };
 
 static const uint16_t indices[] = {
@@ -22,32 +32,119 @@ static const uint16_t indices[] = {
         1, 2, 3
 };
 
-struct UBO {
-    glm::mat4 model;
-};
+/*UNORM swapchains do not encode on store, so the shader has to*/
+static uint32_t surface_permutation_of(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_B8G8R8A8_UNORM ? PERMUTATION_SRGB_ENCODE : PERMUTATION_NONE;
+}
+
+/*Bounding sphere of object space bounds in the space dequantize maps from, which scales uniformly*/
+static glm::vec4 bounding_sphere(const glm::mat4& dequantize, const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+    glm::mat4 quantize = glm::inverse(dequantize);
+    glm::vec3 center = glm::vec3(quantize * glm::vec4((bounds_min + bounds_max) * 0.5f, 1.0f));
+    float radius = glm::length(bounds_max - bounds_min) * 0.5f * glm::length(glm::vec3(quantize[0]));
+    return glm::vec4(center, radius);
+}
+
+static const char* descriptor_update_name(descriptor_update_t mode) {
+    switch (mode) {
+        case descriptor_update_t::WRITE: return "descriptor writes";
+        case descriptor_update_t::TEMPLATE: return "descriptor update templates";
+        case descriptor_update_t::PUSH: return "push descriptors";
+        default: return "auto";
+    }
+}
 
-VkRenderer::VkRenderer(JNIEnv *env, jobject activity, jobject surface) {
+VkRenderer::VkRenderer(JNIEnv *env, jobject assets, jobject surface, render_backend_t _backend, descriptor_update_t _descriptor_update,
+                       bool benchmark):
+        backend(_backend), descriptor_update(_descriptor_update) {
     window = ANativeWindow_fromSurface(env, surface);
+    shaders = std::make_unique<VkShaderLibrary>(AAssetManager_fromJava(env, assets), SHADER_ARCHIVE_PATH);
     context = std::make_unique<VkContext>(window);
     device = context->get_device();
     phy_device = context->get_physical_device();
+    deletion_queue.set_device(device);
+    resources.init(device, phy_device, &deletion_queue);
+    shaders->set_device(device);
     format = context->get_swap_chain_format();
+    swap_chain_extent = static_cast<uint64_t>(format.extent.width) << 32 | format.extent.height;
     swap_chain = context->get_swap_chain();
     graphics_queue_info = context->get_queue_info(queue_type_t::GRAPHICS);
     present_queue_info = context->get_queue_info(queue_type_t::PRESENT);
+    bool dynamic_rendering = context->get_features().dynamic_rendering;
+    if (backend == render_backend_t::DYNAMIC_RENDERING && !dynamic_rendering) {
+        LOGW(TAG, "Dynamic rendering is not supported, falling back to render passes");
+    }
+    if (backend == render_backend_t::AUTO || !dynamic_rendering) {
+        backend = dynamic_rendering ? render_backend_t::DYNAMIC_RENDERING : render_backend_t::RENDER_PASS;
+    }
+    LOGI(TAG, "Using %s", backend == render_backend_t::DYNAMIC_RENDERING ? "dynamic rendering" : "render passes");
+    bool push_descriptor = context->get_features().push_descriptor;
+    bool update_template = context->get_features().descriptor_update_template;
+    if (descriptor_update == descriptor_update_t::PUSH && !push_descriptor) {
+        LOGW(TAG, "Push descriptors are not supported, falling back to update templates");
+    }
+    if (descriptor_update == descriptor_update_t::AUTO || (descriptor_update == descriptor_update_t::PUSH && !push_descriptor)) {
+        descriptor_update = push_descriptor ? descriptor_update_t::PUSH : descriptor_update_t::TEMPLATE;
+    }
+    if (descriptor_update == descriptor_update_t::TEMPLATE && !update_template) {
+        LOGW(TAG, "Descriptor update templates are not supported, falling back to descriptor writes");
+        descriptor_update = descriptor_update_t::WRITE;
+    }
+    LOGI(TAG, "Using %s for per-frame data", descriptor_update_name(descriptor_update));
+    /*Meshes are 3D, test and write depth unless the app says otherwise*/
+    material_raster.depth_test = VK_TRUE;
+    material_raster.depth_write = VK_TRUE;
+    vertex_format = find_vertex_format();
+    vertex_shader = vertex_format == vertex_format_t::PACKED ? "packed.vert" : "simple.vert";
+    LOGI(TAG, "Using %s vertices, %u bytes each", vertex_format_name(vertex_format), vertex_format_stride(vertex_format));
+    /*firstInstance carries the draw index, without it every draw is recorded on the CPU*/
+    const device_features_t& features = context->get_features();
+    if (!features.draw_indirect_first_instance) {
+        draw_submission = draw_submission_t::DIRECT;
+    } else if (features.draw_indirect_count && features.multi_draw_indirect) {
+        draw_submission = draw_submission_t::INDIRECT_COUNT;
+    } else {
+        draw_submission = draw_submission_t::INDIRECT;
+    }
+    LOGI(TAG, "Using %s, up to %u per call", draw_submission_name(draw_submission),
+         draw_submission == draw_submission_t::DIRECT ? 1 : features.max_draw_indirect_count);
+    /*Decode the texture and parse the scene on workers while the pipeline is being built*/
+    decode_image_async(TEXTURE_FILE_PATH);
+    load_mesh_async(MESH_FILE_PATH);
+    depth_format = find_depth_format();
+    /*The depth pyramid is reduced from the depth buffer, which then has to be sampled and stored*/
+    VkFormatProperties depthProperties;
+    vkGetPhysicalDeviceFormatProperties(phy_device, depth_format, &depthProperties);
+    occlusion_culling = draw_submission != draw_submission_t::DIRECT
+                        && (depthProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+    LOGI(TAG, "GPU culling: %s, occlusion %s", draw_submission != draw_submission_t::DIRECT ? "on" : "off",
+         occlusion_culling ? "on" : "off");
     create_swap_chain_views();
-    create_render_pass();
+    create_depth_buffer();
+    if (backend == render_backend_t::RENDER_PASS) {
+        create_render_pass();
+    }
     create_layout_descriptor();
     create_graphics_pipeline();
-    create_framebuffers();
+    if (backend == render_backend_t::RENDER_PASS) {
+        create_framebuffers();
+    }
     create_command_pool();
     create_texture();
     create_texture_sampler();
     create_buffers();
-    create_descriptor_pool();
-    create_descriptor_sets();
+    if (draw_submission != draw_submission_t::DIRECT) {
+        /*Packing visible draws needs their count read from a buffer*/
+        culling = std::make_unique<VkGpuCulling>(device, resources, *shaders, pipeline_cache, MAX_FRAMES_IN_FLIGHT,
+                                                 draw_submission == draw_submission_t::INDIRECT_COUNT, occlusion_culling);
+        culling->resize(resources.get_image_view(depth_image), format.extent);
+    }
+    create_descriptor_allocators();
     create_command_buffers();
     create_sync_objects();
+    if (benchmark) {
+        benchmark_descriptor_updates();
+    }
     state = renderer_state_t::PREPARED;
 }
 
@@ -55,19 +152,29 @@ VkRenderer::~VkRenderer() = default;
 
 bool VkRenderer::request_start() {
     if (state != renderer_state_t::PREPARED) return false;
+    update_thread_running = true;
+    update_thread = std::thread([this]() {
+        LOGI(TAG, "UpdateThread started, tid=%d", gettid());
+        uint32_t flags;
+        uint64_t frame = 0;
+        start_time = std::chrono::steady_clock::now();
+        while (scheduler.wait_for_frame(flags)) {
+            frame_packet_t& packet = packets.write_packet();
+            on_update(packet, flags, frame++);
+            packets.publish();
+            if (!packets.wait_consumed()) break;
+        }
+        packets.stop();
+        update_thread_running.store(false);
+        update_thread_running.notify_one();
+        LOGI(TAG, "UpdateThread exited, tid=%d", gettid());
+    });
+    vk_thread_running = true;
     vk_thread = std::thread([this]() {
-        vk_thread_running = true;
         LOGI(TAG, "VkThread started, tid=%d", gettid());
         on_begin();
-        for (;;) {
-            if (state == renderer_state_t::RUNNING) {
-                on_draw();
-            } else if (state == renderer_state_t::PAUSED) {
-                state.wait(renderer_state_t::PAUSED);
-            }
-            if (state == renderer_state_t::INVALID) {
-                break;
-            }
+        while (const frame_packet_t* packet = packets.acquire()) {
+            on_draw(*packet);
         }
         on_end();
         vk_thread_running.store(false);
@@ -75,6 +182,7 @@ bool VkRenderer::request_start() {
         LOGI(TAG, "VkThread exited, tid=%d", gettid());
     });
     state = renderer_state_t::RUNNING;
+    update_thread.detach();
     vk_thread.detach();
     return true;
 }
@@ -82,51 +190,83 @@ bool VkRenderer::request_start() {
 void VkRenderer::request_pause() {
     if (state == renderer_state_t::RUNNING) {
         state = renderer_state_t::PAUSED;
+        scheduler.pause();
     }
 }
 
 void VkRenderer::request_resume() {
     if (state == renderer_state_t::PAUSED) {
         state = renderer_state_t::RUNNING;
-        state.notify_one();
+        scheduler.resume();
     }
 }
 
+void VkRenderer::request_render(uint32_t flags) {
+    scheduler.mark_dirty(flags);
+}
+
+void VkRenderer::request_animation(std::chrono::milliseconds duration) {
+    scheduler.animate_for(duration);
+}
+
+void VkRenderer::set_render_mode(render_mode_t mode) {
+    scheduler.set_mode(mode);
+}
+
+bool VkRenderer::submit(const render_command_t &command) {
+    if (!commands.push(command)) {
+        LOGW(TAG, "Command queue is full, dropped command %d", static_cast<int>(command.type));
+        return false;
+    }
+    scheduler.mark_dirty(command.type == render_command_type_t::SURFACE_CHANGED ? DIRTY_SURFACE : DIRTY_SCENE);
+    return true;
+}
+
+bool VkRenderer::has_extent(uint32_t width, uint32_t height) const {
+    return swap_chain_extent.load() == (static_cast<uint64_t>(width) << 32 | height);
+}
+
 void VkRenderer::release() {
     if (state == renderer_state_t::INVALID) return;
     state = renderer_state_t::INVALID;
-    state.notify_one();
+    scheduler.stop();
+    packets.stop();
+    update_thread_running.wait(true);
     vk_thread_running.wait(true);
-    vkDeviceWaitIdle(device);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
-        vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
-        vkDestroyFence(device, in_flight_fences[i], nullptr);
+    if (image_job != nullptr) {
+        jobs.wait(image_job);
+        stbi_image_free(decoded_image.pixels);
+        image_job = nullptr;
     }
+    vkDeviceWaitIdle(device);
+    /*Waits for background compilations before their pipelines are retired*/
+    compiler = nullptr;
+    permutations = nullptr;
+    pipeline_table.clear(deletion_queue, submitted_frames);
+    deletion_queue.flush();
+    bindless = nullptr;
+    culling = nullptr;
+    image_available_semaphores.clear();
+    render_finished_semaphores.clear();
+    in_flight_fences.clear();
     vkFreeCommandBuffers(device, command_pool, command_buffers.size(), command_buffers.data());
-    vkDestroyCommandPool(device, command_pool, nullptr);
-    vkDestroyBuffer(device, VBO, nullptr);
-    vkDestroyBuffer(device, EBO, nullptr);
-    vkFreeMemory(device, VBO_mem, nullptr);
-    vkFreeMemory(device, EBO_mem, nullptr);
-    vkDestroyImage(device, tex, nullptr);
-    vkFreeMemory(device, tex_mem, nullptr);
-    for(int i = 0; i < framebuffers.size(); ++i) {
-        vkDestroyFramebuffer(device, framebuffers[i], nullptr);
-        vkDestroyImageView(device, image_views[i], nullptr);
-    }
-    vkDestroyImageView(device, tex_view, nullptr);
-    vkDestroySampler(device, tex_sampler, nullptr);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroyBuffer(device, UBOs[i], nullptr);
-        vkFreeMemory(device, UBO_mems[i], nullptr);
-    }
-    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
-    vkDestroyDescriptorSetLayout(device, descriptor_layout, nullptr);
-    vkDestroyPipeline(device, pipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
-    vkDestroyRenderPass(device, render_pass, nullptr);
-    vkDestroyDescriptorSetLayout(device, descriptor_layout, nullptr);
+    command_pool.reset();
+    destroy_swap_chain_resources();
+    resources.clear();
+    pipeline_cache.reset();
+    tex_sampler.reset();
+    if (mesh_job != nullptr) {
+        jobs.wait(mesh_job);
+        mesh_job = nullptr;
+    }
+    frame_template = nullptr;
+    frame_descriptors.clear();
+    material_descriptors = nullptr;
+    pipeline_layout.reset();
+    material_layout.reset();
+    descriptor_layout.reset();
+    render_pass.reset();
+    shaders = nullptr;
     context = nullptr;
     ANativeWindow_release(window);
 }
@@ -142,95 +282,190 @@ void VkRenderer::create_render_pass() {
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
+    /*Only needed within the frame, unless the depth pyramid is reduced from it*/
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depth_format;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = occlusion_culling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+    /*The depth buffer is shared by the frames in flight, the previous frame's tests must finish before the clear*/
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+    VkAttachmentDescription attachments[] = {colorAttachment, depthAttachment};
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = 2;
+    renderPassInfo.pAttachments = attachments;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &render_pass) != VK_SUCCESS) {
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, render_pass.put(device)) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create vkRenderPass!");
     }
 }
 
 void VkRenderer::create_layout_descriptor() {
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorCount = 1;
-    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
-    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+    /*Set 0 holds the per-frame uniforms, set 1 the textures: one bindless set when the device can index it*/
+    if (context->get_features().descriptor_indexing) {
+        bindless = std::make_unique<VkBindlessTable>(device, context->get_features().max_bindless_textures);
+        fragment_shader = "bindless.frag";
+    }
+    /*Layout, pool sizes and vertex input all come from the shader bytecode*/
+    shader_interface = std::make_unique<ShaderInterface>(std::initializer_list<const shader_reflection_t*>{
+            &shaders->reflect(vertex_shader),
+            &shaders->reflect(fragment_shader)
+    });
+    std::vector<VkDescriptorSetLayoutBinding> bindings = shader_interface->get_set_layout_bindings(0);
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
     layoutInfo.pBindings = bindings.data();
+    if (descriptor_update == descriptor_update_t::PUSH) {
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+    }
 
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptor_layout) != VK_SUCCESS) {
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, descriptor_layout.put(device)) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+    if (bindless) return;
+    std::vector<VkDescriptorSetLayoutBinding> materialBindings = shader_interface->get_set_layout_bindings(1);
+    layoutInfo.flags = 0;
+    layoutInfo.bindingCount = static_cast<uint32_t>(materialBindings.size());
+    layoutInfo.pBindings = materialBindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, material_layout.put(device)) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create descriptor set layout!");
     }
 }
 
-void VkRenderer::create_descriptor_pool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = poolSizes.size();
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptor_pool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool!");
+void VkRenderer::create_descriptor_allocators() {
+    std::vector<VkDescriptorSetLayoutBinding> bindings = shader_interface->get_set_layout_bindings(0);
+    if (descriptor_update == descriptor_update_t::PUSH) {
+        /*Set 0 lives in the command buffer, nothing to allocate*/
+        frame_template = std::make_unique<VkDescriptorTemplate>(device, bindings, descriptor_layout, pipeline_layout, 0);
+    } else {
+        if (descriptor_update == descriptor_update_t::TEMPLATE) {
+            frame_template = std::make_unique<VkDescriptorTemplate>(device, bindings, descriptor_layout);
+        }
+        /*Set 0 is transient, every frame allocates and writes its own and the pools are reset after the fence*/
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            frame_descriptors.push_back(std::make_unique<VkDescriptorAllocator>(device, shader_interface->get_pool_sizes(0, FRAME_SETS_PER_POOL),
+                                                                                FRAME_SETS_PER_POOL));
+        }
+    }
+    if (bindless) {
+        material_textures.assign(1, bindless->add(resources.get_image_view(tex), tex_sampler));
+        return;
     }
+    /*Material sets never change once written, so equal contents share one set*/
+    material_descriptors = std::make_unique<VkDescriptorSetCache>(device, shader_interface->get_pool_sizes(1, MATERIAL_SETS_PER_POOL),
+                                                                  MATERIAL_SETS_PER_POOL);
 }
 
 void VkRenderer::create_graphics_pipeline() {
-    VkShaderModule vert_shader_module = create_shader_mode(simple_vert_spv, simple_vert_spv_len);
-    VkShaderModule frag_shader_module = create_shader_mode(simple_frag_spv, simple_frag_spv_len);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    VkDescriptorSetLayout setLayouts[] = {descriptor_layout, bindless ? bindless->get_layout() : material_layout.get()};
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    /*Per-draw data lives in the draw list, indexed by instance*/
+    VkPushConstantRange pushConstantRange{};
+    if (shader_interface->get_push_constant_range(pushConstantRange)) {
+        throw std::runtime_error("Shaders must read per-draw data from the draw list, not push constants!");
+    }
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, pipeline_layout.put(device)) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to create pipeline layout!");
+    }
+
+    /*Permutations share most of their compiled state, let the driver reuse it*/
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, pipeline_cache.put(device)) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to create pipeline cache!");
+    }
+
+    surface_permutation = surface_permutation_of(format.image_format.format);
+    /*A finished compilation needs a frame even when nothing else changed*/
+    compiler = std::make_unique<VkPipelineCompiler>(jobs, [this]() {
+        scheduler.mark_dirty(DIRTY_SCENE);
+    });
+
+    pipeline_state_t state = make_pipeline_state();
+    state.vertex_shader = VkShaderLibrary::hash_name(vertex_shader);
+    state.fragment_shader = VkShaderLibrary::hash_name(fragment_shader);
+    state.layout = handle_bits(pipeline_layout.get());
+    /*Null with dynamic rendering, the color format identifies the target instead*/
+    state.render_pass = handle_bits(render_pass.get());
+    state.color_format = format.image_format.format;
+    state.depth_format = depth_format;
+    state.dynamic_raster = context->get_features().extended_dynamic_state;
+    /*The shader only knows the types it reads, the encoded formats come from the vertex format*/
+    std::vector<VkVertexInputAttributeDescription> layout;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    state.vertex_stride = get_vertex_layout(vertex_format, layout);
+    if (!shader_interface->select_vertex_attributes(layout, attributes)) {
+        throw std::runtime_error("Vertex shader inputs do not match the vertex format!");
+    }
+    if (attributes.size() > MAX_PIPELINE_VERTEX_ATTRIBUTES) {
+        throw std::runtime_error("Too many vertex attributes!");
+    }
+    state.attribute_count = attributes.size();
+    for (size_t i = 0; i < attributes.size(); ++i) {
+        state.attributes[i] = {static_cast<uint8_t>(attributes[i].location), static_cast<uint8_t>(attributes[i].binding),
+                               static_cast<uint16_t>(attributes[i].offset), static_cast<uint32_t>(attributes[i].format)};
+    }
+    permutations = std::make_unique<VkPermutationCache>(pipeline_table, state, shader_interface->get_specialization_mask(),
+                                                        [this](const pipeline_state_t& desc) {
+        return build_pipeline(desc);
+    }, compiler.get());
+    /*The plain variant is cheap to compile and stands in for everything still compiling*/
+    permutations->set_fallback(PERMUTATION_NONE | surface_permutation, make_raster_state());
+    permutations->get(material_permutation | surface_permutation, material_raster);
+}
+
+VkPipeline VkRenderer::build_pipeline(const pipeline_state_t& state) {
+    permutation_constants_t specialization(state.permutation);
 
     VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo{};
     vertShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageCreateInfo.module = vert_shader_module;
+    vertShaderStageCreateInfo.module = shaders->get_module(state.vertex_shader);
     vertShaderStageCreateInfo.pName = "main";
+    vertShaderStageCreateInfo.pSpecializationInfo = &specialization.info;
 
     VkPipelineShaderStageCreateInfo fragShaderStageCreateInfo{};
     fragShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageCreateInfo.module = frag_shader_module;
+    fragShaderStageCreateInfo.module = shaders->get_module(state.fragment_shader);
     fragShaderStageCreateInfo.pName = "main";
+    fragShaderStageCreateInfo.pSpecializationInfo = &specialization.info;
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageCreateInfo, fragShaderStageCreateInfo};
 
@@ -238,6 +473,16 @@ void VkRenderer::create_graphics_pipeline() {
             VK_DYNAMIC_STATE_VIEWPORT,
             VK_DYNAMIC_STATE_SCISSOR
     };
+    if (state.dynamic_raster) {
+        dynamicStates.insert(dynamicStates.end(), {
+                VK_DYNAMIC_STATE_CULL_MODE,
+                VK_DYNAMIC_STATE_FRONT_FACE,
+                VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
+                VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+                VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+                VK_DYNAMIC_STATE_DEPTH_COMPARE_OP
+        });
+    }
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -246,46 +491,30 @@ void VkRenderer::create_graphics_pipeline() {
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     VkVertexInputBindingDescription bindingDescription{};
+    VkVertexInputAttributeDescription attributeDescriptions[MAX_PIPELINE_VERTEX_ATTRIBUTES];
 
     bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(float) * 4;
+    bindingDescription.stride = state.vertex_stride;
     bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[0].offset = 0;
-
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[1].offset = sizeof(float) * 2;
+    for (uint32_t i = 0; i < state.attribute_count; ++i) {
+        attributeDescriptions[i].location = state.attributes[i].location;
+        attributeDescriptions[i].binding = state.attributes[i].binding;
+        attributeDescriptions[i].format = static_cast<VkFormat>(state.attributes[i].format);
+        attributeDescriptions[i].offset = state.attributes[i].offset;
+    }
 
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputInfo.vertexBindingDescriptionCount = 1;
     vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.vertexAttributeDescriptionCount = attributeDescriptions.size();
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = state.attribute_count;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.topology = static_cast<VkPrimitiveTopology>(state.raster.topology);
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(format.extent.width);
-    viewport.height = static_cast<float>(format.extent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = format.extent;
-
+    /*Viewport and scissor are dynamic, workers must not read the swapchain extent*/
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
@@ -295,10 +524,10 @@ void VkRenderer::create_graphics_pipeline() {
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.polygonMode = static_cast<VkPolygonMode>(state.polygon_mode);
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.cullMode = state.raster.cull_mode;
+    rasterizer.frontFace = static_cast<VkFrontFace>(state.raster.front_face);
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f; // Optional
     rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -313,15 +542,23 @@ void VkRenderer::create_graphics_pipeline() {
     multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
     multisampling.alphaToOneEnable = VK_FALSE; // Optional
 
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = state.raster.depth_test;
+    depthStencil.depthWriteEnable = state.raster.depth_write;
+    depthStencil.depthCompareOp = static_cast<VkCompareOp>(state.raster.depth_compare);
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+    colorBlendAttachment.colorWriteMask = state.color_write_mask;
+    colorBlendAttachment.blendEnable = state.blend_enable;
+    colorBlendAttachment.srcColorBlendFactor = static_cast<VkBlendFactor>(state.src_color_blend);
+    colorBlendAttachment.dstColorBlendFactor = static_cast<VkBlendFactor>(state.dst_color_blend);
+    colorBlendAttachment.colorBlendOp = static_cast<VkBlendOp>(state.color_blend_op);
+    colorBlendAttachment.srcAlphaBlendFactor = static_cast<VkBlendFactor>(state.src_alpha_blend);
+    colorBlendAttachment.dstAlphaBlendFactor = static_cast<VkBlendFactor>(state.dst_alpha_blend);
+    colorBlendAttachment.alphaBlendOp = static_cast<VkBlendOp>(state.alpha_blend_op);
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -334,19 +571,17 @@ void VkRenderer::create_graphics_pipeline() {
     colorBlending.blendConstants[2] = 0.0f; // Optional
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1; // Optional
-    pipelineLayoutInfo.pSetLayouts = &descriptor_layout; // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipeline_layout) != VK_SUCCESS) {
-        throw std::runtime_error("Unable to create pipeline layout!");
-    }
-
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    VkFormat colorFormat = static_cast<VkFormat>(state.color_format);
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat = static_cast<VkFormat>(state.depth_format);
+    if (state.render_pass == 0) {
+        pipelineInfo.pNext = &renderingInfo;
+    }
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -354,34 +589,35 @@ void VkRenderer::create_graphics_pipeline() {
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = state.depth_format != VK_FORMAT_UNDEFINED || state.dynamic_raster || state.raster.depth_test
+                                      || state.raster.depth_write ? &depthStencil : nullptr;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = pipeline_layout;
-    pipelineInfo.renderPass = render_pass;
+    pipelineInfo.layout = handle_from_bits<VkPipelineLayout>(state.layout);
+    pipelineInfo.renderPass = handle_from_bits<VkRenderPass>(state.render_pass);
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex = -1; // Optional
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    VkPipeline graphicsPipeline;
+    if (vkCreateGraphicsPipelines(device, pipeline_cache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create graphics pipeline!");
     }
-
-    vkDestroyShaderModule(device, vert_shader_module, nullptr);
-    vkDestroyShaderModule(device, frag_shader_module, nullptr);
+    return graphicsPipeline;
 }
 
 void VkRenderer::create_framebuffers() {
     framebuffers.resize(image_views.size());
-    for (int i = 0; i < framebuffers.size(); ++i) {
+    for (size_t i = 0; i < framebuffers.size(); ++i) {
         VkImageView attachments[] = {
-                image_views[i]
+                image_views[i],
+                resources.get_image_view(depth_image)
         };
         VkFramebufferCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         createInfo.pAttachments = attachments;
         createInfo.renderPass = render_pass;
-        createInfo.attachmentCount = 1;
+        createInfo.attachmentCount = 2;
         createInfo.layers = 1;
         createInfo.width = format.extent.width;
         createInfo.height = format.extent.height;
@@ -396,7 +632,7 @@ void VkRenderer::create_command_pool() {
     createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     createInfo.queueFamilyIndex = graphics_queue_info.index;
-    if (vkCreateCommandPool(device, &createInfo, nullptr, &command_pool) != VK_SUCCESS) {
+    if (vkCreateCommandPool(device, &createInfo, nullptr, command_pool.put(device)) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create vkCommandPool!");
     }
 }
@@ -413,47 +649,283 @@ void VkRenderer::create_command_buffers() {
     }
 }
 
-const char* TEXTURE_FILE_PATH = "/data/data/cn.touchair.hello_vulkan/files/652234-statue-1275469_1920.jpg";
 void VkRenderer::create_texture() {
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(TEXTURE_FILE_PATH, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-    if (!pixels) {
+    jobs.wait(image_job);
+    image_job = nullptr;
+    if (!decoded_image.pixels) {
         throw std::runtime_error("Failed to load texture image!");
     }
+    tex = upload_texture(decoded_image);
+}
+
+void VkRenderer::decode_image_async(const char *path) {
+    if (image_job != nullptr) {
+        /*Only one decode in flight, the newer request wins*/
+        jobs.wait(image_job);
+        stbi_image_free(decoded_image.pixels);
+    }
+    decoded_image = {};
+    strncpy(decoded_image.path, path, sizeof(decoded_image.path) - 1);
+    image_job = jobs.create_job([this]() {
+        decoded_image.pixels = stbi_load(decoded_image.path, &decoded_image.width, &decoded_image.height, nullptr, STBI_rgb_alpha);
+        scheduler.mark_dirty(DIRTY_SCENE);
+    });
+    jobs.run(image_job);
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    create_buffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+void VkRenderer::poll_decoded_image() {
+    if (image_job == nullptr || !jobs.is_finished(image_job)) return;
+    image_job = nullptr;
+    if (!decoded_image.pixels) {
+        LOGE(TAG, "Unable to load texture %s", decoded_image.path);
+        return;
+    }
+    image_handle_t img = upload_texture(decoded_image);
+    /*Frames already submitted still sample the old texture*/
+    resources.retire(tex, submitted_frames);
+    tex = img;
+    if (bindless) {
+        /*A fresh slot, the old one may still be read by frames in flight*/
+        bindless->remove(material_textures[0], submitted_frames);
+        material_textures[0] = bindless->add(resources.get_image_view(tex), tex_sampler);
+        return;
+    }
+    /*Cached sets may name the retired view, frames in flight keep using theirs*/
+    material_descriptors->invalidate(submitted_frames);
+}
+
+image_handle_t VkRenderer::upload_texture(decoded_image_t &image) {
+    int texWidth = image.width, texHeight = image.height;
+    stbi_uc* pixels = image.pixels;
+    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    image.pixels = nullptr;
+
+    buffer_handle_t stagingBuffer = create_staging_buffer(imageSize);
+    memcpy(resources.get_mapped(stagingBuffer), pixels, static_cast<size_t>(imageSize));
     stbi_image_free(pixels);
 
-    create_image(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tex, tex_mem);
+    image_desc_t desc{};
+    desc.width = static_cast<uint32_t>(texWidth);
+    desc.height = static_cast<uint32_t>(texHeight);
+    desc.format = VK_FORMAT_R8G8B8A8_SRGB;
+    desc.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    desc.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    desc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_handle_t img = resources.create_image(desc);
+
+    VkImage vk_img = resources.get_image(img);
+    transition_layout(vk_img, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    copy_image_buffer(resources.get_buffer(stagingBuffer), vk_img, desc.width, desc.height);
+    transition_layout(vk_img, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    resources.destroy(stagingBuffer);
+    return img;
+}
+
+void VkRenderer::load_mesh_async(const char *path) {
+    if (mesh_job != nullptr) {
+        /*Only one load in flight, the newer request wins*/
+        jobs.wait(mesh_job);
+    }
+    loaded_mesh.scene = {};
+    loaded_mesh.report = {};
+    loaded_mesh.vertex_data = {};
+    loaded_mesh.valid = false;
+    strncpy(loaded_mesh.path, path, sizeof(loaded_mesh.path) - 1);
+    loaded_mesh.path[sizeof(loaded_mesh.path) - 1] = '\0';
+    mesh_job = jobs.create_job([this]() {
+        try {
+            /*Primitives are converted on the other workers while this one waits*/
+            loaded_mesh.scene = load_glb_file(loaded_mesh.path, &jobs, &loaded_mesh.stats);
+            /*Reorder for the vertex cache before upload, exported assets rarely are*/
+            auto begin = std::chrono::steady_clock::now();
+            optimize_mesh_scene(loaded_mesh.scene, {}, &jobs, &loaded_mesh.report);
+            loaded_mesh.optimize_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            begin = std::chrono::steady_clock::now();
+            loaded_mesh.vertex_data = encode_scene_vertices(loaded_mesh.scene, vertex_format, &jobs);
+            loaded_mesh.encode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            loaded_mesh.valid = true;
+        } catch (const std::exception& e) {
+            LOGW(TAG, "Unable to load mesh %s: %s", loaded_mesh.path, e.what());
+        }
+        scheduler.mark_dirty(DIRTY_SCENE);
+    });
+    jobs.run(mesh_job);
+}
+
+void VkRenderer::poll_loaded_mesh() {
+    if (mesh_job == nullptr || !jobs.is_finished(mesh_job)) return;
+    mesh_job = nullptr;
+    if (!loaded_mesh.valid) return;
+    if (loaded_mesh.scene.indices.empty() || loaded_mesh.scene.nodes.empty()) {
+        LOGW(TAG, "Mesh %s has nothing to draw", loaded_mesh.path);
+    } else {
+        upload_mesh(loaded_mesh);
+    }
+    loaded_mesh.scene = {};
+    loaded_mesh.report = {};
+    loaded_mesh.vertex_data = {};
+    loaded_mesh.valid = false;
+}
+
+void VkRenderer::upload_mesh(const loaded_mesh_t &mesh) {
+    const mesh_scene_t& scene = mesh.scene;
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t stride = vertex_format_stride(vertex_format);
+    VkDeviceSize vertex_size = mesh.vertex_data.size();
+    VkDeviceSize index_size = 0;
+    for (const mesh_primitive_t& primitive: scene.primitives) {
+        index_size += static_cast<VkDeviceSize>(primitive.index_count)
+                      * VkGeometryArena::index_size(VkGeometryArena::select_index_type(primitive.vertex_count));
+    }
 
-    transition_layout(tex, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copy_image_buffer(stagingBuffer, tex, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    transition_layout(tex, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    /*Every primitive gets its own arena range; all of them go through one staging buffer and one submission*/
+    buffer_handle_t stagingBuffer = create_staging_buffer(vertex_size + index_size);
+    auto* data = static_cast<unsigned char*>(resources.get_mapped(stagingBuffer));
+    memcpy(data, mesh.vertex_data.data(), vertex_size);
+    VkCommandBuffer command_buffer;
+    begin_single_time_commands(command_buffer);
+    std::vector<geometry_range_t> ranges(scene.primitives.size(), geometry_range_t{});
+    std::vector<VkBufferCopy> vertexRegions;
+    std::vector<VkBufferCopy> indexRegions;
+    VkDeviceSize staged = vertex_size;
+    uint32_t narrow_primitives = 0;
+    for (size_t i = 0; i < scene.primitives.size(); ++i) {
+        const mesh_primitive_t& primitive = scene.primitives[i];
+        if (primitive.vertex_count == 0 || primitive.index_count == 0) continue;
+        geometry_range_t& range = ranges[i];
+        range = geometry->allocate(command_buffer, primitive.vertex_count, primitive.index_count, submitted_frames);
+        vertexRegions.push_back({static_cast<VkDeviceSize>(primitive.vertex_offset) * stride, geometry->get_vertex_offset(range),
+                                 static_cast<VkDeviceSize>(primitive.vertex_count) * stride});
+        VkGeometryArena::write_indices(&scene.indices[primitive.first_index], primitive.index_count, range.index_type, data + staged);
+        VkDeviceSize bytes = static_cast<VkDeviceSize>(range.index_count) * VkGeometryArena::index_size(range.index_type);
+        indexRegions.push_back({staged, geometry->get_index_offset(range), bytes});
+        staged += bytes;
+        narrow_primitives += range.index_type == VK_INDEX_TYPE_UINT16 ? 1 : 0;
+    }
+    /*Only now, allocating may have replaced the arena buffers*/
+    if (!vertexRegions.empty()) {
+        vkCmdCopyBuffer(command_buffer, resources.get_buffer(stagingBuffer), geometry->get_vertex_buffer(),
+                        static_cast<uint32_t>(vertexRegions.size()), vertexRegions.data());
+        vkCmdCopyBuffer(command_buffer, resources.get_buffer(stagingBuffer), geometry->get_index_buffer(),
+                        static_cast<uint32_t>(indexRegions.size()), indexRegions.data());
+    }
+    end_single_time_commands(command_buffer);
+    resources.destroy(stagingBuffer);
+
+    /*Frames already submitted still draw the old ranges*/
+    for (const geometry_range_t& range: scene_geometry) {
+        geometry->free(range, submitted_frames);
+    }
+    scene_geometry.clear();
+    for (const geometry_range_t& range: ranges) {
+        if (range.index_count > 0) {
+            scene_geometry.push_back(range);
+        }
+    }
+
+    /*Fit the scene into the default view volume, y up like glTF, until the app sets a camera*/
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+    for (const mesh_node_t& node: scene.nodes) {
+        if (node.mesh < 0) continue;
+        const mesh_t& packed = scene.meshes[node.mesh];
+        for (uint32_t i = 0; i < packed.primitive_count; ++i) {
+            const mesh_primitive_t& primitive = scene.primitives[packed.first_primitive + i];
+            for (int corner = 0; corner < 8; ++corner) {
+                glm::vec3 point(corner & 1 ? primitive.bounds_max.x : primitive.bounds_min.x,
+                                corner & 2 ? primitive.bounds_max.y : primitive.bounds_min.y,
+                                corner & 4 ? primitive.bounds_max.z : primitive.bounds_min.z);
+                glm::vec3 world = glm::vec3(node.world * glm::vec4(point, 1.0f));
+                bounds_min = glm::min(bounds_min, world);
+                bounds_max = glm::max(bounds_max, world);
+            }
+        }
+    }
+    glm::vec3 extent = bounds_max - bounds_min;
+    float scale = 2.0f / std::max({extent.x, extent.y, extent.z, 1e-6f});
+    glm::mat4 fit = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.5f))
+                    * glm::scale(glm::mat4(1.0f), glm::vec3(scale, -scale, 0.5f * scale))
+                    * glm::translate(glm::mat4(1.0f), -(bounds_min + bounds_max) * 0.5f);
+
+    mesh_draws.clear();
+    for (const mesh_node_t& node: scene.nodes) {
+        if (node.mesh < 0) continue;
+        const mesh_t& packed = scene.meshes[node.mesh];
+        for (uint32_t i = 0; i < packed.primitive_count; ++i) {
+            const mesh_primitive_t& primitive = scene.primitives[packed.first_primitive + i];
+            const mesh_material_t& material = scene.materials[primitive.material];
+            const geometry_range_t& range = ranges[packed.first_primitive + i];
+            if (range.index_count == 0) continue;
+            glm::mat4 dequantize = dequantization_matrix(vertex_format, make_vertex_quantization(primitive.bounds_min, primitive.bounds_max));
+            mesh_draws.push_back({fit * node.world * dequantize, material.base_color, range.first_index, range.index_count,
+                                  range.vertex_offset, range.index_type, material.double_sided,
+                                  bounding_sphere(dequantize, primitive.bounds_min, primitive.bounds_max)});
+        }
+    }
+    /*Draws with the same index type and culling are consecutive and share an indirect call*/
+    std::stable_sort(mesh_draws.begin(), mesh_draws.end(), [](const mesh_draw_t& a, const mesh_draw_t& b) {
+        return a.index_type != b.index_type ? a.index_type < b.index_type : a.double_sided < b.double_sided;
+    });
+    build_mesh_bvh();
+    double upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    const gltf_load_stats_t& stats = mesh.stats;
+    double megabytes = static_cast<double>(vertex_size + index_size) / (1024.0 * 1024.0);
+    LOGI(TAG, "Loaded %s: %llu triangles, %zu vertices, %zu draws, %.1fMB of geometry", mesh.path,
+         static_cast<unsigned long long>(stats.triangles), scene.vertices.size(), mesh_draws.size(), megabytes);
+    LOGI(TAG, "Mesh load: parse %.2fms, decode %.2fms (%.1f Mtris/s), upload %.2fms (%.1f MB/s)",
+         stats.parse_ms, stats.decode_ms, static_cast<double>(stats.triangles) / 1000.0 / std::max(stats.decode_ms, 1e-3),
+         upload_ms, megabytes * 1000.0 / std::max(upload_ms, 1e-3));
+    geometry_arena_stats_t arena = geometry->get_stats();
+    LOGI(TAG, "Geometry arena: %u ranges (%u of %zu new ones 16-bit), vertices %.1f/%.1fMB, indices %.1f/%.1fMB, %u grows",
+         arena.ranges, narrow_primitives, scene_geometry.size(), static_cast<double>(arena.vertex_used) / (1024.0 * 1024.0),
+         static_cast<double>(arena.vertex_capacity) / (1024.0 * 1024.0), static_cast<double>(arena.index_used) / (1024.0 * 1024.0),
+         static_cast<double>(arena.index_capacity) / (1024.0 * 1024.0), arena.grows);
+    LOGI(TAG, "Vertex encode %.2fms: %.1fMB of %s vertices, %.1fMB as float", mesh.encode_ms,
+         static_cast<double>(vertex_size) / (1024.0 * 1024.0), vertex_format_name(vertex_format),
+         static_cast<double>(scene.vertices.size() * sizeof(mesh_vertex_t)) / (1024.0 * 1024.0));
+    vertex_cache_stats_t before{};
+    vertex_cache_stats_t after{};
+    uint32_t welded = 0;
+    for (size_t i = 0; i < mesh.report.size(); ++i) {
+        const mesh_optimize_report_t& entry = mesh.report[i];
+        before.transformed += entry.before.transformed;
+        before.triangles += entry.before.triangles;
+        before.vertices += entry.before.vertices;
+        after.transformed += entry.after.transformed;
+        after.vertices += entry.after.vertices;
+        welded += entry.welded;
+        if (i < MAX_LOGGED_MESHES) {
+            LOGD(TAG, "Mesh %zu: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u vertices welded", i, entry.before.acmr,
+                 entry.after.acmr, entry.before.atvr, entry.after.atvr, entry.welded);
+        }
+    }
+    if (before.triangles > 0) {
+        LOGI(TAG, "Mesh optimize %.2fms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u vertices welded", mesh.optimize_ms,
+             static_cast<float>(before.transformed) / before.triangles, static_cast<float>(after.transformed) / before.triangles,
+             static_cast<float>(before.transformed) / std::max(before.vertices, 1u),
+             static_cast<float>(after.transformed) / std::max(after.vertices, 1u), welded);
+    }
+}
 
-    /*Texture image view*/
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = tex;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-    if (vkCreateImageView(device, &viewInfo, nullptr, &tex_view) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create texture image view!");
+void VkRenderer::build_mesh_bvh() {
+    /*The GPU culls the indirect paths itself*/
+    if (draw_submission != draw_submission_t::DIRECT) return;
+    std::vector<glm::vec3> bounds_min(mesh_draws.size(), glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> bounds_max(mesh_draws.size(), glm::vec3(std::numeric_limits<float>::lowest()));
+    for (size_t i = 0; i < mesh_draws.size(); ++i) {
+        /*Box around the bounding sphere, its corners moved by world*/
+        const mesh_draw_t& mesh = mesh_draws[i];
+        glm::vec3 center(mesh.sphere);
+        for (int corner = 0; corner < 8; ++corner) {
+            glm::vec3 offset(corner & 1 ? mesh.sphere.w : -mesh.sphere.w, corner & 2 ? mesh.sphere.w : -mesh.sphere.w,
+                             corner & 4 ? mesh.sphere.w : -mesh.sphere.w);
+            glm::vec3 point = glm::vec3(mesh.world * glm::vec4(center + offset, 1.0f));
+            bounds_min[i] = glm::min(bounds_min[i], point);
+            bounds_max[i] = glm::max(bounds_max[i], point);
+        }
     }
+    mesh_bvh.build(bounds_min.data(), bounds_max.data(), static_cast<uint32_t>(mesh_draws.size()));
+    visible_meshes.resize(mesh_draws.size());
 }
 
 void VkRenderer::create_texture_sampler() {
@@ -476,87 +948,116 @@ void VkRenderer::create_texture_sampler() {
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = 0.0f;
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &tex_sampler) != VK_SUCCESS) {
+    if (vkCreateSampler(device, &samplerInfo, nullptr, tex_sampler.put(device)) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create texture sampler!");
     }
 }
 
 void VkRenderer::create_buffers() {
-    /*VAO*/
-    size_t buffer_size = std::max(sizeof(vertexes), sizeof(indices));
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, buffer_size, 0, &data);
-    memcpy(data, vertexes, sizeof(vertexes));
-    create_buffer(sizeof(vertexes),  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VBO, VBO_mem);
-    copy_buffer(stagingBuffer, VBO, sizeof(vertexes));
-
-    /*EBO*/
-    create_buffer(sizeof(indices), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, EBO, EBO_mem);
-    memcpy(data, indices, sizeof(indices));
-    vkUnmapMemory(device, stagingBufferMemory);
-    copy_buffer(stagingBuffer, EBO, sizeof(indices));
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-
-    /*UBOs*/
-    buffer_size = sizeof(UBO);
+    /*The quad is the first mesh of the arena*/
+    geometry = std::make_unique<VkGeometryArena>(resources, vertex_format_stride(vertex_format));
+    uint32_t vertex_count = sizeof(vertexes) / sizeof(vertexes[0]);
+    uint32_t index_count = sizeof(indices) / sizeof(indices[0]);
+    size_t vertex_size = vertex_count * vertex_format_stride(vertex_format);
+    buffer_handle_t stagingBuffer = create_staging_buffer(vertex_size + index_count * sizeof(uint32_t));
+    auto* data = static_cast<unsigned char*>(resources.get_mapped(stagingBuffer));
+
+    uint32_t wide_indices[sizeof(indices) / sizeof(indices[0])];
+    std::copy(std::begin(indices), std::end(indices), wide_indices);
+    vertex_quantization_t quantization = make_vertex_quantization(glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+    encode_vertices(vertex_format, vertexes, vertex_count, wide_indices, index_count, quantization, data);
+    VkCommandBuffer command_buffer;
+    begin_single_time_commands(command_buffer);
+    geometry_range_t quad = geometry->allocate(command_buffer, vertex_count, index_count, submitted_frames);
+    VkGeometryArena::write_indices(wide_indices, index_count, quad.index_type, data + vertex_size);
+    VkBufferCopy vertexRegion{0, geometry->get_vertex_offset(quad), vertex_size};
+    VkBufferCopy indexRegion{vertex_size, geometry->get_index_offset(quad), index_count * VkGeometryArena::index_size(quad.index_type)};
+    vkCmdCopyBuffer(command_buffer, resources.get_buffer(stagingBuffer), geometry->get_vertex_buffer(), 1, &vertexRegion);
+    vkCmdCopyBuffer(command_buffer, resources.get_buffer(stagingBuffer), geometry->get_index_buffer(), 1, &indexRegion);
+    end_single_time_commands(command_buffer);
+    resources.destroy(stagingBuffer);
+    scene_geometry.assign(1, quad);
+    glm::mat4 dequantize = dequantization_matrix(vertex_format, quantization);
+    mesh_draws.assign(1, {dequantize, glm::vec4(1.0f), quad.first_index, quad.index_count, quad.vertex_offset, quad.index_type, false,
+                          bounding_sphere(dequantize, glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f))});
+    build_mesh_bvh();
+
+    draw_list = std::make_unique<VkDrawList>(device, resources, MAX_FRAMES_IN_FLIGHT, draw_submission,
+                                             context->get_features().max_draw_indirect_count);
+
+    /*UBOs, persistently mapped*/
     UBOs.resize(MAX_FRAMES_IN_FLIGHT);
-    UBO_mems.resize(MAX_FRAMES_IN_FLIGHT);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        create_buffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, UBOs[i], UBO_mems[i]);
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        UBOs[i] = resources.create_buffer({sizeof(UBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT});
     }
 }
 
-void VkRenderer::create_descriptor_sets() {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptor_layout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptor_pool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
+buffer_handle_t VkRenderer::create_staging_buffer(VkDeviceSize size) {
+    return resources.create_buffer({size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT});
+}
 
-    descriptor_sets.resize(MAX_FRAMES_IN_FLIGHT);
-    if (vkAllocateDescriptorSets(device, &allocInfo, descriptor_sets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate descriptor sets!");
+VkDescriptorSet VkRenderer::update_frame_descriptors(VkCommandBuffer command_buffer) {
+    /*The draw list of this frame was built already, its buffer may have grown*/
+    descriptor_write_t writes[] = {
+            buffer_descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, resources.get_buffer(UBOs[cur_frame]), 0, sizeof(UBO)),
+            buffer_descriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, draw_list->get_draw_buffer(), 0, draw_list->get_draw_buffer_size())
+    };
+    if (descriptor_update == descriptor_update_t::WRITE) {
+        VkDescriptorSet set = frame_descriptors[cur_frame]->allocate(descriptor_layout);
+        write_descriptors(device, set, writes, 2);
+        return set;
     }
+    descriptor_data_t data[VkDescriptorTemplate::MAX_TEMPLATE_DESCRIPTORS];
+    frame_template->pack(writes, 2, data);
+    if (descriptor_update == descriptor_update_t::PUSH) {
+        frame_template->push(command_buffer, data);
+        return VK_NULL_HANDLE;
+    }
+    VkDescriptorSet set = frame_descriptors[cur_frame]->allocate(descriptor_layout);
+    frame_template->update(set, data);
+    return set;
+}
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = UBOs[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UBO);
-
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = tex_view;
-        imageInfo.sampler = tex_sampler;
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+void VkRenderer::benchmark_descriptor_updates() {
+    /*Pushes cannot be timed outside a command buffer; compare the two ways of writing a set*/
+    if (descriptor_update == descriptor_update_t::PUSH || !context->get_features().descriptor_update_template) return;
+    constexpr int UPDATES = 256;
+    std::vector<VkDescriptorSetLayoutBinding> bindings = shader_interface->get_set_layout_bindings(0);
+    VkDescriptorTemplate update_template(device, bindings, descriptor_layout);
+    VkDescriptorAllocator allocator(device, shader_interface->get_pool_sizes(0, 1), 1);
+    VkDescriptorSet set = allocator.allocate(descriptor_layout);
+    descriptor_write_t writes[] = {
+            buffer_descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, resources.get_buffer(UBOs[0]), 0, sizeof(UBO)),
+            buffer_descriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, draw_list->get_draw_buffer(), 0, draw_list->get_draw_buffer_size())
+    };
+    descriptor_data_t data[VkDescriptorTemplate::MAX_TEMPLATE_DESCRIPTORS];
 
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = descriptor_sets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < UPDATES; ++i) {
+        write_descriptors(device, set, writes, 2);
+    }
+    auto written = std::chrono::steady_clock::now();
+    for (int i = 0; i < UPDATES; ++i) {
+        update_template.pack(writes, 2, data);
+        update_template.update(set, data);
+    }
+    auto end = std::chrono::steady_clock::now();
+    LOGI(TAG, "Set 0 update: vkUpdateDescriptorSets %.3fus, template %.3fus",
+         std::chrono::duration<double, std::micro>(written - begin).count() / UPDATES,
+         std::chrono::duration<double, std::micro>(end - written).count() / UPDATES);
+}
 
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = descriptor_sets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+VkDescriptorSet VkRenderer::material_descriptor_set() {
+    if (bindless) {
+        return bindless->get_set();
     }
+    descriptor_write_t write = image_descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, resources.get_image_view(tex), tex_sampler,
+                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return material_descriptors->get(material_layout, &write, 1);
 }
 
 void VkRenderer::create_sync_objects() {
+    frame_values.assign(MAX_FRAMES_IN_FLIGHT, 0);
     image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
     render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
     in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
@@ -566,98 +1067,14 @@ void VkRenderer::create_sync_objects() {
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &image_available_semaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &render_finished_semaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &in_flight_fences[i]) != VK_SUCCESS) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, image_available_semaphores[i].put(device)) != VK_SUCCESS ||
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, render_finished_semaphores[i].put(device)) != VK_SUCCESS ||
+            vkCreateFence(device, &fenceInfo, nullptr, in_flight_fences[i].put(device)) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create semaphores!");
         }
     }
 }
 
-VkShaderModule VkRenderer::create_shader_mode(const u_int8_t *bytes, size_t size_in_bytes) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = size_in_bytes;
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(bytes);
-    VkShaderModule module;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &module) != VK_SUCCESS) {
-        throw std::runtime_error("Unable to create vkShaderModule!");
-    }
-    return module;
-}
-
-void VkRenderer::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer &buffer,
-                               VkDeviceMemory &mem) {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create vertex buffer!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = find_mem_type(memRequirements.memoryTypeBits, props);
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &mem) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate vertex buffer memory!");
-    }
-    vkBindBufferMemory(device, buffer, mem, 0);
-}
-
-uint32_t VkRenderer::find_mem_type(uint32_t filter_type, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(phy_device, &memProperties);
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if (filter_type & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type!");
-}
-
-void VkRenderer::create_image(uint32_t w, uint32_t h, VkFormat fmt, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags props, VkImage& img, VkDeviceMemory& img_mem) {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = w;
-    imageInfo.extent.height = h;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = fmt;
-    imageInfo.tiling = tiling;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = usageFlags;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.flags = 0; // Optional
-
-    if (vkCreateImage(device, &imageInfo, nullptr, &img) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create image!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, img, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = find_mem_type(memRequirements.memoryTypeBits, props);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &img_mem) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(device, img, img_mem, 0);
-}
-
 void VkRenderer::transition_layout(VkImage img, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout) {
     VkCommandBuffer command_buffer;
     begin_single_time_commands(command_buffer);
@@ -736,15 +1153,65 @@ void VkRenderer::on_begin() {
     cur_frame = 0;
 }
 
-void VkRenderer::on_draw() {
+void VkRenderer::on_update(frame_packet_t &packet, uint32_t flags, uint64_t frame) {
+    auto begin = std::chrono::steady_clock::now();
+    packet.frame = frame;
+    packet.dirty = flags;
+    packet.time = std::chrono::duration<float>(begin - start_time).count();
+    packet.commands.clear();
+    render_command_t command;
+    while (commands.pop(command)) {
+        apply_command(packet, command);
+    }
+    packet.draws.clear();
+    packet.draws.push_back({{model_transform, material_tint, material_index}, material_permutation, material_raster});
+    packet.view_proj = view_proj;
+    packet.uniforms.view_proj = view_proj;
+    packet.update_time = std::chrono::steady_clock::now() - begin;
+}
+
+void VkRenderer::on_draw(const frame_packet_t& packet) {
     uint32_t idx;
-    vkWaitForFences(device, 1, &in_flight_fences[cur_frame], VK_TRUE, UINT64_MAX);
-    vkResetFences(device, 1, &in_flight_fences[cur_frame]);
-    vkAcquireNextImageKHR(device, swap_chain, UINT64_MAX, image_available_semaphores[cur_frame], VK_NULL_HANDLE, &idx);
+    auto begin = std::chrono::steady_clock::now();
+    update_time += packet.update_time;
+    for (const render_command_t& command: packet.commands) {
+        execute_command(command);
+    }
+    poll_decoded_image();
+    poll_loaded_mesh();
+    if (swap_chain_dirty) {
+        recreate_swap_chain();
+    }
+    vkWaitForFences(device, 1, in_flight_fences[cur_frame].ptr(), VK_TRUE, UINT64_MAX);
+    deletion_queue.collect(frame_values[cur_frame]);
+    geometry->collect(frame_values[cur_frame]);
+    cull_stats_t cull_stats{};
+    if (culling && culling->collect(cur_frame, cull_stats)) {
+        culled_draws += cull_stats.draws;
+        frustum_culled += cull_stats.frustum_culled;
+        occlusion_culled += cull_stats.occlusion_culled;
+    }
+    if (!frame_descriptors.empty()) {
+        frame_descriptors[cur_frame]->reset();
+    }
+    if (bindless) {
+        bindless->collect(frame_values[cur_frame]);
+    } else {
+        material_descriptors->collect(frame_values[cur_frame]);
+    }
+    VkResult result = vkAcquireNextImageKHR(device, swap_chain, UINT64_MAX, image_available_semaphores[cur_frame], VK_NULL_HANDLE, &idx);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        swap_chain_dirty = true;
+        scheduler.mark_dirty(DIRTY_SURFACE);
+        return;
+    }
+    vkResetFences(device, 1, in_flight_fences[cur_frame].ptr());
     vkResetCommandBuffer(command_buffers[cur_frame], 0);
 
-    update_uniform_buffer();
-    record_command_buffer(command_buffers[cur_frame], idx);
+    update_uniform_buffer(packet.uniforms);
+    auto record_begin = std::chrono::steady_clock::now();
+    record_command_buffer(command_buffers[cur_frame], idx, packet);
+    record_time += std::chrono::steady_clock::now() - record_begin;
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -762,6 +1229,7 @@ void VkRenderer::on_draw() {
     if (vkQueueSubmit(graphics_queue_info.queue, 1, &submitInfo, in_flight_fences[cur_frame]) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit command buffer!");
     }
+    frame_values[cur_frame] = ++submitted_frames;
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -774,8 +1242,147 @@ void VkRenderer::on_draw() {
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &idx;
     presentInfo.pResults = nullptr; // Optional
-    vkQueuePresentKHR(present_queue_info.queue, &presentInfo);
+    result = vkQueuePresentKHR(present_queue_info.queue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        swap_chain_dirty = true;
+        scheduler.mark_dirty(DIRTY_SURFACE);
+    }
     cur_frame = (cur_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    draw_time += std::chrono::steady_clock::now() - begin;
+    if (++timed_frames == 300) {
+        permutation_stats_t stats = permutations->get_stats();
+        LOGD(TAG, "Average CPU time per frame: update %.3fms, draw %.3fms (record %.3fms)",
+             std::chrono::duration<double, std::milli>(update_time).count() / timed_frames,
+             std::chrono::duration<double, std::milli>(draw_time).count() / timed_frames,
+             std::chrono::duration<double, std::milli>(record_time).count() / timed_frames);
+        LOGD(TAG, "Per frame: %.1f draws in %.1f batches, %.1f draw calls (%s), %.1f pipeline binds, %.1f dynamic state sets",
+             static_cast<double>(draws) / timed_frames, static_cast<double>(draw_batches) / timed_frames,
+             static_cast<double>(draw_calls) / timed_frames, draw_submission_name(draw_submission),
+             static_cast<double>(pipeline_binds) / timed_frames, static_cast<double>(dynamic_state_sets) / timed_frames);
+        LOGD(TAG, "%u pipeline permutations, %u compiling (%llu hits, %llu misses, %llu shared, %llu fallbacks)",
+             stats.pipelines, stats.pending, static_cast<unsigned long long>(stats.hits),
+             static_cast<unsigned long long>(stats.misses), static_cast<unsigned long long>(stats.shared),
+             static_cast<unsigned long long>(stats.fallbacks));
+        if (culled_draws > 0) {
+            LOGD(TAG, "GPU culling: %.1f%% of draws outside the frustum, %.1f%% occluded",
+                 100.0 * static_cast<double>(frustum_culled) / static_cast<double>(culled_draws),
+                 100.0 * static_cast<double>(occlusion_culled) / static_cast<double>(culled_draws));
+        }
+        if (cpu_tested_draws > 0) {
+            LOGD(TAG, "CPU culling: %.1f%% of draws outside the frustum",
+                 100.0 * static_cast<double>(cpu_culled_draws) / static_cast<double>(cpu_tested_draws));
+        }
+        uint64_t allocations = 0;
+        uint32_t pools = 0;
+        for (const auto& allocator: frame_descriptors) {
+            descriptor_allocator_stats_t frame_stats = allocator->get_stats();
+            allocations += frame_stats.allocations;
+            pools += frame_stats.pools;
+        }
+        descriptor_cache_stats_t cache_stats{};
+        if (material_descriptors) {
+            cache_stats = material_descriptors->get_stats();
+            descriptor_allocator_stats_t material_stats = material_descriptors->get_allocator_stats();
+            allocations += material_stats.allocations;
+            pools += material_stats.pools;
+        }
+        LOGD(TAG, "Per frame: %.3fus %s, %.1f descriptor set allocations; %u descriptor pools, %u cached sets (%llu hits, %llu misses)",
+             std::chrono::duration<double, std::micro>(descriptor_time).count() / timed_frames, descriptor_update_name(descriptor_update),
+             static_cast<double>(allocations - logged_descriptor_allocations) / timed_frames, pools, cache_stats.sets,
+             static_cast<unsigned long long>(cache_stats.hits), static_cast<unsigned long long>(cache_stats.misses));
+        logged_descriptor_allocations = allocations;
+        update_time = draw_time = record_time = descriptor_time = {};
+        pipeline_binds = dynamic_state_sets = draw_calls = draw_batches = draws = 0;
+        culled_draws = frustum_culled = occlusion_culled = 0;
+        cpu_tested_draws = cpu_culled_draws = 0;
+        timed_frames = 0;
+    }
+}
+
+void VkRenderer::apply_command(frame_packet_t &packet, const render_command_t &command) {
+    switch (command.type) {
+        case render_command_type_t::SET_RENDER_MODE:
+            scheduler.set_mode(command.mode);
+            break;
+        case render_command_type_t::SET_TRANSFORM:
+            memcpy(&model_transform, command.transform, sizeof(model_transform));
+            break;
+        case render_command_type_t::SET_CAMERA:
+            memcpy(&view_proj, command.view_proj, sizeof(view_proj));
+            break;
+        case render_command_type_t::SET_PERMUTATION:
+            material_permutation = command.permutation;
+            break;
+        case render_command_type_t::SET_RASTER_STATE:
+            material_raster = command.raster;
+            break;
+        case render_command_type_t::SET_MATERIAL:
+            memcpy(&material_tint, command.material.tint, sizeof(material_tint));
+            material_index = command.material.index;
+            break;
+        default:
+            /*Surface and resource commands touch Vulkan objects owned by the render thread*/
+            packet.commands.push_back(command);
+            break;
+    }
+}
+
+void VkRenderer::execute_command(const render_command_t &command) {
+    switch (command.type) {
+        case render_command_type_t::SURFACE_CHANGED:
+            LOGD(TAG, "Surface changed %ux%u", command.surface.width, command.surface.height);
+            swap_chain_dirty = true;
+            break;
+        case render_command_type_t::LOAD_TEXTURE:
+            decode_image_async(command.path);
+            break;
+        case render_command_type_t::LOAD_MESH:
+            load_mesh_async(command.path);
+            break;
+        default:
+            break;
+    }
+}
+
+void VkRenderer::recreate_swap_chain() {
+    swap_chain_dirty = false;
+    /*Views and framebuffers of the old swapchain go before it does*/
+    vkDeviceWaitIdle(device);
+    destroy_swap_chain_resources();
+    context->recreate_swap_chain();
+    format = context->get_swap_chain_format();
+    swap_chain_extent = static_cast<uint64_t>(format.extent.width) << 32 | format.extent.height;
+    uint32_t old_surface_permutation = surface_permutation;
+    surface_permutation = surface_permutation_of(format.image_format.format);
+    if (surface_permutation != old_surface_permutation) {
+        permutations->set_fallback(PERMUTATION_NONE | surface_permutation, make_raster_state());
+    }
+    swap_chain = context->get_swap_chain();
+    create_swap_chain_views();
+    create_depth_buffer();
+    if (culling) {
+        culling->resize(resources.get_image_view(depth_image), format.extent);
+    }
+    if (backend == render_backend_t::RENDER_PASS) {
+        create_framebuffers();
+    }
+}
+
+void VkRenderer::destroy_swap_chain_resources() {
+    for (VkFramebuffer framebuffer: framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (VkImageView view: image_views) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    framebuffers.clear();
+    image_views.clear();
+    swap_chain_images.clear();
+    /*The device is idle whenever the swapchain goes away*/
+    if (depth_image.valid()) {
+        resources.destroy(depth_image);
+        depth_image = {};
+    }
 }
 
 void VkRenderer::on_end() {
@@ -812,25 +1419,138 @@ void VkRenderer::copy_image_buffer(VkBuffer buffer, VkImage image, uint32_t widt
     end_single_time_commands(command_buffer);
 }
 
-void VkRenderer::copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
-    VkCommandBuffer command_buffer;
-    begin_single_time_commands(command_buffer);
-    VkBufferCopy copyRegion{};
-    copyRegion.size = size;
-    vkCmdCopyBuffer(command_buffer, src, dst, 1, &copyRegion);
-    end_single_time_commands(command_buffer);
+void VkRenderer::update_uniform_buffer(const UBO& ubo) {
+    memcpy(resources.get_mapped(UBOs[cur_frame]), &ubo, sizeof(UBO));
 }
 
-void VkRenderer::update_uniform_buffer() {
-    UBO ubo{};
-    ubo.model = glm::mat4(1.0);
-    void* data;
-    vkMapMemory(device, UBO_mems[cur_frame], 0, sizeof(UBO), 0, &data);
-    memcpy(data, &ubo, sizeof(UBO));
-    vkUnmapMemory(device, UBO_mems[cur_frame]);
+void VkRenderer::begin_rendering(VkCommandBuffer command_buffer, u_int32_t index) {
+    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+    VkClearValue clearDepth{};
+    clearDepth.depthStencil = {1.0f, 0};
+    if (backend == render_backend_t::RENDER_PASS) {
+        VkClearValue clearValues[] = {clearColor, clearDepth};
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = render_pass;
+        renderPassInfo.framebuffer = framebuffers[index];
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = format.extent;
+        renderPassInfo.clearValueCount = 2;
+        renderPassInfo.pClearValues = clearValues;
+        vkCmdBeginRenderPass(command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
+    /*Same transition the render pass does through its initial layout and external dependency*/
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = swap_chain_images[index];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    /*The previous frame's depth tests have to finish before the clear, contents are discarded*/
+    VkImageMemoryBarrier depthBarrier{};
+    depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    depthBarrier.image = resources.get_image(depth_image);
+    depthBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    depthBarrier.subresourceRange.levelCount = 1;
+    depthBarrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+    VkRenderingAttachmentInfo colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = image_views[index];
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearColor;
+
+    VkRenderingAttachmentInfo depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = resources.get_image_view(depth_image);
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = occlusion_culling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = clearDepth;
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = format.extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+    context->get_functions().begin_rendering(command_buffer, &renderingInfo);
 }
 
-void VkRenderer::record_command_buffer(VkCommandBuffer command_buffer, u_int32_t index) {
+void VkRenderer::end_rendering(VkCommandBuffer command_buffer, u_int32_t index) {
+    if (backend == render_backend_t::RENDER_PASS) {
+        vkCmdEndRenderPass(command_buffer);
+        return;
+    }
+    context->get_functions().end_rendering(command_buffer);
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = swap_chain_images[index];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint32_t VkRenderer::set_raster_state(VkCommandBuffer command_buffer, const raster_state_t &next, const raster_state_t *current) {
+    const device_functions_t& functions = context->get_functions();
+    uint32_t sets = 0;
+    if (!current || current->cull_mode != next.cull_mode) {
+        functions.set_cull_mode(command_buffer, next.cull_mode);
+        ++sets;
+    }
+    if (!current || current->front_face != next.front_face) {
+        functions.set_front_face(command_buffer, static_cast<VkFrontFace>(next.front_face));
+        ++sets;
+    }
+    if (!current || current->topology != next.topology) {
+        functions.set_primitive_topology(command_buffer, static_cast<VkPrimitiveTopology>(next.topology));
+        ++sets;
+    }
+    if (!current || current->depth_test != next.depth_test) {
+        functions.set_depth_test_enable(command_buffer, next.depth_test);
+        ++sets;
+    }
+    if (!current || current->depth_write != next.depth_write) {
+        functions.set_depth_write_enable(command_buffer, next.depth_write);
+        ++sets;
+    }
+    if (!current || current->depth_compare != next.depth_compare) {
+        functions.set_depth_compare_op(command_buffer, static_cast<VkCompareOp>(next.depth_compare));
+        ++sets;
+    }
+    return sets;
+}
+
+void VkRenderer::record_command_buffer(VkCommandBuffer command_buffer, u_int32_t index, const frame_packet_t& packet) {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0; // Optional
@@ -840,18 +1560,6 @@ void VkRenderer::record_command_buffer(VkCommandBuffer command_buffer, u_int32_t
         throw std::runtime_error("Unable to submit VkCommandBuffer!");
     }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = render_pass;
-    renderPassInfo.framebuffer = framebuffers[index];
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = format.extent;
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
-    vkCmdBeginRenderPass(command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -866,13 +1574,91 @@ void VkRenderer::record_command_buffer(VkCommandBuffer command_buffer, u_int32_t
     scissor.extent = format.extent;
     vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    VkBuffer vertexBuffers[] = {VBO};
+    /*Built before set 0 is written, the draw buffer may grow*/
+    draw_list->begin(cur_frame, static_cast<uint32_t>(packet.draws.size() * mesh_draws.size()));
+    for (const draw_item_t& draw: packet.draws) {
+        /*Falls back to an already compiled variant while one is compiling; double-sided meshes disable culling*/
+        raster_state_t rasters[2] = {draw.raster, draw.raster};
+        rasters[1].cull_mode = VK_CULL_MODE_NONE;
+        /*The double-sided variant is only looked up, and compiled, when a mesh needs it*/
+        VkPipeline pipelines[2] = {permutations->get(draw.permutation | surface_permutation, rasters[0]), VK_NULL_HANDLE};
+        draw_data_t data{};
+        /*Unknown materials use the first texture*/
+        data.material = bindless ? material_textures[draw.constants.material < material_textures.size() ? draw.constants.material : 0]
+                                 : draw.constants.material;
+        /*Every draw item places the whole scene; without GPU culling the tree drops what is outside its frustum*/
+        uint32_t visible = static_cast<uint32_t>(mesh_draws.size());
+        if (!culling) {
+            glm::vec4 planes[6];
+            extract_frustum_planes(packet.view_proj * draw.constants.model, planes);
+            visible = mesh_bvh.cull(planes, visible_meshes.data());
+            /*Back in mesh_draws order, which is sorted by state*/
+            std::sort(visible_meshes.begin(), visible_meshes.begin() + visible);
+            cpu_tested_draws += mesh_draws.size();
+            cpu_culled_draws += mesh_draws.size() - visible;
+        }
+        for (uint32_t i = 0; i < visible; ++i) {
+            const mesh_draw_t& mesh = mesh_draws[culling ? i : visible_meshes[i]];
+            if (mesh.double_sided && pipelines[1] == VK_NULL_HANDLE) {
+                pipelines[1] = permutations->get(draw.permutation | surface_permutation, rasters[1]);
+            }
+            data.model = draw.constants.model * mesh.world;
+            data.tint = draw.constants.tint * mesh.base_color;
+            data.sphere = mesh.sphere;
+            draw_list->add(pipelines[mesh.double_sided], rasters[mesh.double_sided], mesh.index_type, mesh.index_count, mesh.first_index,
+                           mesh.vertex_offset, data);
+        }
+    }
+    draw_list->end();
+    /*Compute work has to come before the frame's rendering starts*/
+    if (culling) {
+        culling->cull(command_buffer, cur_frame, *draw_list, packet.view_proj);
+    }
+    begin_rendering(command_buffer, index);
+
+    VkBuffer vertexBuffers[] = {geometry->get_vertex_buffer()};
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(command_buffer, EBO, 0, VK_INDEX_TYPE_UINT16);
-    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_sets[cur_frame], 0, nullptr);
-    vkCmdDrawIndexed(command_buffer, 6, 1, 0, 0, 0);
-    vkCmdEndRenderPass(command_buffer);
+    /*Per-frame data and the textures; with bindless this is all binding a frame needs however many materials are drawn*/
+    auto descriptor_begin = std::chrono::steady_clock::now();
+    VkDescriptorSet sets[] = {update_frame_descriptors(command_buffer), material_descriptor_set()};
+    descriptor_time += std::chrono::steady_clock::now() - descriptor_begin;
+    if (sets[0] == VK_NULL_HANDLE) {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, &sets[1], 0, nullptr);
+    } else {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 2, sets, 0, nullptr);
+    }
+    bool dynamic_raster = context->get_features().extended_dynamic_state;
+    VkPipeline bound = VK_NULL_HANDLE;
+    raster_state_t current_raster{};
+    const raster_state_t* raster = nullptr;
+    VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+    /*State changes once per batch, the draws themselves are read by the GPU*/
+    draw_list->record(command_buffer, [&](const draw_batch_t& batch) {
+        if (batch.pipeline != bound) {
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.pipeline);
+            bound = batch.pipeline;
+            ++pipeline_binds;
+        }
+        if (dynamic_raster) {
+            dynamic_state_sets += set_raster_state(command_buffer, batch.raster, raster);
+            current_raster = batch.raster;
+            raster = &current_raster;
+        }
+        /*Same buffer for both index sizes, first_index counts in the mesh's own*/
+        if (batch.index_type != bound_index_type) {
+            vkCmdBindIndexBuffer(command_buffer, geometry->get_index_buffer(), 0, batch.index_type);
+            bound_index_type = batch.index_type;
+        }
+    }, culling ? culling->get_visible_buffer(cur_frame) : VK_NULL_HANDLE, culling ? culling->get_count_buffer(cur_frame) : VK_NULL_HANDLE);
+    draw_list_stats_t list_stats = draw_list->get_stats();
+    draws += list_stats.draws;
+    draw_batches += list_stats.batches;
+    draw_calls += list_stats.calls;
+    end_rendering(command_buffer, index);
+    if (culling) {
+        culling->finish(command_buffer, cur_frame, resources.get_image(depth_image));
+    }
     if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
         throw std::runtime_error("Failed to record command buffer!");
     }
@@ -880,12 +1666,12 @@ void VkRenderer::record_command_buffer(VkCommandBuffer command_buffer, u_int32_t
 
 void VkRenderer::create_swap_chain_views() {
     uint32_t count = 0;
-    std::vector<VkImage> images;
+    std::vector<VkImage>& images = swap_chain_images;
     vkGetSwapchainImagesKHR(device, swap_chain, &count, nullptr);
     images.resize(count);
     image_views.resize(count);
     vkGetSwapchainImagesKHR(device, swap_chain, &count, images.data());
-    for(int i = 0; i < images.size(); ++i) {
+    for (size_t i = 0; i < images.size(); ++i) {
         const VkImage& image = images[i];
         VkImageViewCreateInfo imageViewCreateInfo{};
         imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -906,3 +1692,42 @@ void VkRenderer::create_swap_chain_views() {
         }
     }
 }
+
+VkFormat VkRenderer::find_depth_format() {
+    /*No stencil is needed; D16 is always supported as an attachment*/
+    VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM};
+    for (VkFormat candidate: candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(phy_device, candidate, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return candidate;
+        }
+    }
+    throw std::runtime_error("No supported depth format!");
+}
+
+vertex_format_t VkRenderer::find_vertex_format() {
+    /*Every attribute format of the packed layout must be readable by vertex fetch*/
+    std::vector<VkVertexInputAttributeDescription> layout;
+    get_vertex_layout(vertex_format_t::PACKED, layout);
+    for (const VkVertexInputAttributeDescription& attribute: layout) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(phy_device, attribute.format, &properties);
+        if (!(properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)) {
+            LOGW(TAG, "Vertex format %d is not supported, falling back to float vertices", attribute.format);
+            return vertex_format_t::FLOAT;
+        }
+    }
+    return vertex_format_t::PACKED;
+}
+
+void VkRenderer::create_depth_buffer() {
+    image_desc_t desc{};
+    desc.width = format.extent.width;
+    desc.height = format.extent.height;
+    desc.format = depth_format;
+    desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (occlusion_culling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+    desc.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    depth_image = resources.create_image(desc);
+}
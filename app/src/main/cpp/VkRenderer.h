@@ -9,6 +9,78 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "VkContext.h"
+#include "RenderScheduler.h"
+#include "RenderCommandQueue.h"
+#include "JobSystem.h"
+#include "FramePacket.h"
+#include "VkDeletionQueue.h"
+#include "VkResourceRegistry.h"
+#include "VkUnique.h"
+#include "SpirvReflection.h"
+#include "VkShaderLibrary.h"
+#include "VkPermutationCache.h"
+#include "VkBindlessTable.h"
+#include "VkDescriptorAllocator.h"
+#include "VkDescriptorTemplate.h"
+#include "GltfLoader.h"
+#include "MeshOptimizer.h"
+#include "VertexFormat.h"
+#include "VkGeometryArena.h"
+#include "VkDrawList.h"
+#include "VkGpuCulling.h"
+#include "BoundingVolumeHierarchy.h"
+
+struct decoded_image_t {
+    unsigned char* pixels;
+    int width;
+    int height;
+    char path[256];
+};
+
+struct loaded_mesh_t {
+    mesh_scene_t scene;
+    gltf_load_stats_t stats;
+    /*Vertex cache metrics of every mesh before and after optimization*/
+    std::vector<mesh_optimize_report_t> report;
+    double optimize_ms;
+    /*scene.vertices converted to the renderer's vertex format*/
+    std::vector<uint8_t> vertex_data;
+    double encode_ms;
+    bool valid;
+    char path[256];
+};
+
+/*One primitive of the uploaded scene placed by its node*/
+struct mesh_draw_t {
+    glm::mat4 world;
+    glm::vec4 base_color;
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+    VkIndexType index_type;
+    bool double_sided;
+    /*Bounding sphere in the space world maps from: center, radius*/
+    glm::vec4 sphere;
+};
+
+enum class render_backend_t {
+    /*Dynamic rendering when the device supports it*/
+    AUTO,
+    RENDER_PASS,
+    DYNAMIC_RENDERING
+};
+
+/*How the per-frame set 0 is written, selectable to compare the costs*/
+enum class descriptor_update_t {
+    /*Push descriptors when the device supports them, templates otherwise*/
+    AUTO,
+    /*vkUpdateDescriptorSets into a transient set*/
+    WRITE,
+    /*vkUpdateDescriptorSetWithTemplate into a transient set*/
+    TEMPLATE,
+    /*vkCmdPushDescriptorSetWithTemplateKHR, no set at all*/
+    PUSH
+};
 
 enum renderer_state_t {
     INVALID,
@@ -23,69 +95,181 @@ private:
     std::unique_ptr<VkContext> context;
     ANativeWindow* window;
     std::thread vk_thread;
+    std::thread update_thread;
     std::atomic<bool> vk_thread_running = false;
+    std::atomic<bool> update_thread_running = false;
     std::atomic<renderer_state_t> state = renderer_state_t::INVALID;
+    RenderScheduler scheduler;
+    RenderCommandQueue commands;
+    FramePacketBuffer packets;
+    JobSystem jobs;
+    decoded_image_t decoded_image{};
+    job_t* image_job = nullptr;
+    loaded_mesh_t loaded_mesh{};
+    job_t* mesh_job = nullptr;
     VkDevice device;
     VkPhysicalDevice phy_device;
     swap_chain_format_t format;
-    VkRenderPass render_pass;
-    VkDescriptorSetLayout descriptor_layout;
-    VkDescriptorPool descriptor_pool;
-    std::vector<VkDescriptorSet> descriptor_sets;
-    VkPipelineLayout pipeline_layout;
-    VkPipeline pipeline;
-    VkCommandPool command_pool;
-    VkImage tex;
-    VkImageView tex_view;
-    VkDeviceMemory tex_mem;
-    VkSampler tex_sampler;
+    render_backend_t backend;
+    descriptor_update_t descriptor_update;
+    VkDeletionQueue deletion_queue;
+    VkResourceRegistry resources;
+    VkUniqueRenderPass render_pass;
+    std::unique_ptr<VkShaderLibrary> shaders;
+    std::unique_ptr<ShaderInterface> shader_interface;
+    VkUniqueDescriptorSetLayout descriptor_layout;
+    /*Set 1 when textures are not bindless*/
+    VkUniqueDescriptorSetLayout material_layout;
+    /*Set 0 of each frame slot, recycled once the slot's fence was waited*/
+    std::vector<std::unique_ptr<VkDescriptorAllocator>> frame_descriptors;
+    /*Generated from the set 0 bindings, null with WRITE*/
+    std::unique_ptr<VkDescriptorTemplate> frame_template;
+    std::unique_ptr<VkDescriptorSetCache> material_descriptors;
+    /*Set 1 of the pipeline layout when the device supports descriptor indexing*/
+    std::unique_ptr<VkBindlessTable> bindless;
+    /*Bindless slot of each material's texture, indexed by draw_constants_t::material*/
+    std::vector<uint32_t> material_textures;
+    const char* fragment_shader = "simple.frag";
+    /*Fixed at construction, mesh load jobs encode for it*/
+    vertex_format_t vertex_format = vertex_format_t::FLOAT;
+    const char* vertex_shader = "simple.vert";
+    VkUniquePipelineLayout pipeline_layout;
+    VkUniquePipelineCache pipeline_cache;
+    std::unique_ptr<VkPipelineCompiler> compiler;
+    VkPipelineTable pipeline_table;
+    std::unique_ptr<VkPermutationCache> permutations;
+    /*Bits that depend on the surface rather than the material*/
+    uint32_t surface_permutation = PERMUTATION_NONE;
+    VkUniqueCommandPool command_pool;
+    image_handle_t tex;
+    VkUniqueSampler tex_sampler;
     VkSwapchainKHR swap_chain;
     queue_info_t graphics_queue_info;
     queue_info_t present_queue_info;
-    VkBuffer VBO, EBO;
-    VkDeviceMemory VBO_mem, EBO_mem;
-    std::vector<VkBuffer> UBOs;
-    std::vector<VkDeviceMemory> UBO_mems;
+    /*Vertices and indices of everything drawn*/
+    std::unique_ptr<VkGeometryArena> geometry;
+    /*Arena ranges of the current scene, freed when it is replaced*/
+    std::vector<geometry_range_t> scene_geometry;
+    /*Every primitive drawn for each draw item sorted by state, the built-in quad until a scene is loaded*/
+    std::vector<mesh_draw_t> mesh_draws;
+    /*Boxes of mesh_draws in the space their world maps to, frustum culled on the CPU with DIRECT*/
+    BoundingVolumeHierarchy mesh_bvh;
+    /*mesh_draws indices drawn for the current draw item*/
+    std::vector<uint32_t> visible_meshes;
+    draw_submission_t draw_submission = draw_submission_t::DIRECT;
+    /*Indirect commands and per-draw data of each frame slot*/
+    std::unique_ptr<VkDrawList> draw_list;
+    /*Frustum and occlusion culling of the draw list, none with DIRECT*/
+    std::unique_ptr<VkGpuCulling> culling;
+    /*The depth buffer is sampled and stored for the culling's depth pyramid*/
+    bool occlusion_culling = false;
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+    /*Shared by all frames in flight, cleared at the start of each*/
+    image_handle_t depth_image;
+    std::vector<buffer_handle_t> UBOs;
+    std::vector<VkImage> swap_chain_images;
     std::vector<VkImageView> image_views;
     std::vector<VkFramebuffer> framebuffers;
     std::vector<VkCommandBuffer> command_buffers;
-    std::vector<VkSemaphore> image_available_semaphores;
-    std::vector<VkSemaphore> render_finished_semaphores;
-    std::vector<VkFence> in_flight_fences;
+    std::vector<VkUniqueSemaphore> image_available_semaphores;
+    std::vector<VkUniqueSemaphore> render_finished_semaphores;
+    std::vector<VkUniqueFence> in_flight_fences;
+    /*Submission value of the last frame recorded into each slot*/
+    std::vector<uint64_t> frame_values;
+    uint64_t submitted_frames = 0;
     uint32_t cur_frame = 0;
+    bool swap_chain_dirty = false;
+    /*format.extent for the UI thread, width in the high half*/
+    std::atomic<uint64_t> swap_chain_extent = 0;
+    /*Scene state, owned by the update thread*/
+    glm::mat4 model_transform = glm::mat4(1.0f);
+    glm::mat4 view_proj = glm::mat4(1.0f);
+    uint32_t material_permutation = PERMUTATION_TEXTURE;
+    raster_state_t material_raster = make_raster_state();
+    glm::vec4 material_tint = glm::vec4(1.0f);
+    uint32_t material_index = 0;
+    std::chrono::steady_clock::time_point start_time;
+    /*Stats below are owned by the render thread*/
+    std::chrono::steady_clock::duration update_time{};
+    std::chrono::steady_clock::duration draw_time{};
+    std::chrono::steady_clock::duration record_time{};
+    /*Writing (or pushing) set 0, part of record_time*/
+    std::chrono::steady_clock::duration descriptor_time{};
+    /*Per-draw state changes recorded since the last stats log*/
+    uint64_t pipeline_binds = 0;
+    uint64_t dynamic_state_sets = 0;
+    uint64_t draw_calls = 0;
+    uint64_t draw_batches = 0;
+    uint64_t draws = 0;
+    /*Culling results read back since the last stats log*/
+    uint64_t culled_draws = 0;
+    uint64_t frustum_culled = 0;
+    uint64_t occlusion_culled = 0;
+    /*Meshes the CPU tested against the frustum with DIRECT, and how many it skipped*/
+    uint64_t cpu_tested_draws = 0;
+    uint64_t cpu_culled_draws = 0;
+    /*Descriptor set allocations already reported*/
+    uint64_t logged_descriptor_allocations = 0;
+    uint32_t timed_frames = 0;
     void create_swap_chain_views();
+    VkFormat find_depth_format();
+    vertex_format_t find_vertex_format();
+    void create_depth_buffer();
     void create_render_pass();
     void create_layout_descriptor();
-    void create_descriptor_pool();
-    void create_descriptor_sets();
+    void create_descriptor_allocators();
+    /*Null when set 0 was pushed into the command buffer*/
+    VkDescriptorSet update_frame_descriptors(VkCommandBuffer);
+    void benchmark_descriptor_updates();
+    VkDescriptorSet material_descriptor_set();
     void create_graphics_pipeline();
+    VkPipeline build_pipeline(const pipeline_state_t&);
     void create_framebuffers();
     void create_command_pool();
     void create_command_buffers();
     void create_texture();
+    void decode_image_async(const char* /*path*/);
+    void poll_decoded_image();
+    image_handle_t upload_texture(decoded_image_t&);
+    void load_mesh_async(const char* /*path*/);
+    void poll_loaded_mesh();
+    void upload_mesh(const loaded_mesh_t&);
+    void build_mesh_bvh();
     void create_texture_sampler();
     void create_buffers();
     void create_sync_objects();
-    void create_buffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, VkBuffer&, VkDeviceMemory&);
-    void copy_buffer(VkBuffer /*src*/, VkBuffer /*dst*/, VkDeviceSize /*size*/);
+    buffer_handle_t create_staging_buffer(VkDeviceSize);
     void copy_image_buffer(VkBuffer /*buffer*/, VkImage /*image*/, uint32_t /*width*/, uint32_t /*height*/);
-    uint32_t find_mem_type(uint32_t filter, VkMemoryPropertyFlags properties);
-    VkShaderModule create_shader_mode(const u_int8_t* bytes, size_t size_in_bytes);
-    void create_image(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkImage&, VkDeviceMemory&);
     void transition_layout(VkImage, VkFormat, VkImageLayout /*old_layout*/, VkImageLayout /*new_layout*/);
     void begin_single_time_commands(VkCommandBuffer&);
     void end_single_time_commands(VkCommandBuffer);
-    void update_uniform_buffer();
-    void record_command_buffer(VkCommandBuffer /*buffer*/, u_int32_t /*image index*/);
+    void recreate_swap_chain();
+    void destroy_swap_chain_resources();
+    void apply_command(frame_packet_t&, const render_command_t&);
+    void execute_command(const render_command_t&);
+    void update_uniform_buffer(const UBO&);
+    void begin_rendering(VkCommandBuffer, u_int32_t /*image index*/);
+    void end_rendering(VkCommandBuffer, u_int32_t /*image index*/);
+    uint32_t set_raster_state(VkCommandBuffer, const raster_state_t& /*next*/, const raster_state_t* /*current, null if unknown*/);
+    void record_command_buffer(VkCommandBuffer /*buffer*/, u_int32_t /*image index*/, const frame_packet_t&);
     void on_begin();
-    void on_draw();
+    void on_update(frame_packet_t&, uint32_t /*dirty flags*/, uint64_t /*frame*/);
+    void on_draw(const frame_packet_t&);
     void on_end();
 public:
-    explicit VkRenderer(JNIEnv *env, jobject activity, jobject surface);
+    /*benchmark also times the ways of writing set 0 once the device is set up*/
+    VkRenderer(JNIEnv *env, jobject assets, jobject surface, render_backend_t backend = render_backend_t::AUTO,
+               descriptor_update_t descriptor_update = descriptor_update_t::AUTO, bool benchmark = false);
     ~VkRenderer();
     bool request_start();
     void request_pause();
     void request_resume();
+    void request_render(uint32_t /*dirty flags*/ = DIRTY_SCENE);
+    void request_animation(std::chrono::milliseconds /*duration*/);
+    void set_render_mode(render_mode_t);
+    bool submit(const render_command_t&);
+    /*Whether the swapchain already has this size, so a surface change needs no recreation*/
+    bool has_extent(uint32_t /*width*/, uint32_t /*height*/) const;
     void release();
 };
 
@@ -0,0 +1,328 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "VkResourceRegistry.h"
+
+uint32_t HandlePool::allocate() {
+    uint32_t index;
+    if (!free_slots.empty()) {
+        index = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        if (generations.size() > INDEX_MASK) {
+            throw std::runtime_error("Out of resource handles!");
+        }
+        index = static_cast<uint32_t>(generations.size());
+        generations.push_back(1);
+        used.push_back(0);
+    }
+    used[index] = 1;
+    ++live;
+    return (static_cast<uint32_t>(generations[index]) << INDEX_BITS) | index;
+}
+
+void HandlePool::release(uint32_t value) {
+    uint32_t index = index_of(value);
+    uint16_t generation = (generations[index] + 1) & GENERATION_MASK;
+    /*Generation 0 is skipped so a live handle is never 0*/
+    generations[index] = generation == 0 ? 1 : generation;
+    used[index] = 0;
+    free_slots.push_back(index);
+    --live;
+}
+
+bool HandlePool::alive(uint32_t value) const {
+    uint32_t index = index_of(value);
+    return index < generations.size() && used[index] && generations[index] == (value >> INDEX_BITS);
+}
+
+bool HandlePool::slot_used(uint32_t slot) const {
+    return used[slot] != 0;
+}
+
+uint32_t HandlePool::value_of(uint32_t slot) const {
+    return (static_cast<uint32_t>(generations[slot]) << INDEX_BITS) | slot;
+}
+
+uint32_t HandlePool::capacity() const {
+    return static_cast<uint32_t>(generations.size());
+}
+
+uint32_t HandlePool::size() const {
+    return live;
+}
+
+void VkResourceRegistry::init(VkDevice _device, VkPhysicalDevice gpu, VkDeletionQueue *queue) {
+    device = _device;
+    deletion_queue = queue;
+    vkGetPhysicalDeviceMemoryProperties(gpu, &memory_properties);
+}
+
+uint32_t VkResourceRegistry::find_mem_type(uint32_t filter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+        if (filter & (1 << i) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceMemory VkResourceRegistry::allocate_memory(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = find_mem_type(requirements.memoryTypeBits, properties);
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate device memory!");
+    }
+    return memory;
+}
+
+uint32_t VkResourceRegistry::check(const HandlePool &slots, uint32_t value, const char *kind) {
+    if (!slots.alive(value)) {
+        throw std::runtime_error(std::string("Stale ") + kind + " handle!");
+    }
+    return HandlePool::index_of(value);
+}
+
+buffer_handle_t VkResourceRegistry::create_buffer(const buffer_desc_t &desc) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = desc.size;
+    bufferInfo.usage = desc.usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create buffer!");
+    }
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+    VkDeviceMemory memory;
+    try {
+        memory = allocate_memory(memRequirements, desc.properties);
+    } catch (...) {
+        vkDestroyBuffer(device, buffer, nullptr);
+        throw;
+    }
+    vkBindBufferMemory(device, buffer, memory, 0);
+    void* mapped = nullptr;
+    if (desc.properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        vkMapMemory(device, memory, 0, desc.size, 0, &mapped);
+    }
+
+    uint32_t value = buffers.slots.allocate();
+    uint32_t slot = HandlePool::index_of(value);
+    if (slot >= buffers.buffer.size()) {
+        buffers.buffer.resize(slot + 1);
+        buffers.memory.resize(slot + 1);
+        buffers.size.resize(slot + 1);
+        buffers.mapped.resize(slot + 1);
+    }
+    buffers.buffer[slot] = buffer;
+    buffers.memory[slot] = memory;
+    buffers.size[slot] = desc.size;
+    buffers.mapped[slot] = mapped;
+    return {value};
+}
+
+image_handle_t VkResourceRegistry::create_image(const image_desc_t &desc) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = desc.width;
+    imageInfo.extent.height = desc.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = std::max(desc.mip_levels, 1u);
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = desc.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = desc.usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImage image;
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create image!");
+    }
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+    VkDeviceMemory memory;
+    try {
+        memory = allocate_memory(memRequirements, desc.properties);
+    } catch (...) {
+        vkDestroyImage(device, image, nullptr);
+        throw;
+    }
+    vkBindImageMemory(device, image, memory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = desc.format;
+    viewInfo.subresourceRange.aspectMask = desc.aspect;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    VkImageView view;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+        vkDestroyImage(device, image, nullptr);
+        vkFreeMemory(device, memory, nullptr);
+        throw std::runtime_error("Failed to create image view!");
+    }
+
+    uint32_t value = images.slots.allocate();
+    uint32_t slot = HandlePool::index_of(value);
+    if (slot >= images.image.size()) {
+        images.image.resize(slot + 1);
+        images.memory.resize(slot + 1);
+        images.view.resize(slot + 1);
+        images.extent.resize(slot + 1);
+        images.format.resize(slot + 1);
+    }
+    images.image[slot] = image;
+    images.memory[slot] = memory;
+    images.view[slot] = view;
+    images.extent[slot] = {desc.width, desc.height};
+    images.format[slot] = desc.format;
+    return {value};
+}
+
+pipeline_handle_t VkResourceRegistry::add_pipeline(VkPipeline pipeline, VkPipelineLayout layout) {
+    uint32_t value = pipelines.slots.allocate();
+    uint32_t slot = HandlePool::index_of(value);
+    if (slot >= pipelines.pipeline.size()) {
+        pipelines.pipeline.resize(slot + 1);
+        pipelines.layout.resize(slot + 1);
+    }
+    pipelines.pipeline[slot] = pipeline;
+    pipelines.layout[slot] = layout;
+    return {value};
+}
+
+VkBuffer VkResourceRegistry::get_buffer(buffer_handle_t handle) const {
+    return buffers.buffer[check(buffers.slots, handle.value, "buffer")];
+}
+
+VkDeviceSize VkResourceRegistry::get_buffer_size(buffer_handle_t handle) const {
+    return buffers.size[check(buffers.slots, handle.value, "buffer")];
+}
+
+void *VkResourceRegistry::get_mapped(buffer_handle_t handle) const {
+    return buffers.mapped[check(buffers.slots, handle.value, "buffer")];
+}
+
+VkImage VkResourceRegistry::get_image(image_handle_t handle) const {
+    return images.image[check(images.slots, handle.value, "image")];
+}
+
+VkImageView VkResourceRegistry::get_image_view(image_handle_t handle) const {
+    return images.view[check(images.slots, handle.value, "image")];
+}
+
+VkExtent2D VkResourceRegistry::get_image_extent(image_handle_t handle) const {
+    return images.extent[check(images.slots, handle.value, "image")];
+}
+
+VkPipeline VkResourceRegistry::get_pipeline(pipeline_handle_t handle) const {
+    return pipelines.pipeline[check(pipelines.slots, handle.value, "pipeline")];
+}
+
+VkPipelineLayout VkResourceRegistry::get_pipeline_layout(pipeline_handle_t handle) const {
+    return pipelines.layout[check(pipelines.slots, handle.value, "pipeline")];
+}
+
+bool VkResourceRegistry::alive(buffer_handle_t handle) const {
+    return buffers.slots.alive(handle.value);
+}
+
+bool VkResourceRegistry::alive(image_handle_t handle) const {
+    return images.slots.alive(handle.value);
+}
+
+bool VkResourceRegistry::alive(pipeline_handle_t handle) const {
+    return pipelines.slots.alive(handle.value);
+}
+
+void VkResourceRegistry::destroy_buffer_slot(uint32_t slot) {
+    /*Unmapping is implicit in vkFreeMemory*/
+    vkDestroyBuffer(device, buffers.buffer[slot], nullptr);
+    vkFreeMemory(device, buffers.memory[slot], nullptr);
+}
+
+void VkResourceRegistry::destroy_image_slot(uint32_t slot) {
+    vkDestroyImageView(device, images.view[slot], nullptr);
+    vkDestroyImage(device, images.image[slot], nullptr);
+    vkFreeMemory(device, images.memory[slot], nullptr);
+}
+
+void VkResourceRegistry::destroy_pipeline_slot(uint32_t slot) {
+    vkDestroyPipeline(device, pipelines.pipeline[slot], nullptr);
+}
+
+void VkResourceRegistry::destroy(buffer_handle_t handle) {
+    uint32_t slot = check(buffers.slots, handle.value, "buffer");
+    destroy_buffer_slot(slot);
+    buffers.slots.release(handle.value);
+}
+
+void VkResourceRegistry::destroy(image_handle_t handle) {
+    uint32_t slot = check(images.slots, handle.value, "image");
+    destroy_image_slot(slot);
+    images.slots.release(handle.value);
+}
+
+void VkResourceRegistry::destroy(pipeline_handle_t handle) {
+    uint32_t slot = check(pipelines.slots, handle.value, "pipeline");
+    destroy_pipeline_slot(slot);
+    pipelines.slots.release(handle.value);
+}
+
+void VkResourceRegistry::retire(buffer_handle_t handle, uint64_t value) {
+    uint32_t slot = check(buffers.slots, handle.value, "buffer");
+    deletion_queue->retire(value, VK_OBJECT_TYPE_BUFFER, buffers.buffer[slot]);
+    deletion_queue->retire(value, VK_OBJECT_TYPE_DEVICE_MEMORY, buffers.memory[slot]);
+    buffers.slots.release(handle.value);
+}
+
+void VkResourceRegistry::retire(image_handle_t handle, uint64_t value) {
+    uint32_t slot = check(images.slots, handle.value, "image");
+    deletion_queue->retire(value, VK_OBJECT_TYPE_IMAGE_VIEW, images.view[slot]);
+    deletion_queue->retire(value, VK_OBJECT_TYPE_IMAGE, images.image[slot]);
+    deletion_queue->retire(value, VK_OBJECT_TYPE_DEVICE_MEMORY, images.memory[slot]);
+    images.slots.release(handle.value);
+}
+
+void VkResourceRegistry::retire(pipeline_handle_t handle, uint64_t value) {
+    uint32_t slot = check(pipelines.slots, handle.value, "pipeline");
+    deletion_queue->retire(value, VK_OBJECT_TYPE_PIPELINE, pipelines.pipeline[slot]);
+    pipelines.slots.release(handle.value);
+}
+
+void VkResourceRegistry::clear() {
+    for (uint32_t slot = 0; slot < buffers.slots.capacity(); ++slot) {
+        if (!buffers.slots.slot_used(slot)) continue;
+        destroy_buffer_slot(slot);
+        buffers.slots.release(buffers.slots.value_of(slot));
+    }
+    for (uint32_t slot = 0; slot < images.slots.capacity(); ++slot) {
+        if (!images.slots.slot_used(slot)) continue;
+        destroy_image_slot(slot);
+        images.slots.release(images.slots.value_of(slot));
+    }
+    for (uint32_t slot = 0; slot < pipelines.slots.capacity(); ++slot) {
+        if (!pipelines.slots.slot_used(slot)) continue;
+        destroy_pipeline_slot(slot);
+        pipelines.slots.release(pipelines.slots.value_of(slot));
+    }
+}
+
+resource_stats_t VkResourceRegistry::get_stats() const {
+    return {buffers.slots.size(), images.slots.size(), pipelines.slots.size()};
+}
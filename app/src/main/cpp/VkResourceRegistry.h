@@ -0,0 +1,147 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKRESOURCEREGISTRY_H
+#define HELLO_VULKAN_VKRESOURCEREGISTRY_H
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VkDeletionQueue.h"
+
+/*
+ * 32-bit generational handle: the low 20 bits index a slot, the high 12 bits hold the
+ * slot generation. Freeing bumps the generation so stale copies are detected, and the
+ * zero value never names a live resource.
+ */
+template<typename Tag>
+struct resource_handle_t {
+    uint32_t value = 0;
+    bool valid() const { return value != 0; }
+    bool operator==(const resource_handle_t& other) const { return value == other.value; }
+    bool operator!=(const resource_handle_t& other) const { return value != other.value; }
+};
+
+using buffer_handle_t = resource_handle_t<struct buffer_tag_t>;
+using image_handle_t = resource_handle_t<struct image_tag_t>;
+using pipeline_handle_t = resource_handle_t<struct pipeline_tag_t>;
+
+/*Hands out slot indices with generations; the resource data itself lives in parallel arrays*/
+class HandlePool {
+private:
+    std::vector<uint16_t> generations;
+    std::vector<uint8_t> used;
+    std::vector<uint32_t> free_slots;
+    uint32_t live = 0;
+public:
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+    static uint32_t index_of(uint32_t value) { return value & INDEX_MASK; }
+    /*Returns the handle value; its slot is index_of(value) < capacity()*/
+    uint32_t allocate();
+    void release(uint32_t value);
+    bool alive(uint32_t value) const;
+    bool slot_used(uint32_t slot) const;
+    /*Current handle value of a used slot*/
+    uint32_t value_of(uint32_t slot) const;
+    uint32_t capacity() const;
+    uint32_t size() const;
+};
+
+struct buffer_desc_t {
+    VkDeviceSize size;
+    VkBufferUsageFlags usage;
+    /*Host visible buffers stay persistently mapped*/
+    VkMemoryPropertyFlags properties;
+};
+
+struct image_desc_t {
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    VkImageUsageFlags usage;
+    VkMemoryPropertyFlags properties;
+    VkImageAspectFlags aspect;
+    /*0 and 1 both mean a single level; the view covers all of them*/
+    uint32_t mip_levels;
+};
+
+struct resource_stats_t {
+    uint32_t buffers;
+    uint32_t images;
+    uint32_t pipelines;
+};
+
+/*
+ * Owns buffers, images and pipelines behind generational handles. Every pool is a
+ * struct of arrays indexed by slot, so per-frame lookups only touch the array they
+ * need, and freed slots are recycled so steady state create/free does not allocate.
+ * Stale handles throw instead of returning a dangling Vulkan object.
+ */
+class VkResourceRegistry {
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    VkDeletionQueue* deletion_queue = nullptr;
+    struct {
+        HandlePool slots;
+        std::vector<VkBuffer> buffer;
+        std::vector<VkDeviceMemory> memory;
+        std::vector<VkDeviceSize> size;
+        std::vector<void*> mapped;
+    } buffers;
+    struct {
+        HandlePool slots;
+        std::vector<VkImage> image;
+        std::vector<VkDeviceMemory> memory;
+        std::vector<VkImageView> view;
+        std::vector<VkExtent2D> extent;
+        std::vector<VkFormat> format;
+    } images;
+    struct {
+        HandlePool slots;
+        std::vector<VkPipeline> pipeline;
+        std::vector<VkPipelineLayout> layout;
+    } pipelines;
+    VkDeviceMemory allocate_memory(const VkMemoryRequirements&, VkMemoryPropertyFlags);
+    static uint32_t check(const HandlePool&, uint32_t value, const char* kind);
+    void destroy_buffer_slot(uint32_t slot);
+    void destroy_image_slot(uint32_t slot);
+    void destroy_pipeline_slot(uint32_t slot);
+public:
+    VkResourceRegistry() = default;
+    VkResourceRegistry(const VkResourceRegistry&) = delete;
+    VkResourceRegistry& operator=(const VkResourceRegistry&) = delete;
+    void init(VkDevice, VkPhysicalDevice, VkDeletionQueue*);
+    uint32_t find_mem_type(uint32_t filter, VkMemoryPropertyFlags properties) const;
+    buffer_handle_t create_buffer(const buffer_desc_t&);
+    image_handle_t create_image(const image_desc_t&);
+    /*Takes ownership of pipeline; layout is only recorded for binding*/
+    pipeline_handle_t add_pipeline(VkPipeline pipeline, VkPipelineLayout layout);
+    VkBuffer get_buffer(buffer_handle_t) const;
+    VkDeviceSize get_buffer_size(buffer_handle_t) const;
+    void* get_mapped(buffer_handle_t) const;
+    VkImage get_image(image_handle_t) const;
+    VkImageView get_image_view(image_handle_t) const;
+    VkExtent2D get_image_extent(image_handle_t) const;
+    VkPipeline get_pipeline(pipeline_handle_t) const;
+    VkPipelineLayout get_pipeline_layout(pipeline_handle_t) const;
+    bool alive(buffer_handle_t) const;
+    bool alive(image_handle_t) const;
+    bool alive(pipeline_handle_t) const;
+    /*Destroys right away; the GPU must no longer use the resource*/
+    void destroy(buffer_handle_t);
+    void destroy(image_handle_t);
+    void destroy(pipeline_handle_t);
+    /*Invalidates the handle now and hands the Vulkan objects to the deletion queue*/
+    void retire(buffer_handle_t, uint64_t value);
+    void retire(image_handle_t, uint64_t value);
+    void retire(pipeline_handle_t, uint64_t value);
+    /*Destroys every live resource; the device must be idle*/
+    void clear();
+    resource_stats_t get_stats() const;
+};
+
+
+#endif //HELLO_VULKAN_VKRESOURCEREGISTRY_H
@@ -0,0 +1,127 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "VkShaderLibrary.h"
+#include "Log.h"
+
+static const char* TAG = "VkShaderLibrary";
+
+VkShaderLibrary::VkShaderLibrary(AAssetManager *assets, const char *path) {
+    asset = AAssetManager_open(assets, path, AASSET_MODE_BUFFER);
+    if (asset == nullptr) {
+        throw std::runtime_error(std::string("Unable to open shader archive ") + path + "!");
+    }
+    base = static_cast<const uint8_t*>(AAsset_getBuffer(asset));
+    size = static_cast<size_t>(AAsset_getLength(asset));
+    if (base == nullptr || size < sizeof(shader_archive_header_t)) {
+        AAsset_close(asset);
+        throw std::runtime_error("Invalid shader archive!");
+    }
+    if (reinterpret_cast<uintptr_t>(base) % alignof(uint32_t) != 0) {
+        /*Compressed or misaligned in the APK, fall back to one aligned copy*/
+        LOGW(TAG, "Shader archive %s is not aligned, copying %zu bytes", path, size);
+        copy.resize((size + 3) / 4);
+        memcpy(copy.data(), base, size);
+        base = reinterpret_cast<const uint8_t*>(copy.data());
+    }
+    auto header = reinterpret_cast<const shader_archive_header_t*>(base);
+    if (header->magic != SHADER_ARCHIVE_MAGIC || header->version != SHADER_ARCHIVE_VERSION
+        || sizeof(shader_archive_header_t) + header->entry_count * sizeof(shader_archive_entry_t) > size) {
+        AAsset_close(asset);
+        throw std::runtime_error("Invalid shader archive!");
+    }
+    entries = reinterpret_cast<const shader_archive_entry_t*>(base + sizeof(shader_archive_header_t));
+    entry_count = header->entry_count;
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        if (entries[i].offset % SHADER_ARCHIVE_ALIGNMENT != 0 || static_cast<size_t>(entries[i].offset) + entries[i].size > size) {
+            AAsset_close(asset);
+            throw std::runtime_error("Corrupted shader archive entry!");
+        }
+    }
+    LOGI(TAG, "Loaded %u shaders from %s", entry_count, path);
+}
+
+VkShaderLibrary::~VkShaderLibrary() {
+    clear();
+    AAsset_close(asset);
+}
+
+uint64_t VkShaderLibrary::hash_name(const char *name) {
+    return SpirvReflection::hash(name, strlen(name));
+}
+
+void VkShaderLibrary::set_device(VkDevice _device) {
+    device = _device;
+}
+
+const shader_archive_entry_t *VkShaderLibrary::find(uint64_t hash) const {
+    const shader_archive_entry_t* end = entries + entry_count;
+    const shader_archive_entry_t* it = std::lower_bound(entries, end, hash, [](const shader_archive_entry_t& entry, uint64_t h) {
+        return entry.hash < h;
+    });
+    return it != end && it->hash == hash ? it : nullptr;
+}
+
+bool VkShaderLibrary::contains(const char *name) const {
+    return find(hash_name(name)) != nullptr;
+}
+
+const uint32_t *VkShaderLibrary::get_code(const char *name, size_t &size_in_bytes) const {
+    const shader_archive_entry_t* entry = find(hash_name(name));
+    if (entry == nullptr) {
+        throw std::runtime_error(std::string("Shader ") + name + " not found!");
+    }
+    size_in_bytes = entry->size;
+    return reinterpret_cast<const uint32_t*>(base + entry->offset);
+}
+
+const shader_reflection_t &VkShaderLibrary::reflect(const char *name) const {
+    size_t code_size;
+    const uint32_t* code = get_code(name, code_size);
+    return SpirvReflection::reflect(code, code_size);
+}
+
+VkShaderModule VkShaderLibrary::get_module(const char *name) {
+    if (!contains(name)) {
+        throw std::runtime_error(std::string("Shader ") + name + " not found!");
+    }
+    return get_module(hash_name(name));
+}
+
+VkShaderModule VkShaderLibrary::get_module(uint64_t hash) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = modules.find(hash);
+    if (it != modules.end()) return it->second;
+    const shader_archive_entry_t* entry = find(hash);
+    if (entry == nullptr) {
+        throw std::runtime_error("Shader not found!");
+    }
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = entry->size;
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(base + entry->offset);
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &module) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to create vkShaderModule!");
+    }
+    modules.emplace(hash, module);
+    return module;
+}
+
+void VkShaderLibrary::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto& [hash, module]: modules) {
+        vkDestroyShaderModule(device, module, nullptr);
+    }
+    modules.clear();
+}
+
+uint32_t VkShaderLibrary::get_module_count() {
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<uint32_t>(modules.size());
+}
@@ -0,0 +1,77 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKSHADERLIBRARY_H
+#define HELLO_VULKAN_VKSHADERLIBRARY_H
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <android/asset_manager.h>
+#include <vulkan/vulkan.h>
+#include "SpirvReflection.h"
+
+/*
+ * Packed shader archive, written by the packShaders task in app/build.gradle.
+ * Little endian: header, entry table sorted by hash, then the SPIR-V blobs, each
+ * starting on a SHADER_ARCHIVE_ALIGNMENT boundary so they can be used in place.
+ */
+constexpr uint32_t SHADER_ARCHIVE_MAGIC = 0x4B415053; /*"SPAK"*/
+constexpr uint32_t SHADER_ARCHIVE_VERSION = 1;
+constexpr uint32_t SHADER_ARCHIVE_ALIGNMENT = 16;
+
+struct shader_archive_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct shader_archive_entry_t {
+    /*FNV-1a of the source file name, e.g. "simple.vert"*/
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t size;
+};
+
+/*
+ * Read-only view of a shader archive asset. The asset is stored uncompressed so
+ * AAsset_getBuffer() maps it instead of inflating it; VkShaderModules are only
+ * created on first use and cached until clear().
+ */
+class VkShaderLibrary {
+private:
+    AAsset* asset = nullptr;
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    /*Only used when the mapped asset is not 4-byte aligned*/
+    std::vector<uint32_t> copy;
+    const shader_archive_entry_t* entries = nullptr;
+    uint32_t entry_count = 0;
+    VkDevice device = VK_NULL_HANDLE;
+    std::mutex lock;
+    std::unordered_map<uint64_t, VkShaderModule> modules;
+    const shader_archive_entry_t* find(uint64_t hash) const;
+public:
+    VkShaderLibrary(AAssetManager* assets, const char* path);
+    VkShaderLibrary(const VkShaderLibrary&) = delete;
+    VkShaderLibrary& operator=(const VkShaderLibrary&) = delete;
+    ~VkShaderLibrary();
+    static uint64_t hash_name(const char* name);
+    void set_device(VkDevice);
+    bool contains(const char* name) const;
+    /*Aligned SPIR-V words of a shader, valid for the lifetime of the library*/
+    const uint32_t* get_code(const char* name, size_t& size_in_bytes) const;
+    const shader_reflection_t& reflect(const char* name) const;
+    VkShaderModule get_module(const char* name);
+    /*By VkShaderLibrary::hash_name, for callers that store shader ids*/
+    VkShaderModule get_module(uint64_t hash);
+    /*Destroys every cached module*/
+    void clear();
+    uint32_t get_module_count();
+};
+
+
+#endif //HELLO_VULKAN_VKSHADERLIBRARY_H
@@ -0,0 +1,107 @@
+//
+// Created by wn123 on 2026-10-18.
+//
+
+#ifndef HELLO_VULKAN_VKUNIQUE_H
+#define HELLO_VULKAN_VKUNIQUE_H
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vulkan/vulkan.h>
+
+/*
+ * Move-only owner of a device level Vulkan object. Destroy is the matching
+ * vkDestroyXxx function, so the wrapper works on 32-bit ABIs where every
+ * non-dispatchable handle is the same uint64_t type. A null Destroy of the
+ * function's PFN type stands for an entry point beyond Vulkan 1.0: the function
+ * is looked up at runtime and handed to put() with the device.
+ */
+template<typename T, auto Destroy>
+class VkUnique {
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    T handle = VK_NULL_HANDLE;
+    decltype(Destroy) destroy = Destroy;
+public:
+    VkUnique() = default;
+    VkUnique(VkDevice _device, T _handle): device(_device), handle(_handle) {}
+    VkUnique(const VkUnique&) = delete;
+    VkUnique& operator=(const VkUnique&) = delete;
+    VkUnique(VkUnique&& other) noexcept: device(other.device), handle(std::exchange(other.handle, VK_NULL_HANDLE)),
+                                         destroy(other.destroy) {}
+    VkUnique& operator=(VkUnique&& other) noexcept {
+        if (this != &other) {
+            reset();
+            device = other.device;
+            handle = std::exchange(other.handle, VK_NULL_HANDLE);
+            destroy = other.destroy;
+        }
+        return *this;
+    }
+    ~VkUnique() {
+        reset();
+    }
+    void reset() {
+        if (handle != VK_NULL_HANDLE) {
+            destroy(device, handle, nullptr);
+            handle = VK_NULL_HANDLE;
+        }
+    }
+    /*Destroys the current object and returns the slot for a vkCreateXxx call; _destroy will destroy the new one*/
+    T* put(VkDevice _device, decltype(Destroy) _destroy = Destroy) {
+        if (_destroy == nullptr) {
+            throw std::runtime_error("No function to destroy the Vulkan object!");
+        }
+        reset();
+        device = _device;
+        destroy = _destroy;
+        return &handle;
+    }
+    /*Gives up ownership without destroying*/
+    T release() {
+        return std::exchange(handle, VK_NULL_HANDLE);
+    }
+    T get() const {
+        return handle;
+    }
+    const T* ptr() const {
+        return &handle;
+    }
+    operator T() const {
+        return handle;
+    }
+};
+
+/*Handle as 64 bits for hashing and packed keys; dispatchable handles are pointers*/
+template<typename T>
+uint64_t handle_bits(T handle) {
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<uintptr_t>(handle);
+    } else {
+        return static_cast<uint64_t>(handle);
+    }
+}
+
+template<typename T>
+T handle_from_bits(uint64_t bits) {
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(static_cast<uintptr_t>(bits));
+    } else {
+        return static_cast<T>(bits);
+    }
+}
+
+using VkUniqueRenderPass = VkUnique<VkRenderPass, vkDestroyRenderPass>;
+using VkUniqueDescriptorSetLayout = VkUnique<VkDescriptorSetLayout, vkDestroyDescriptorSetLayout>;
+using VkUniqueDescriptorPool = VkUnique<VkDescriptorPool, vkDestroyDescriptorPool>;
+using VkUniqueDescriptorUpdateTemplate = VkUnique<VkDescriptorUpdateTemplate, static_cast<PFN_vkDestroyDescriptorUpdateTemplate>(nullptr)>;
+using VkUniquePipelineLayout = VkUnique<VkPipelineLayout, vkDestroyPipelineLayout>;
+using VkUniquePipelineCache = VkUnique<VkPipelineCache, vkDestroyPipelineCache>;
+using VkUniqueCommandPool = VkUnique<VkCommandPool, vkDestroyCommandPool>;
+using VkUniqueSampler = VkUnique<VkSampler, vkDestroySampler>;
+using VkUniqueSemaphore = VkUnique<VkSemaphore, vkDestroySemaphore>;
+using VkUniqueFence = VkUnique<VkFence, vkDestroyFence>;
+
+
+#endif //HELLO_VULKAN_VKUNIQUE_H
@@ -1,14 +1,20 @@
 #include <jni.h>
+#include <algorithm>
 #include <vector>
 #include "VkRenderer.h"
+#include "JobSystem.h"
+#include "BoundingVolumes.h"
+#include "BoundingVolumeHierarchy.h"
 #include "Log.h"
 const char* TAG = "hello_vulkan";
 std::unique_ptr<VkRenderer> renderer;
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_cn_touchair_hello_1vulkan_MainActivity_nativeAttachSurface(JNIEnv *env, jobject thiz,jobject surface) {
-   renderer = std::make_unique<VkRenderer>(env, nullptr, surface);
+Java_cn_touchair_hello_1vulkan_MainActivity_nativeAttachSurface(JNIEnv *env, jobject thiz, jobject surface, jobject assets, jint backend,
+                                                             jint descriptor_update, jboolean benchmark) {
+   renderer = std::make_unique<VkRenderer>(env, assets, surface, static_cast<render_backend_t>(backend),
+                                          static_cast<descriptor_update_t>(descriptor_update), benchmark);
    renderer->request_start();
 }
 
@@ -17,4 +23,46 @@ JNIEXPORT void JNICALL
 Java_cn_touchair_hello_1vulkan_MainActivity_nativeDetachSurface(JNIEnv *env, jobject thiz) {
     renderer->release();
     renderer = nullptr;
-}
\ No newline at end of file
+}
+extern "C"
+JNIEXPORT void JNICALL
+Java_cn_touchair_hello_1vulkan_MainActivity_nativeSurfaceChanged(JNIEnv *env, jobject thiz, jint width, jint height) {
+    /*surfaceChanged follows every surfaceCreated, mostly with the size the swapchain was just created at*/
+    if (renderer == nullptr || renderer->has_extent(static_cast<uint32_t>(width), static_cast<uint32_t>(height))) return;
+    render_command_t command{};
+    command.type = render_command_type_t::SURFACE_CHANGED;
+    command.surface.width = static_cast<uint32_t>(width);
+    command.surface.height = static_cast<uint32_t>(height);
+    renderer->submit(command);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_cn_touchair_hello_1vulkan_MainActivity_nativeRunBenchmarks(JNIEnv *env, jobject thiz) {
+    /*A frame whose update takes half as long as its recording*/
+    frame_pipeline_benchmark_t pipeline = benchmark_frame_pipeline(std::chrono::microseconds(2000), std::chrono::microseconds(4000), 120);
+    LOGI(TAG, "Frame pipeline over %u frames: serial %.2fms, pipelined %.2fms per frame (%.2fx)", pipeline.frames, pipeline.serial_ms,
+         pipeline.pipelined_ms, pipeline.serial_ms / std::max(pipeline.pipelined_ms, 1e-6));
+    for (uint32_t threads = 1; threads <= 16; threads *= 2) {
+        job_benchmark_t jobs = benchmark_jobs(threads);
+        LOGI(TAG, "Jobs on %u workers: spawn %.1fns per job, steal test %.2fms (%.1f%% stolen), parallel_for %.2fms",
+             jobs.threads, jobs.spawn_ns, jobs.steal_ms, 100.0 * jobs.stolen, jobs.parallel_for_ms);
+    }
+    /*Fewer passes over the bigger sets keep each size at a similar total time*/
+    const uint32_t sizes[][2] = {{10000, 200}, {100000, 20}, {1000000, 4}};
+    for (const auto& size: sizes) {
+        bounds_benchmark_t result = benchmark_bounds_culling(size[0], size[1]);
+        LOGI(TAG, "Frustum culling %u objects: scalar spheres %.3fms (%u visible), SIMD spheres %.3fms (%u visible, %.1fx), "
+                  "SIMD boxes %.3fms (%u visible)", result.objects, result.scalar_ms, result.scalar_visible, result.sphere_ms,
+             result.sphere_visible, result.scalar_ms / std::max(result.sphere_ms, 1e-6), result.box_ms, result.box_visible);
+    }
+    bvh_benchmark_t bvh = benchmark_bvh(1000000, 1000);
+    LOGI(TAG, "BVH of %u primitives: built in %.1fms, %u nodes, depth %u, SAH cost %.1f; refit %.1fms, SAH cost %.1f",
+         bvh.primitives, bvh.build_ms, bvh.stats.nodes, bvh.stats.depth, bvh.stats.sah_cost, bvh.refit_ms, bvh.refit_sah_cost);
+    LOGI(TAG, "BVH queries: frustum %.3fms (%u visible) vs %.3fms brute force (%u visible), ray %.2fus (%u hits), "
+              "sphere overlap %.2fus, nearest %.2fus", bvh.cull_ms, bvh.visible, bvh.brute_cull_ms, bvh.brute_visible, bvh.ray_us,
+         bvh.ray_hits, bvh.overlap_us, bvh.nearest_us);
+    if (bvh.cull_mismatches > 0) {
+        LOGE(TAG, "BVH frustum cull disagrees with brute force on %u primitives", bvh.cull_mismatches);
+    }
+}
@@ -1,5 +1,6 @@
 package cn.touchair.hello_vulkan;
 
+import android.content.res.AssetManager;
 import android.os.Bundle;
 import android.view.Surface;
 import android.view.SurfaceHolder;
@@ -15,7 +16,16 @@ import cn.touchair.hello_vulkan.databinding.ActivityMainBinding;
 
 public class MainActivity extends AppCompatActivity implements SurfaceHolder.Callback {
 
+    /*Matches render_backend_t: 0 auto, 1 render pass, 2 dynamic rendering*/
+    public static final String EXTRA_RENDER_BACKEND = "render_backend";
+    /*Matches descriptor_update_t: 0 auto, 1 write, 2 template, 3 push*/
+    public static final String EXTRA_DESCRIPTOR_UPDATE = "descriptor_update";
+    /*Runs the CPU benchmarks once on a background thread, results go to logcat*/
+    public static final String EXTRA_BENCHMARK = "benchmark";
+
     private ActivityMainBinding binding;
+    /*The renderer's own benchmarks run with the first surface only*/
+    private boolean benchmarkRenderer;
 
     @Override
     protected void onCreate(Bundle savedInstanceState) {
@@ -29,10 +39,16 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
             v.setPadding(systemBars.left, systemBars.top, systemBars.right, systemBars.bottom);
             return insets;
         });
+        if (getIntent().getBooleanExtra(EXTRA_BENCHMARK, false)) {
+            benchmarkRenderer = true;
+            new Thread(this::nativeRunBenchmarks, "Benchmarks").start();
+        }
     }
 
-    private native void nativeAttachSurface(Surface surface);
+    private native void nativeAttachSurface(Surface surface, AssetManager assets, int backend, int descriptorUpdate, boolean benchmark);
     private native void nativeDetachSurface();
+    private native void nativeSurfaceChanged(int width, int height);
+    private native void nativeRunBenchmarks();
 
     static {
         System.loadLibrary("hello_vulkan");
@@ -40,12 +56,14 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
 
     @Override
     public void surfaceChanged(@NonNull SurfaceHolder holder, int format, int width, int height) {
-
+        nativeSurfaceChanged(width, height);
     }
 
     @Override
     public void surfaceCreated(@NonNull SurfaceHolder holder) {
-        nativeAttachSurface(holder.getSurface());
+        nativeAttachSurface(holder.getSurface(), getAssets(), getIntent().getIntExtra(EXTRA_RENDER_BACKEND, 0),
+                getIntent().getIntExtra(EXTRA_DESCRIPTOR_UPDATE, 0), benchmarkRenderer);
+        benchmarkRenderer = false;
     }
 
     @Override
@@ -0,0 +1,36 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+/*Permutation bits, see shader_permutation_t*/
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool ALPHA_TEST = false;
+layout(constant_id = 2) const bool SRGB_ENCODE = false;
+
+/*Every texture of the scene, see VkBindlessTable*/
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec3 fragNormal;
+/*Per draw, see DrawData in the vertex shader*/
+layout(location = 2) flat in vec4 fragTint;
+layout(location = 3) flat in uint fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    /*
+     * Flat and the same for every invocation of a draw, and each draw of a multi-draw
+     * is its own invocation group, so the index is dynamically uniform without nonuniformEXT
+     */
+    vec4 color = USE_TEXTURE ? texture(textures[fragMaterial], fragTexCoord) : vec4(fragTexCoord, 0.0, 1.0);
+    color *= fragTint;
+    /*Two-sided headlight, faces looking at the viewer are lit fully*/
+    color.rgb *= 0.35 + 0.65 * abs(normalize(fragNormal).z);
+    if (ALPHA_TEST && color.a < 0.5) {
+        discard;
+    }
+    if (SRGB_ENCODE) {
+        color.rgb = pow(color.rgb, vec3(1.0 / 2.2));
+    }
+    outColor = color;
+}
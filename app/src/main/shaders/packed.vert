@@ -0,0 +1,56 @@
+#version 450
+
+/*Per frame, see UBO. Set 0 is allocated and written every frame*/
+layout(binding = 0) uniform UBO {
+    mat4 view_proj;
+} ubo;
+
+struct DrawData {
+    mat4 model;
+    vec4 tint;
+    /*Bounding sphere in model space, read by cull.comp*/
+    vec4 sphere;
+    uint material;
+    uint batch;
+    uint batch_first;
+};
+
+/*
+ * Per draw, see draw_data_t. model includes the primitive's dequantization.
+ * Each draw passes its own index as firstInstance, see VkDrawList.
+ */
+layout(std430, binding = 1) readonly buffer Draws {
+    DrawData draws[];
+};
+
+/*
+ * See packed_vertex_t, the fixed function fetch expands the normalized formats.
+ * Location 3 holds the tangent: xyz * 2 - 1, bitangent sign w * 2 - 1.
+ */
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) flat out vec4 fragTint;
+layout(location = 3) flat out uint fragMaterial;
+
+/*Unfolds the lower hemisphere back over the diagonals*/
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    DrawData draw = draws[gl_InstanceIndex];
+    /*w is stored as 1*/
+    gl_Position = ubo.view_proj * draw.model * inPosition;
+    fragTexCoord = inTexCoord;
+    fragNormal = mat3(draw.model) * decode_octahedral(inNormal);
+    fragTint = draw.tint;
+    fragMaterial = draw.material;
+}
@@ -0,0 +1,30 @@
+#version 450
+
+/*Permutation bits, see shader_permutation_t*/
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool ALPHA_TEST = false;
+layout(constant_id = 2) const bool SRGB_ENCODE = false;
+
+/*Per material, cached by content, see VkDescriptorSetCache*/
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec3 fragNormal;
+/*Per draw, see DrawData in the vertex shader*/
+layout(location = 2) flat in vec4 fragTint;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 color = USE_TEXTURE ? texture(texSampler, fragTexCoord) : vec4(fragTexCoord, 0.0, 1.0);
+    color *= fragTint;
+    /*Two-sided headlight, faces looking at the viewer are lit fully*/
+    color.rgb *= 0.35 + 0.65 * abs(normalize(fragNormal).z);
+    if (ALPHA_TEST && color.a < 0.5) {
+        discard;
+    }
+    if (SRGB_ENCODE) {
+        color.rgb = pow(color.rgb, vec3(1.0 / 2.2));
+    }
+    outColor = color;
+}
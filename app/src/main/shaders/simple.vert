@@ -0,0 +1,40 @@
+#version 450
+
+/*Per frame, see UBO. Set 0 is allocated and written every frame*/
+layout(binding = 0) uniform UBO {
+    mat4 view_proj;
+} ubo;
+
+struct DrawData {
+    mat4 model;
+    vec4 tint;
+    /*Bounding sphere in model space, read by cull.comp*/
+    vec4 sphere;
+    uint material;
+    uint batch;
+    uint batch_first;
+};
+
+/*Per draw, see draw_data_t. Each draw passes its own index as firstInstance, see VkDrawList*/
+layout(std430, binding = 1) readonly buffer Draws {
+    DrawData draws[];
+};
+
+/*See mesh_vertex_t*/
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) flat out vec4 fragTint;
+layout(location = 3) flat out uint fragMaterial;
+
+void main() {
+    DrawData draw = draws[gl_InstanceIndex];
+    gl_Position = ubo.view_proj * draw.model * vec4(inPosition, 1.0);
+    fragTexCoord = inTexCoord;
+    fragNormal = mat3(draw.model) * inNormal;
+    fragTint = draw.tint;
+    fragMaterial = draw.material;
+}